@@ -1,113 +1,53 @@
-// === MIA_Dumper_G10_MenthorQ.cpp (header inlined - Approach 1) ===
-// Utilities previously in "mia_dump_utils.hpp" are embedded below to allow
-// single-file remote builds on Sierra Chart.
-
-#include "sierrachart.h"
-#ifdef _WIN32
-  #include <windows.h>
-#endif
-#include <time.h>
-#include <cmath>
-#include <unordered_map>
-#include <string>
-#include <vector>
-using std::fabs;
+// === MIA_Dumper_G10_MenthorQ.cpp ===
+// Utilitaires communs (écriture, chemins, prix, métriques) fournis par
+// "mia_dump_utils.hpp" et le runtime partagé mia_runtime\.
 
-SCDLLName("MIA_Dumper_G10_MenthorQ")
-
-// ========== UTILITAIRES COMMUNS ==========
-
-// Création du répertoire de sortie organisé
-static void EnsureOutDir(const char* baseDir = "D:\\MIA_IA_system") {
-#ifdef _WIN32
-  CreateDirectoryA(baseDir, NULL);
-  CreateDirectoryA("D:\\MIA_IA_system\\DATA_SIERRA_CHART", NULL);
-#endif
-}
-
-// Création de la structure de répertoires organisée
-static void EnsureOrganizedDir(int chartNumber) {
-#ifdef _WIN32
-  time_t now = time(NULL);
-  struct tm* lt = localtime(&now);
-  int y = lt ? (lt->tm_year + 1900) : 1970;
-  int m = lt ? (lt->tm_mon + 1) : 1;
-  int d = lt ? lt->tm_mday : 1;
-  
-  // Noms des mois
-  const char* monthNames[] = {"JANVIER", "FEVRIER", "MARS", "AVRIL", "MAI", "JUIN",
-                             "JUILLET", "AOUT", "SEPTEMBRE", "OCTOBRE", "NOVEMBRE", "DECEMBRE"};
-  
-  char basePath[512];
-  char yearPath[512];
-  char monthPath[512];
-  char dayPath[512];
-  char chartPath[512];
-  
-  sprintf(basePath, "D:\\MIA_IA_system\\DATA_SIERRA_CHART");
-  sprintf(yearPath, "%s\\DATA_%d", basePath, y);
-  sprintf(monthPath, "%s\\%s", yearPath, monthNames[m-1]);
-  sprintf(dayPath, "%s\\%04d%02d%02d", monthPath, y, m, d);
-  sprintf(chartPath, "%s\\CHART_%d", dayPath, chartNumber);
-  
-  CreateDirectoryA(basePath, NULL);
-  CreateDirectoryA(yearPath, NULL);
-  CreateDirectoryA(monthPath, NULL);
-  CreateDirectoryA(dayPath, NULL);
-  CreateDirectoryA(chartPath, NULL);
-#endif
-}
-
-// Génération du nom de fichier quotidien par chart et type dans la structure organisée
-static SCString DailyFilenameForChartType(int chartNumber, const char* dataType, const char* baseDir = "D:\\MIA_IA_system") {
-  time_t now = time(NULL);
-  struct tm* lt = localtime(&now);
-  int y = lt ? (lt->tm_year + 1900) : 1970;
-  int m = lt ? (lt->tm_mon + 1) : 1;
-  int d = lt ? lt->tm_mday : 1;
-  
-  // Noms des mois
-  const char* monthNames[] = {"JANVIER", "FEVRIER", "MARS", "AVRIL", "MAI", "JUIN",
-                             "JUILLET", "AOUT", "SEPTEMBRE", "OCTOBRE", "NOVEMBRE", "DECEMBRE"};
-  
-  SCString filename;
-  filename.Format("D:\\MIA_IA_system\\DATA_SIERRA_CHART\\DATA_%d\\%s\\%04d%02d%02d\\CHART_%d\\chart_%d_%s_%04d%02d%02d.jsonl", 
-                  y, monthNames[m-1], y, m, d, chartNumber, chartNumber, dataType, y, m, d);
-  return filename;
-}
+#include "mia_dump_utils.hpp"
+#include "mia_engines/mia_level_table.hpp"
+#include "mia_engines/mia_gex_curve.hpp"
 
-// Écriture dans le fichier spécialisé avec structure organisée
-static void WriteToSpecializedFile(int chartNumber, const char* dataType, const SCString& line, const char* baseDir = "D:\\MIA_IA_system") {
-  EnsureOutDir(baseDir);
-  EnsureOrganizedDir(chartNumber);  // Créer la structure de répertoires
-  const SCString filename = DailyFilenameForChartType(chartNumber, dataType, baseDir);
-  FILE* f = fopen(filename.GetChars(), "a");
-  if (f) { 
-    fprintf(f, "%s\n", line.GetChars()); 
-    fclose(f); 
-  }
-}
+SCDLLName("MIA_Dumper_G10_MenthorQ")
 
 // ========== DÉDUPLICATION INTELLIGENTE AMÉLIORÉE ==========
-// Structure pour la déduplication par (sym, t, i)
-struct LastKey { 
-  double t = 0.0; // timestamp
-  double i = -1;  // bar index
-};
-
-// Structures pour la détection de changement d'état
-struct LastMenthorQ {
-  std::unordered_map<std::string, double> last_values; // level_type -> price
+// Input du Study ID de chaque famille (le nombre de subgraphs suit)
+static const int kGroupStudyInput[] = {1, 3, 5};
+
+// Subgraphs Gamma Levels utilisés par la courbe GEX
+#define GEX_SG_CALL_RESISTANCE 0
+#define GEX_SG_PUT_SUPPORT 1
+#define GEX_SG_HVL 2
+#define GEX_SG_FIRST 9   // gex_1 .. gex_10
+#define GEX_COUNT 10
+#define GEX_PAD_TICKS 400  // marge de la table de part et d'autre des ancrages
+
+// Subgraphs publiés par G10 (lisibles par les autres études du processus
+// via GetStudyArrayFromChartUsingID): poids de rang GEX au prix, HVL,
+// régime du prix par rapport à la HVL
+#define GEX_OUT_RANK_WEIGHT 0
+#define GEX_OUT_HVL 1
+#define GEX_OUT_HVL_REGIME 2
+
+// Table triée des niveaux par symbole: seuls les niveaux ajoutés / déplacés /
+// retirés sont écrits, plus un snapshot complet en début de session
+struct MenthorQTableState {
+  MiaLevelTable table;
+  std::vector<MiaLevelChange> changes;
+  float raw[MiaLevelTable::kMaxPerGroup];      // valeurs brutes du relevé (empaquetées)
+  int64_t ticks[MiaLevelTable::kMaxPerGroup];  // mêmes valeurs normalisées en ticks
+  MiaGexCurve gex;                            // poids de rang GEX par tick (lookup O(1))
+  std::vector<MiaGexAnchor> gex_anchors;
+  int64_t gex_hvl = 0;                        // HVL en ticks (0 = absente)
+  double tick = 0.0;
+  int decimals = 2;             // précision prix, calculée une fois par tick size
+  int snapshot_date = 0;        // date de session du dernier snapshot complet
+  int snapshot_file_date = 0;   // fichier quotidien (date locale) qui l'a reçu
+  int last_polled_bar = -1;
+  SCDateTime last_poll = 0.0;
 };
 
 // Maps de déduplication par symbole
 static std::unordered_map<std::string, LastKey> g_LastKeyBySym;
-static std::unordered_map<std::string, LastMenthorQ> g_LastMenthorQBySym;
-
-// ========== DÉTECTION DE CHANGEMENT ==========
-static inline bool has_changed(double a, double b, double eps=1e-9) {
-  return fabs(a-b) > eps;
-}
+static std::unordered_map<std::string, MenthorQTableState> g_MenthorQTableBySym;
 
 // ========== SYSTÈME DEBUG ==========
 enum LogLevel { LOG_ERROR = 0, LOG_KEY = 1, LOG_VERBOSE = 2 };
@@ -121,15 +61,10 @@ static inline bool ShouldLog(const SCStudyInterfaceRef& sc, int level) {
 }
 
 // ========== PRÉCISION PRIX DYNAMIQUE ==========
-static const char* get_price_format(double tick_size) {
-  static char format_buf[16];
-  if (tick_size >= 1.0) {
-    snprintf(format_buf, sizeof(format_buf), "%.2f");
-  } else {
-    int decimals = min(6, (int)std::ceil(-std::log10(tick_size)));
-    snprintf(format_buf, sizeof(format_buf), "%%.%df", decimals);
-  }
-  return format_buf;
+// Décimales d'affichage pour un tick size (calculé au changement de tick)
+static int PriceDecimals(double tick_size) {
+  if (tick_size >= 1.0 || tick_size <= 0.0) return 2;
+  return min(6, (int)std::ceil(-std::log10(tick_size)));
 }
 
 // Fonction de déduplication améliorée avec clé (symbol|chart)
@@ -147,16 +82,92 @@ static bool ShouldWriteData(const SCStudyInterfaceRef& sc, const char* symbol, d
   return !same_ti; // Écrire si différent
 }
 
-// Anti-duplication simple par (chart, type, key) - KEPT FOR COMPATIBILITY
-static void WriteIfChanged(int chartNumber, const char* dataType, const std::string& key, const SCString& line) {
-  static std::unordered_map<std::string, std::string> s_last_by_key;
-  auto it = s_last_by_key.find(key);
-  const std::string current = std::string(line.GetChars());
-  if (it != s_last_by_key.end() && it->second == current) {
-    return; // identique, on n'écrit pas
+// ========== TABLE DES NIVEAUX MENTHORQ ==========
+// Relève l'index i des subgraphs d'une famille dans un tableau empaqueté,
+// normalise en une passe vectorisée puis met à jour la table (valeur nulle,
+// non finie ou absente = niveau retiré)
+static void PollLevelGroup(SCStudyInterfaceRef& sc, MenthorQTableState& st, int group, int i) {
+  const int studyId = sc.Input[kGroupStudyInput[group]].GetInt();
+  int sgCount = studyId > 0 ? sc.Input[kGroupStudyInput[group] + 1].GetInt() : 0;
+  if (sgCount < 0) sgCount = 0;
+  if (sgCount > MiaLevelTable::kMaxPerGroup) sgCount = MiaLevelTable::kMaxPerGroup;
+
+  for (int sg = 0; sg < sgCount; ++sg) {
+    SCFloatArray arr;
+    st.raw[sg] = (ReadSubgraph(sc, studyId, sg, arr) && arr.GetArraySize() > i) ? arr[i] : 0.0f;
   }
-  WriteToSpecializedFile(chartNumber, dataType, line);
-  s_last_by_key[key] = current;
+  MiaNormalizeLevels(st.raw, sgCount, sc.RealTimePriceMultiplier, st.tick, st.ticks);
+  st.table.UpdateGroup(group, st.ticks, sgCount, st.changes);
+}
+
+// change: "snapshot", "added", "moved" (type menthorq_level) ou "removed"
+// (type menthorq_level_removed, ignoré par les lecteurs de niveaux actifs)
+static void EmitLevel(SCStudyInterfaceRef& sc, const MenthorQTableState& st, const char* change,
+                      const MiaLevel& l, const int64_t* prevTicks, double t, int i) {
+  const bool removed = strcmp(change, "removed") == 0;
+  const int studyId = sc.Input[kGroupStudyInput[l.group]].GetInt();
+  SCString name;
+  MenthorQLevelName(l.group, l.sg, name);
+  SCString j;
+  j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"%s\",\"level_type\":\"%s\",\"price\":%.*f,\"change\":\"%s\"",
+           t, sc.Symbol.GetChars(), removed ? "menthorq_level_removed" : "menthorq_level", name.GetChars(),
+           st.decimals, MiaTicksToPrice(l.ticks, st.tick), change);
+  if (prevTicks) j.AppendFormat(",\"prev_price\":%.*f", st.decimals, MiaTicksToPrice(*prevTicks, st.tick));
+  j.AppendFormat(",\"subgraph\":%d,\"study_id\":%d,\"i\":%d,\"chart\":%d}", l.sg, studyId, i, sc.ChartNumber);
+  WriteToSpecializedFile(sc.ChartNumber, "menthorq", j);
+}
+
+// ========== COURBE GEX (gex_1..gex_10, HVL, murs call / put) ==========
+// Reconstruit la table après un changement des niveaux gamma et l'écrit
+// dans le flux menthorq (HVL + ancrages [prix, poids de rang]; la courbe se
+// déduit par interpolation linéaire entre ancrages). MenthorQ ne publie pas
+// de montants: les poids ordonnent les niveaux, ce n'est pas une exposition
+static void RebuildGexCurve(SCStudyInterfaceRef& sc, MenthorQTableState& st, double t, int i) {
+  int64_t hvl = 0, callRes = 0, putSup = 0, gex[GEX_COUNT];
+  st.table.Get(MQ_GAMMA, GEX_SG_HVL, hvl);
+  st.table.Get(MQ_GAMMA, GEX_SG_CALL_RESISTANCE, callRes);
+  st.table.Get(MQ_GAMMA, GEX_SG_PUT_SUPPORT, putSup);
+  for (int k = 0; k < GEX_COUNT; ++k) {
+    gex[k] = 0;
+    st.table.Get(MQ_GAMMA, GEX_SG_FIRST + k, gex[k]);
+  }
+
+  const bool built = MiaGexAnchorsFromLevels(hvl, callRes, putSup, gex, GEX_COUNT, st.gex_anchors) &&
+                     st.gex.Build(st.gex_anchors, GEX_PAD_TICKS);
+  if (!built) st.gex.Clear();
+  st.gex_hvl = hvl;
+
+  SCString j;
+  j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"menthorq_gex\",\"ready\":%d,\"interp\":\"linear\",\"weights\":\"rank\"",
+           t, sc.Symbol.GetChars(), built ? 1 : 0);
+  if (hvl != 0) j.AppendFormat(",\"hvl\":%.*f", st.decimals, MiaTicksToPrice(hvl, st.tick));
+  else j += ",\"hvl\":null";
+  if (built) {
+    j.AppendFormat(",\"lo\":%.*f,\"hi\":%.*f", st.decimals, MiaTicksToPrice(st.gex.Lo(), st.tick), st.decimals,
+                   MiaTicksToPrice(st.gex.Hi(), st.tick));
+  }
+  j += ",\"anchors_format\":[\"price\",\"rank_weight\"],\"anchors\":[";
+  const std::vector<MiaGexAnchor>& a = st.gex.Anchors();
+  for (size_t k = 0; k < a.size(); ++k) {
+    j.AppendFormat("%s[%.*f,%.2f]", k ? "," : "", st.decimals, MiaTicksToPrice(a[k].ticks, st.tick), a[k].weight);
+  }
+  j.AppendFormat("],\"i\":%d,\"chart\":%d}", i, sc.ChartNumber);
+  WriteToSpecializedFile(sc.ChartNumber, "menthorq", j);
+}
+
+// Publication au bar courant au dernier prix: poids de rang (lookup O(1))
+// et régime HVL (+1 au-dessus, -1 en dessous, 0 dessus ou HVL absente)
+static void PublishGex(SCStudyInterfaceRef& sc, const MenthorQTableState& st, int i) {
+  if (!st.gex.Ready() || st.gex_hvl == 0) {
+    sc.Subgraph[GEX_OUT_RANK_WEIGHT][i] = 0.0f;
+    sc.Subgraph[GEX_OUT_HVL][i] = 0.0f;
+    sc.Subgraph[GEX_OUT_HVL_REGIME][i] = 0.0f;
+    return;
+  }
+  const int64_t px = MiaPriceToTicks(NormalizePx(sc, sc.BaseDataIn[SC_LAST][i]), st.tick);
+  sc.Subgraph[GEX_OUT_RANK_WEIGHT][i] = (float)st.gex.At(px);
+  sc.Subgraph[GEX_OUT_HVL][i] = (float)MiaTicksToPrice(st.gex_hvl, st.tick);
+  sc.Subgraph[GEX_OUT_HVL_REGIME][i] = (float)(px > st.gex_hvl ? 1 : (px < st.gex_hvl ? -1 : 0));
 }
 
 // ========== TIMER UTILITAIRE ==========
@@ -177,102 +188,6 @@ static inline bool ShouldEmitEveryNMinutes(const SCDateTime& now,
   return should_emit;
 }
 
-// ========== NORMALISATION DES PRIX ==========
-inline double NormalizePx(const SCStudyInterfaceRef& sc, double raw)
-{
-  // 1) Dé-multiplier si besoin
-  const double mult = (sc.RealTimePriceMultiplier != 0.0 ? sc.RealTimePriceMultiplier : 1.0);
-  double px = raw / mult;
-
-  // 2) Correction d'échelle avant arrondi (certains flux arrivent x100)
-  if (px > 10000.0) px /= 100.0;
-
-  // 3) Arrondi au tick
-  px = sc.RoundToTickSize(px, sc.TickSize);
-
-  // 4) Correction d'échelle résiduelle puis arrondi final (sécurité)
-  if (px > 10000.0) px /= 100.0;
-  px = sc.RoundToTickSize(px, sc.TickSize);
-  return px;
-}
-
-// ========== HELPERS D'ACCÈS AUX STUDIES ==========
-
-// Helper pour résoudre automatiquement un Study ID par nom
-static int ResolveStudyID(SCStudyInterfaceRef& sc, int chartNumber, const char* studyName, int fallbackID = 0) {
-  int id = sc.GetStudyIDByName(chartNumber, studyName, 0);
-  if (id <= 0 && fallbackID > 0) {
-    id = fallbackID;
-  }
-  return id;
-}
-
-// Helper pour lire un subgraph avec validation
-static bool ReadSubgraph(SCStudyInterfaceRef& sc, int studyID, int subgraphIndex, SCFloatArray& array, int chartNumber = -1) {
-  if (chartNumber > 0) {
-    sc.GetStudyArrayFromChartUsingID(chartNumber, studyID, subgraphIndex, array);
-    return array.GetArraySize() > 0;
-  } else {
-    sc.GetStudyArrayUsingID(studyID, subgraphIndex, array);
-    return array.GetArraySize() > 0;
-  }
-}
-
-// Helper pour valider qu'une étude a des données valides
-static bool ValidateStudyData(const SCFloatArray& array, int index) {
-  return array.GetArraySize() > index && !std::isnan(array[index]) && !std::isinf(array[index]);
-}
-
-// ========== DÉTECTION DE SUPPORT SEQUENCE ==========
-static void DetectSequenceSupport(const c_SCTimeAndSalesArray& TnS, bool& g_UseSeq)
-{
-    // Cherche un enregistrement avec Sequence > 0 (du plus récent au plus ancien)
-    for (int i = (int)TnS.Size() - 1; i >= 0 && i >= (int)TnS.Size() - 50; --i)
-    {
-        if (TnS[i].Sequence > 0)
-        {
-            g_UseSeq = true;
-            break;
-        }
-    }
-}
-
-// ========== CONSTANTES DE MAPPING ==========
-
-// VWAP Subgraphs (selon le mapping standard)
-#define VWAP_SG_MAIN 1
-#define VWAP_SG_UP1  2
-#define VWAP_SG_DN1  3
-#define VWAP_SG_UP2  4
-#define VWAP_SG_DN2  5
-#define VWAP_SG_UP3  6
-#define VWAP_SG_DN3  7
-
-// VVA Subgraphs (Volume Value Area) — indexation 0-based
-#define VVA_SG_POC 0
-#define VVA_SG_VAH 1
-#define VVA_SG_VAL 2
-
-// NBCV Subgraphs (Numbers Bars Calculated Values) — mapping confirmé
-// (Ask=5, Bid=6, Delta=0, Trades=11, CumDelta=9, TotalVol=12, Delta%=10, Ask%=16, Bid%=17)
-#define NBCV_SG_DELTA         0
-#define NBCV_SG_ASK_VOLUME    5
-#define NBCV_SG_BID_VOLUME    6
-#define NBCV_SG_TRADES        11
-#define NBCV_SG_CUMULATIVE     9
-#define NBCV_SG_TOTAL_VOLUME  12
-#define NBCV_SG_DELTA_PCT     10
-#define NBCV_SG_ASK_PCT       16
-#define NBCV_SG_BID_PCT       17
-
-// VIX Subgraph
-#define VIX_SG_LAST 4
-
-// MenthorQ Subgraphs
-#define MENTHORQ_GAMMA_SG_COUNT 19
-#define MENTHORQ_BLIND_SG_COUNT 10
-#define MENTHORQ_SWING_SG_COUNT 9
-
 // =======================================================================
 // ===============    STUDY ENTRYPOINT (G10 MENTHORQ)    =======================
 // =======================================================================
@@ -323,6 +238,24 @@ SCSFExport scsf_MIA_Dumper_G10_MenthorQ(SCStudyInterfaceRef sc)
     sc.Input[12].Name = "Correlation On New Bar Only (0/1)"; // 1 = par barre, 0 = timer intrabar
     sc.Input[12].SetInt(1);
 
+    // --- Table des niveaux: cadence de relecture ---
+    sc.Input[13].Name = "MenthorQ Poll Interval (min, 0=Each Bar)";
+    sc.Input[13].SetInt(15);
+
+    // --- Poids de rang GEX et régime HVL publiés dans le processus ---
+    sc.Subgraph[GEX_OUT_RANK_WEIGHT].Name = "GEX Rank Weight";
+    sc.Subgraph[GEX_OUT_RANK_WEIGHT].DrawStyle = DRAWSTYLE_IGNORE;
+    sc.Subgraph[GEX_OUT_HVL].Name = "HVL";
+    sc.Subgraph[GEX_OUT_HVL].DrawStyle = DRAWSTYLE_IGNORE;
+    sc.Subgraph[GEX_OUT_HVL_REGIME].Name = "HVL Regime (+1/-1)";
+    sc.Subgraph[GEX_OUT_HVL_REGIME].DrawStyle = DRAWSTYLE_IGNORE;
+
+    return;
+  }
+
+  // Dernier appel: vider la file du writer partagé
+  if (sc.LastCallToFunction) {
+    MiaGetWriter()->Flush();
     return;
   }
 
@@ -337,121 +270,67 @@ SCSFExport scsf_MIA_Dumper_G10_MenthorQ(SCStudyInterfaceRef sc)
     const SCDateTime now = sc.CurrentSystemDateTime;
     const bool on_bar = (sc.Input[12].GetInt() != 0);
     
-    // Timers statiques par type
-    static SCDateTime s_last_gamma_emit(0.0);
-    static SCDateTime s_last_blind_emit(0.0);
-    static SCDateTime s_last_corr_emit(0.0);
-    
-    // ========== GAMMA LEVELS ==========
-    const int gamma_min = 15; // 15 minutes fixe
-    
-    // Debug logging
-    if (ShouldLog(sc, LOG_KEY)) {
-      SCString debugMsg;
-      debugMsg.Format("DEBUG: Gamma timer check - on_bar:%s, bar_closed:%s, gamma_min:%d", 
-                     on_bar ? "true" : "false",
-                     (sc.GetBarHasClosedStatus(i) == BHCS_BAR_HAS_CLOSED) ? "true" : "false",
-                     gamma_min);
-      DebugLog(sc, debugMsg.GetChars());
+    // ========== GAMMA / BLIND SPOTS / SWING (table triée, changements seulement) ==========
+    std::string symKey = std::string(sc.Symbol.GetChars()) + "|" + std::to_string(sc.ChartNumber);
+    MenthorQTableState& st = g_MenthorQTableBySym[symKey];
+    const double tick = MiaTickSize(sc);
+    if (tick != st.tick) {
+      // Nouveau tick size: table et précision recalculées, snapshot complet
+      st.tick = tick;
+      st.decimals = PriceDecimals(tick);
+      st.table.Reset();
+      st.snapshot_date = 0;
+      st.snapshot_file_date = 0;
     }
-    
-    // Condition assouplie : émettre si pas de barre OU barre fermée
-    bool can_emit_gamma = !on_bar || (sc.GetBarHasClosedStatus(i) == BHCS_BAR_HAS_CLOSED);
-    if (can_emit_gamma && ShouldEmitEveryNMinutes(now, s_last_gamma_emit, gamma_min)) {
 
-      // Boucle Gamma Levels (SG0-18)
-      const int gamma_study_id = sc.Input[1].GetInt();
-      const int gamma_sg_count = sc.Input[2].GetInt();
-      const double t = tbar.GetAsDouble();
-      const char* symbol = sc.Symbol.GetChars();
-      
-      for (int sg = 0; sg < gamma_sg_count; ++sg) {
-        SCFloatArray arr;
-        if (ReadSubgraph(sc, gamma_study_id, sg, arr) && arr.GetArraySize() > i) {
-          double val = arr[i];
-          if (ShouldLog(sc, LOG_KEY)) {
-            SCString debugMsg;
-            debugMsg.Format("DEBUG: Gamma SG%d - val:%.2f, finite:%s", sg, val, std::isfinite(val) ? "true" : "false");
-            DebugLog(sc, debugMsg.GetChars());
-          }
-          if (std::isfinite(val) && val > 0.0) {
-            double p = NormalizePx(sc, val);
-            SCString levelType;
-            switch(sg) {
-              case 0: levelType = "call_resistance"; break;
-              case 1: levelType = "put_support"; break;
-              case 2: levelType = "hvl"; break;
-              case 3: levelType = "1d_min"; break;
-              case 4: levelType = "1d_max"; break;
-              case 5: levelType = "call_resistance_0dte"; break;
-              case 6: levelType = "put_support_0dte"; break;
-              case 7: levelType = "hvl_0dte"; break;
-              case 8: levelType = "gamma_wall_0dte"; break;
-              case 9: levelType = "gex_1"; break;
-              case 10: levelType = "gex_2"; break;
-              case 11: levelType = "gex_3"; break;
-              case 12: levelType = "gex_4"; break;
-              case 13: levelType = "gex_5"; break;
-              case 14: levelType = "gex_6"; break;
-              case 15: levelType = "gex_7"; break;
-              case 16: levelType = "gex_8"; break;
-              case 17: levelType = "gex_9"; break;
-              case 18: levelType = "gex_10"; break;
-              default: levelType.Format("gamma_sg_%d", sg); break;
-            }
-            
-            const char* price_fmt = get_price_format(sc.TickSize);
-            SCString j;
-            j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"menthorq_level\",\"level_type\":\"%s\",\"price\":",
-                     t, symbol, levelType.GetChars());
-            j += SCString().Format(price_fmt, p);
-            j += SCString().Format(",\"subgraph\":%d,\"study_id\":%d,\"i\":%d,\"chart\":%d}",
-                                   sg, gamma_study_id, i, sc.ChartNumber);
-            WriteToSpecializedFile(sc.ChartNumber, "menthorq", j);
-          }
-        }
-      }
+    // Input 13: intervalle en minutes, 0 = à chaque nouveau bar
+    const int poll_min = sc.Input[13].GetInt();
+    bool poll;
+    if (poll_min <= 0) {
+      poll = (i != st.last_polled_bar);
+    } else {
+      // Condition assouplie : émettre si pas de barre OU barre fermée
+      const bool can_emit = !on_bar || (sc.GetBarHasClosedStatus(i) == BHCS_BAR_HAS_CLOSED);
+      poll = can_emit && ShouldEmitEveryNMinutes(now, st.last_poll, poll_min);
     }
-    
-    // ========== BLIND SPOTS ==========
-    const int blind_min = 15; // 15 minutes fixe
-    
-    // Debug logging
-    if (ShouldLog(sc, LOG_KEY)) {
-      SCString debugMsg;
-      debugMsg.Format("DEBUG: Blind timer check - blind_min:%d", blind_min);
-      DebugLog(sc, debugMsg.GetChars());
-    }
-    
-    // Condition assouplie : émettre si pas de barre OU barre fermée
-    bool can_emit_blind = !on_bar || (sc.GetBarHasClosedStatus(i) == BHCS_BAR_HAS_CLOSED);
-    if (can_emit_blind && ShouldEmitEveryNMinutes(now, s_last_blind_emit, blind_min)) {
-      const int blind_study_id = sc.Input[3].GetInt();
-      const int blind_sg_count = sc.Input[4].GetInt();
+
+    if (poll) {
+      st.last_polled_bar = i;
+      st.changes.clear();
+      PollLevelGroup(sc, st, MQ_GAMMA, i);
+      PollLevelGroup(sc, st, MQ_BLIND, i);
+      PollLevelGroup(sc, st, MQ_SWING, i);
+
       const double t = tbar.GetAsDouble();
-      const char* symbol = sc.Symbol.GetChars();
-      
-      for (int sg = 0; sg < blind_sg_count; ++sg) {
-        SCFloatArray arr;
-        if (ReadSubgraph(sc, blind_study_id, sg, arr) && arr.GetArraySize() > i) {
-          double val = arr[i];
-          if (std::isfinite(val) && val > 0.0) { // N'écrire que si val > 0
-            double p = NormalizePx(sc, val);
-            SCString levelType;
-            levelType.Format("blind_spot_%d", sg);
-            
-            const char* price_fmt = get_price_format(sc.TickSize);
-            SCString j;
-            j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"menthorq_level\",\"level_type\":\"%s\",\"price\":",
-                     t, symbol, levelType.GetChars());
-            j += SCString().Format(price_fmt, p);
-            j += SCString().Format(",\"subgraph\":%d,\"study_id\":%d,\"i\":%d,\"chart\":%d}",
-                                   sg, blind_study_id, i, sc.ChartNumber);
-            WriteToSpecializedFile(sc.ChartNumber, "menthorq", j);
-          }
+      const int date = MiaSessionDay(sc, tbar);
+      const int fileDate = MiaToday().AsInt();
+      bool gammaChanged = false;
+      for (const MiaLevelChange& c : st.changes) gammaChanged |= (c.level.group == MQ_GAMMA);
+      if (date != st.snapshot_date || fileDate != st.snapshot_file_date) {
+        // Début de session, nouveau fichier du jour (minuit local en cours
+        // de session) ou premier relevé: tous les niveaux présents, pour que
+        // chaque fichier se relise seul
+        st.snapshot_date = date;
+        st.snapshot_file_date = fileDate;
+        gammaChanged = true;
+        for (const MiaLevel& l : st.table.Sorted()) EmitLevel(sc, st, "snapshot", l, NULL, t, i);
+      } else {
+        for (const MiaLevelChange& c : st.changes) {
+          if (c.kind == MIA_LEVEL_ADDED) EmitLevel(sc, st, "added", c.level, NULL, t, i);
+          else if (c.kind == MIA_LEVEL_MOVED) EmitLevel(sc, st, "moved", c.level, &c.prev_ticks, t, i);
+          else EmitLevel(sc, st, "removed", c.level, NULL, t, i);
         }
       }
+      if (gammaChanged) RebuildGexCurve(sc, st, t, i);
+
+      if (ShouldLog(sc, LOG_KEY)) {
+        SCString debugMsg;
+        debugMsg.Format("DEBUG: MenthorQ poll - levels:%d, changes:%d",
+                        (int)st.table.Sorted().size(), (int)st.changes.size());
+        DebugLog(sc, debugMsg.GetChars());
+      }
     }
+    PublishGex(sc, st, i);
   }
 
   // ========== CORRÉLATION ==========
@@ -1,124 +1,29 @@
-// === MIA_Dumper_G3_Core.cpp (header inlined - Approach 1) ===
-// Utilities previously in "mia_dump_utils.hpp" are embedded below to allow
-// single-file remote builds on Sierra Chart.
-
-#include "sierrachart.h"
-#ifdef _WIN32
-  #include <windows.h>
-#endif
-#include <time.h>
-#include <cmath>
-#include <unordered_map>
-#include <string>
-#include <vector>
+// === MIA_Dumper_G3_Core.cpp ===
+// Utilitaires communs (écriture, chemins, prix, sérialisation, métriques)
+// fournis par "mia_dump_utils.hpp" et le runtime partagé mia_runtime\.
+
+#include "mia_dump_utils.hpp"
+#include "mia_engines/mia_l2_book.hpp"
+#include "mia_engines/mia_of_features.hpp"
+#include "mia_engines/mia_footprint.hpp"
+#include "mia_engines/mia_depthbar_codec.hpp"
+#include "mia_engines/mia_meta_trade.hpp"
+#include "mia_engines/mia_absorption.hpp"
+#include "mia_engines/mia_trade_flow.hpp"
+#include "mia_engines/mia_quantile.hpp"
+#include "mia_engines/mia_vpin.hpp"
+#include "mia_engines/mia_kernels.hpp"
+#include "mia_engines/mia_rollup.hpp"
+#include "mia_engines/mia_trade_bars.hpp"
+#include "mia_engines/mia_time_grid.hpp"
+#include "mia_engines/mia_level_proximity.hpp"
 #include <algorithm>
-using std::fabs;
 
 SCDLLName("MIA_Dumper_G3_Core")
 
-// ========== UTILITAIRES COMMUNS ==========
-
-// Création du répertoire de sortie organisé
-static void EnsureOutDir() {
-#ifdef _WIN32
-  CreateDirectoryA("D:\\MIA_IA_system", NULL);
-  CreateDirectoryA("D:\\MIA_IA_system\\DATA_SIERRA_CHART", NULL);
-#endif
-}
-
-// Création de la structure de répertoires organisée
-static void EnsureOrganizedDir(int chartNumber) {
-#ifdef _WIN32
-  time_t now = time(NULL);
-  struct tm* lt = localtime(&now);
-  int y = lt ? (lt->tm_year + 1900) : 1970;
-  int m = lt ? (lt->tm_mon + 1) : 1;
-  int d = lt ? lt->tm_mday : 1;
-  
-  // Noms des mois
-  const char* monthNames[] = {"JANVIER", "FEVRIER", "MARS", "AVRIL", "MAI", "JUIN",
-                             "JUILLET", "AOUT", "SEPTEMBRE", "OCTOBRE", "NOVEMBRE", "DECEMBRE"};
-  
-  char basePath[512];
-  char yearPath[512];
-  char monthPath[512];
-  char dayPath[512];
-  char chartPath[512];
-  
-  sprintf(basePath, "D:\\MIA_IA_system\\DATA_SIERRA_CHART");
-  sprintf(yearPath, "%s\\DATA_%d", basePath, y);
-  sprintf(monthPath, "%s\\%s", yearPath, monthNames[m-1]);
-  sprintf(dayPath, "%s\\%04d%02d%02d", monthPath, y, m, d);
-  sprintf(chartPath, "%s\\CHART_%d", dayPath, chartNumber);
-  
-  CreateDirectoryA(basePath, NULL);
-  CreateDirectoryA(yearPath, NULL);
-  CreateDirectoryA(monthPath, NULL);
-  CreateDirectoryA(dayPath, NULL);
-  CreateDirectoryA(chartPath, NULL);
-#endif
-}
-
-// Génération du nom de fichier quotidien par chart et type dans la structure organisée
-static SCString DailyFilenameForChartType(int chartNumber, const char* dataType) {
-  time_t now = time(NULL);
-  struct tm* lt = localtime(&now);
-  int y = lt ? (lt->tm_year + 1900) : 1970;
-  int m = lt ? (lt->tm_mon + 1) : 1;
-  int d = lt ? lt->tm_mday : 1;
-  
-  // Noms des mois
-  const char* monthNames[] = {"JANVIER", "FEVRIER", "MARS", "AVRIL", "MAI", "JUIN",
-                             "JUILLET", "AOUT", "SEPTEMBRE", "OCTOBRE", "NOVEMBRE", "DECEMBRE"};
-  
-  SCString filename;
-  filename.Format("D:\\MIA_IA_system\\DATA_SIERRA_CHART\\DATA_%d\\%s\\%04d%02d%02d\\CHART_%d\\chart_%d_%s_%04d%02d%02d.jsonl", 
-                  y, monthNames[m-1], y, m, d, chartNumber, chartNumber, dataType, y, m, d);
-  return filename;
-}
-
-// Écriture dans le fichier spécialisé avec structure organisée
-static void WriteToSpecializedFile(int chartNumber, const char* dataType, const SCString& line) {
-  EnsureOutDir();
-  EnsureOrganizedDir(chartNumber);  // Créer la structure de répertoires
-  const SCString filename = DailyFilenameForChartType(chartNumber, dataType);
-  FILE* f = fopen(filename.GetChars(), "a");
-  if (f) { 
-    fprintf(f, "%s\n", line.GetChars()); 
-    fclose(f); 
-  }
-}
-
-// Crée/touche un fichier quotidien vide si besoin avec structure organisée
-static void TouchDailyFile(int chartNumber, const char* dataType) {
-  EnsureOutDir();
-  EnsureOrganizedDir(chartNumber);  // Créer la structure de répertoires
-  const SCString filename = DailyFilenameForChartType(chartNumber, dataType);
-  FILE* f = fopen(filename.GetChars(), "a");
-  if (f) fclose(f);
-}
-
-// Écriture dans le fichier de debug local UNIQUE
-static void WriteToDebugFile(const SCString& debugLine) {
-  EnsureOutDir();
-  time_t now = time(NULL);
-  struct tm* lt = localtime(&now);
-  int y = lt ? (lt->tm_year + 1900) : 1970;
-  int m = lt ? (lt->tm_mon + 1) : 1;
-  int d = lt ? lt->tm_mday : 1;
-  
-  // UN SEUL FICHIER DE DEBUG PAR JOUR
-  SCString debugFilename;
-  debugFilename.Format("D:\\MIA_IA_system\\debug_g3_%04d%02d%02d.log", y, m, d);
-  
-  FILE* f = fopen(debugFilename.GetChars(), "a");
-  if (f) { 
-    fprintf(f, "%s\n", debugLine.GetChars()); 
-    fclose(f); 
-  }
-}
+// ========== DEBUG LOCAL ==========
 
-// Fonction de debug combinée (Sierra + fichier local)
+// Fonction de debug combinée (Sierra + fichier local UNIQUE par jour, via le writer partagé)
 static void DebugLog(SCStudyInterfaceRef& sc, const char* message) {
   // Log dans Sierra Chart
   sc.AddMessageToLog(message, 1);
@@ -130,9 +35,15 @@ static void DebugLog(SCStudyInterfaceRef& sc, const char* message) {
   int min = lt ? lt->tm_min : 0;
   int s = lt ? lt->tm_sec : 0;
   
+  // Préfixe chart/symbole: plusieurs instances partagent le même fichier de debug
   SCString debugLine;
-  debugLine.Format("[%02d:%02d:%02d] %s", h, min, s, message);
-  WriteToDebugFile(debugLine);
+  debugLine.Format("[%02d:%02d:%02d] [C%d %s] %s", h, min, s, sc.ChartNumber, sc.Symbol.GetChars(), message);
+
+  const MiaDate today = MiaToday();
+  char debugFilename[256];
+  snprintf(debugFilename, sizeof(debugFilename), "%s\\debug_g3_%04d%02d%02d.log",
+           MIA_DEFAULT_BASE_DIR, today.y, today.m, today.d);
+  MiaGetWriter()->Append(debugFilename, debugLine.GetChars(), (size_t)debugLine.GetLength(), MIA_PRIO_STUDY, NULL);
 }
 
 // ========== NIVEAUX DE LOG ==========
@@ -155,12 +66,6 @@ static inline bool ShouldLog(const SCStudyInterfaceRef& sc, int level) {
 
 
 // ========== DÉDUPLICATION INTELLIGENTE AMÉLIORÉE ==========
-// Structure pour la déduplication par (sym, t, i)
-struct LastKey { 
-  double t = 0.0; // timestamp
-  double i = -1;  // bar index
-};
-
 // Structures pour la détection de changement d'état
 struct LastBasedata {
   double c=0, o=0, h=0, l=0;
@@ -181,23 +86,13 @@ struct LastNBCV {
   int pressure=0;
 };
 
-// Maps de déduplication par symbole
-static std::unordered_map<std::string, LastKey> g_LastKeyBySym;
-static std::unordered_map<std::string, LastBasedata> g_LastBaseBySym;
-static std::unordered_map<std::string, LastVWAP> g_LastVWAPBySym;
-static std::unordered_map<std::string, LastVVA> g_LastVVABySym;
-static std::unordered_map<std::string, LastNBCV> g_LastNBCVBySym;
-
 // Cache pour Cumulative Delta
 struct LastCD { double close=0.0; };
-static std::unordered_map<std::string, LastCD> g_LastCDBySym;
 
 // Caches supplémentaires: ATR et Correlation
 struct LastATR { double atr=0.0; };
-static std::unordered_map<std::string, LastATR> g_LastATRBySym;
 
 struct LastCorr { double cc=0.0; };
-static std::unordered_map<std::string, LastCorr> g_LastCorrBySym;
 
 // ========== COALESCE INTRABAR (Option C) + SEQ MODE (Option D) ==========
 struct BufPayload {
@@ -207,8 +102,238 @@ struct BufPayload {
   SCString dataType; // Added to store dataType for flush
 };
 
-static std::unordered_map<std::string, BufPayload> g_CoalesceBufByKey; // key: sym|type
-static std::unordered_map<std::string, uint32_t> g_SeqByKey;           // key: sym|type|i
+// ========== CONFLATION TEMPORELLE DU DOM ==========
+// Les changements de niveaux sont accumulés pendant la fenêtre (Input[36] ms);
+// une seule ligne "depth_conflated" est émise par fenêtre, avec uniquement
+// les niveaux modifiés, leur dernier état et leur nombre de changements.
+struct DepthLevelAcc {
+  double price = 0.0;
+  int size = 0;
+  int changes = 0;   // 0 = niveau inchangé dans la fenêtre
+};
+
+struct DepthWindow {
+  DepthLevelAcc bid[256];
+  DepthLevelAcc ask[256];
+  int total_changes = 0;
+  int64_t last_emit_ms = 0;
+  int header_window_ms = -1;  // cadence déclarée dans l'en-tête du fichier
+};
+
+// ========== CARNET COMPLET + DIFFS (depth_book) ==========
+// Snapshot complet du ladder toutes les Input[37] secondes (et au premier
+// appel, à chaque nouveau jour), diffs add/modify/delete par prix entre les
+// deux (produits par MiaL2Book::Apply). Chaque ligne porte "bseq",
+// strictement croissant sur la journée: un trou signale une ligne perdue.
+struct DepthBook {
+  std::vector<MiaBookDiff> ops;
+  uint64_t bseq = 0;
+  int64_t last_snapshot_ms = 0;
+  int snapshot_date = 0;
+  int header_interval_s = -1;
+};
+
+// ========== FEATURES ORDER FLOW (of_features) ==========
+// OFI, microprice, déséquilibres et spread mis à jour à chaque application
+// du carnet; une ligne "of_features" au plus toutes les Input[38] ms, et
+// seulement si le haut de carnet a bougé pendant la fenêtre.
+struct OfFeaturesState {
+  MiaOrderFlowFeatures engine;
+  int64_t last_emit_ms = 0;
+  int session_date = 0;
+  int header_interval_ms = -1;
+};
+
+// ========== FOOTPRINT (VAP PAR BAR) ==========
+// Le VAP du bar en cours est parcouru au plus toutes les Input[40] ms; seules
+// les lignes de prix modifiées sont émises tant que le bar est ouvert, puis
+// toutes les lignes à la clôture. Prix encodés en delta de ticks.
+struct FootprintState {
+  MiaFootprintTracker tracker;
+  int64_t last_scan_ms = 0;
+  int header_interval_ms = -1;
+};
+
+// ========== BARS DE PROFONDEUR HISTORIQUE (c_ACSILDepthBars) ==========
+// Un enregistrement binaire par bar (quantités max bid/ask par tick, RLE de
+// deltas) dans chart_3_depthbars_yyyymmdd.bin. Bar en cours réexporté toutes
+// les Input[43] s, bar clos exporté une fois; rattrapage des Input[42]
+// derniers bars au démarrage (Input[41] = 2), borné par appel.
+#define DEPTHBARS_BACKFILL_PER_CALL 20
+
+struct DepthBarsState {
+  MiaDepthBarRecord rec;
+  std::string buf;
+  int live_bar = -1;
+  int64_t last_live_ms = 0;
+  int backfill_next = -1;      // prochain bar à rattraper (-1 = rien)
+  int backfill_end = -1;       // exclu
+  double last_closed_t = 0.0;  // dernier bar clos exporté (persisté)
+  bool header_set = false;
+};
+
+// ========== ABSORPTION / ICEBERGS ==========
+// Prints T&S imputés au niveau passif du carnet L2: taille affichée lue
+// dans le ladder de l'appel précédent (avant le print), comparée au carnet
+// courant à la fin du lot T&S. Événements émis dans
+// chart_3_absorption_yyyymmdd.jsonl (Input[45..47]); épisodes remis à zéro
+// à chaque nouvelle session.
+struct AbsorptionState {
+  MiaAbsorptionDetector engine;
+  MiaLadder before;  // ladder observé à l'appel précédent (avant l'Apply courant)
+  std::vector<MiaAbsorptionEvent> events;
+  int session_date = 0;
+  int64_t header_min_vol = -1;
+  int64_t header_min_hidden = -1;
+  int header_min_refills = -1;
+};
+
+// ========== AGRÉGATS DE FLUX GLISSANTS (trade_summary) ==========
+// BUY/SELL (nombre, volume, delta) sur 1 s / 10 s / 60 s / 5 min et cumul de
+// session, remis à zéro au changement de jour de session (MiaSessionDay).
+// Les fenêtres glissent sur l'horloge des prints (T&S), prolongée par le
+// temps écoulé depuis le dernier print traité. Émis toutes les Input[48] ms;
+// lisibles en process via ctx.trade_flow.engine.
+struct TradeFlowState {
+  MiaTradeFlowWindows engine;
+  int session_day = 0;         // jour de session des derniers prints
+  int64_t last_print_ms = 0;   // horodatage T&S du dernier print (ms)
+  int64_t last_print_steady = 0;  // MiaSteadyMs() au traitement de ce print
+  int64_t last_emit_ms = 0;
+  int header_interval_ms = -1;
+};
+
+// ========== GROS LOTS (large_trades) ==========
+// Distribution des tailles de trades estimée en flux (P²) par symbole et par
+// session; chaque trade porte son percentile ("pct") et les prints au-delà
+// du quantile Input[49] sont recopiés dans large_trades.
+#define LARGE_TRADES_WARMUP 200  // trades avant la première émission
+
+struct LargeTradesState {
+  MiaP2Quantiles sizes;
+  int session_day = 0;
+  float header_pct = -1.0f;
+};
+
+// ========== VPIN (vpin) ==========
+// Buckets de volume Input[50] remplis par les trades classés, fenêtre de
+// Input[51] buckets; une ligne par bucket complet, remise à zéro au
+// changement de jour de session.
+struct VpinState {
+  MiaVpin engine;
+  std::vector<MiaVpinBucket> done;
+  int session_day = 0;
+  int cfg_bucket_vol = -1;
+  int cfg_window = -1;
+};
+
+// ========== INDICATEURS NATIFS (ATR, CORRÉLATION) ==========
+// Noyaux mia_kernels.hpp alimentés par les bars du chart (Input[52] = 1):
+// état engagé sur les bars clos (O(1) par bar), bar en cours évalué par
+// Peek. Reconstruction (batch ATR sur l'historique, 'period' derniers bars
+// pour la corrélation) au premier appel, au changement de paramètres ou si
+// le chart a été rechargé.
+struct NativeKernelsState {
+  MiaWilderAtr atr;
+  int atr_bar = -1;          // dernier bar clos engagé
+  int atr_period = -1;
+  MiaRollingCorr corr;
+  int corr_bar = -1;
+  int corr_period = -1;
+  int corr_chart = -1;
+  std::vector<float> h, l, c;
+  std::vector<double> out;
+};
+
+// ========== AGRÉGATION MULTI-UNITÉS DE TEMPS (rollup) ==========
+// Bars 5/15/30/60 min construits à partir des bars 1 min clos du chart 3
+// (remplace la lecture des études du chart 4 par G4). Au chargement, les
+// ROLLUP_BACKFILL_BARS derniers bars reconstruisent les bars en cours sans
+// réémettre les intervalles déjà clos.
+#define ROLLUP_BASE_MINUTES 1
+#define ROLLUP_BACKFILL_BARS 240
+
+struct RollupState {
+  MiaBarRollup engine;
+  std::vector<MiaRollupBar> closed;
+  int last_fed = -1;         // dernier bar 1 min clos intégré
+  bool header_set = false;
+};
+
+// ========== BARS TICK / VOLUME / RANGE (bars_tick, bars_volume, bars_range) ==========
+// Construits en parallèle depuis les trades classés de ProcessTS; seuils
+// Input[57..59] (0 = type désactivé), une ligne par bar clos et par type.
+struct TradeBarsState {
+  MiaTradeBarBuilder builders[3];     // indexés par MiaTradeBarKind
+  int thresholds[3] = {-1, -1, -1};   // seuils appliqués (-1 = non initialisé)
+};
+
+// ========== SNAPSHOT CONSOLIDÉ PAR BAR (bar_snapshot) ==========
+// Chaque section (basedata, vwap, vva, nbcv, cumulative_delta, atr, vix)
+// recopie ses dernières valeurs du bar courant ici, indépendamment de sa
+// propre déduplication, et note sa source; à l'apparition d'un nouveau bar,
+// le bar précédent est relu dans BaseDataIn et les études à son index (les
+// derniers prints du bar arrivent après le dernier passage des sections)
+// puis écrit en une seule ligne (Input[60]). Champ absent = null.
+enum BarSnapshotField {
+  SNAP_BASE = 1, SNAP_VWAP = 2, SNAP_VVA = 4, SNAP_NBCV = 8, SNAP_CD = 16, SNAP_ATR = 32, SNAP_VIX = 64
+};
+
+struct BarSnapshot {
+  int bar = -1;
+  double t = 0.0;
+  unsigned have = 0;  // BarSnapshotField
+  double o = 0, h = 0, l = 0, c = 0, v = 0, bidvol = 0, askvol = 0;
+  double vwap = 0, up1 = 0, dn1 = 0, up2 = 0, dn2 = 0, up3 = 0, dn3 = 0;
+  double vah = 0, val = 0, vpoc = 0, pvah = 0, pval = 0, ppoc = 0;
+  double nbcv_ask = 0, nbcv_bid = 0, nbcv_delta = 0, nbcv_trades = 0, nbcv_cum = 0;
+  int pressure = 0;
+  double cum_delta = 0, atr = 0, vix = 0;
+};
+
+// Sources résolues par les sections, relues à la barrière au bar enregistré
+// (0 = source jamais résolue)
+struct BarSnapshotSources {
+  int vwap_id = 0, vwap_bands = 0;
+  int vva_curr = 0, vva_prev = 0;
+  int nbcv_id = 0;
+  int cd_id = 0, cd_sg = 0;
+  int atr_id = 0, atr_sg = 0;
+  bool atr_native = false;
+  int vix_id = 0, vix_sg = 0;
+};
+
+struct BarSnapshotState {
+  BarSnapshot cur;
+  BarSnapshotSources src;
+  bool header_set = false;
+};
+
+// ========== GRILLE TEMPORELLE À PAS FIXE (flux grid) ==========
+// Trades et BBO avancent la grille; VWAP/VVA/NBCV/VIX sont appliqués comme
+// "connus maintenant". Une ligne par point de grille (colonnes du header).
+#define TIME_GRID_MAX_FILL_MS 300000  // trou plus long: pas de remplissage
+
+struct TimeGridState {
+  MiaTimeGrid grid;
+  std::vector<MiaGridRow> rows;
+  int step_ms = -1;
+};
+
+// ========== PROXIMITÉ DES NIVEAUX MENTHORQ (flux level_events) ==========
+// Gamma Levels et Blind Spots relus sur le chart MenthorQ à chaque nouveau
+// bar; chaque trade est situé par dichotomie entre ses niveaux voisins.
+struct LevelProximityState {
+  MiaLevelTable table;
+  MiaLevelProximity prox;
+  std::vector<MiaLevelChange> changes;
+  std::vector<MiaProximityEvent> events;
+  float raw[MiaLevelTable::kMaxPerGroup];
+  int64_t ticks[MiaLevelTable::kMaxPerGroup];
+  int last_polled_bar = -1;
+  int touch = -1, half = -1;  // configuration appliquée au moteur
+  bool header_set = false;
+};
 
 // ========== MÉTRIQUES DE PERFORMANCE ==========
 struct PerformanceMetrics {
@@ -225,8 +350,6 @@ struct PerformanceMetrics {
     int bars_since_flush = 0;
 };
 
-static PerformanceMetrics g_metrics;
-
 // ========== MÉTRIQUES DE QUALITÉ DES DONNÉES ==========
 struct DataQualityMetrics {
     int duplicate_detected = 0;
@@ -235,7 +358,109 @@ struct DataQualityMetrics {
     int timestamp_anomalies = 0;
 };
 
-static DataQualityMetrics g_quality;
+
+// ========== CONTEXTE PAR INSTANCE D'ÉTUDE ==========
+// Tout l'état vit ici, alloué via sc.GetPersistentPointer/SetPersistentPointer:
+// la même DLL peut tourner sur plusieurs charts/symboles (ES, NQ, RTY, YM)
+// sans partage d'état ni de métriques entre instances.
+struct G3Context {
+  // Maps de déduplication par symbole
+  std::unordered_map<std::string, LastKey> last_key_by_sym;
+  std::unordered_map<std::string, LastKey> last_key_by_sym_type;   // key: sym|type
+  std::unordered_map<std::string, LastBasedata> last_base_by_sym;
+  std::unordered_map<std::string, LastVWAP> last_vwap_by_sym;
+  std::unordered_map<std::string, LastVVA> last_vva_by_sym;
+  std::unordered_map<std::string, LastNBCV> last_nbcv_by_sym;
+  std::unordered_map<std::string, LastCD> last_cd_by_sym;
+  std::unordered_map<std::string, LastATR> last_atr_by_sym;
+  std::unordered_map<std::string, LastCorr> last_corr_by_sym;
+  std::unordered_map<std::string, double> last_vix_by_sym;
+
+  // Coalesce intrabar + seq mode
+  std::unordered_map<std::string, BufPayload> coalesce_buf_by_key; // key: sym|type
+  std::unordered_map<std::string, uint32_t> seq_by_key;            // key: sym|type|i
+
+  // Métriques
+  PerformanceMetrics metrics;
+  DataQualityMetrics quality;
+
+  // Curseurs T&S (reprise par séquence ou par index/temps)
+  int        last_ts_index = 0;
+  uint32_t   last_seq      = 0;
+  SCDateTime last_ts_time  = SCDateTime(0.0);
+  int64_t    last_ts_steady_ms = 0;  // MiaSteadyMs() quand last_ts_time a avancé
+  double     last_market_t = 0.0;    // dernier MarketTimeNow() (non décroissant)
+  bool       use_seq       = false;
+  bool       seq_checked   = false;
+  bool       ts_restored   = false;  // reprise après chargement d'un checkpoint
+  int        stale_loops   = 0;
+
+  // Carnet L2 (source unique des sorties depth) + ladder interrogé
+  MiaL2Book book;
+  MiaLadder dom_ladder;
+
+  // Conflation temporelle du DOM
+  DepthWindow depth_window;
+
+  // Carnet complet + diffs numérotés
+  DepthBook depth_book;
+
+  // Features order flow dérivées du carnet
+  OfFeaturesState of_features;
+
+  // Footprint du bar en cours
+  FootprintState footprint;
+
+  // Profondeur historique par bar
+  DepthBarsState depth_bars;
+
+  // Agrégation des sweeps (flux trade_meta)
+  MiaMetaTradeAggregator meta_trades;
+
+  // Détection d'absorption / icebergs (trades x carnet)
+  AbsorptionState absorption;
+
+  // Résumé BUY/SELL sur fenêtres glissantes + session
+  TradeFlowState trade_flow;
+
+  // Quantiles des tailles de trades (large_trades)
+  LargeTradesState large_trades;
+
+  // Toxicité du flux (VPIN)
+  VpinState vpin;
+
+  // ATR / corrélation natifs
+  NativeKernelsState kernels;
+
+  // Bars 5/15/30/60 min
+  RollupState rollup;
+
+  // Bars tick / volume / range depuis le T&S
+  TradeBarsState trade_bars;
+
+  // Valeurs du bar courant pour bar_snapshot
+  BarSnapshotState bar_snap;
+
+  // Grille forward-fill à pas fixe
+  TimeGridState time_grid;
+
+  // Niveaux MenthorQ du chart 10 + événements touch / cross
+  LevelProximityState level_prox;
+
+  // Filtrage des volumes (stats fenêtre 100 barres)
+  double volume_median = 0.0;
+  double volume_iqr = 0.0;
+
+  // Résolution des études / exécutions uniques
+  int  vwap_id = -2; // -2: à résoudre, -1: introuvable, >0: OK
+  bool vva_ids_logged = false;
+  int  last_pvwap_bar = -1;
+  bool pvwap_executed_today = false;
+  bool startup_logged = false;
+
+  time_t last_checkpoint = 0;
+  time_t last_metrics_emit = 0;
+};
 
 static inline std::string MakeBufKey(int chart, const char* sym, const char* type) {
   return std::to_string(chart) + "|" + std::string(sym) + "|" + std::string(type);
@@ -258,66 +483,751 @@ static inline SCString InjectSeqField(const SCString& line, uint32_t seq) {
 }
 
 // ========== FONCTIONS DE FLUSH AUTOMATIQUE ==========
-static void FlushAllBuffers(SCStudyInterfaceRef& sc, const char* reason) {
+static void FlushAllBuffers(SCStudyInterfaceRef& sc, G3Context& ctx, const char* reason) {
   if (ShouldLog(sc, LOG_KEY)) {
     SCString flushMsg;
-    flushMsg.Format("FLUSH: %s - Flushing %d buffers", reason, (int)g_CoalesceBufByKey.size());
+    flushMsg.Format("FLUSH: %s - Flushing %d buffers", reason, (int)ctx.coalesce_buf_by_key.size());
     DebugLog(sc, flushMsg.GetChars());
   }
   
-  for (auto it = g_CoalesceBufByKey.begin(); it != g_CoalesceBufByKey.end(); ) {
+  for (auto it = ctx.coalesce_buf_by_key.begin(); it != ctx.coalesce_buf_by_key.end(); ) {
     WriteToSpecializedFile(sc.ChartNumber, it->second.dataType.GetChars(), it->second.json);
-    it = g_CoalesceBufByKey.erase(it);
+    it = ctx.coalesce_buf_by_key.erase(it);
   }
-  g_metrics.bars_since_flush = 0;
+  ctx.metrics.bars_since_flush = 0;
 }
 
-static void UpdateMetrics(SCStudyInterfaceRef& sc, const char* operation) {
-  g_metrics.total_bars_processed++;
-  g_metrics.buffer_size = g_CoalesceBufByKey.size();
-  g_metrics.last_update = time(NULL);
+static void UpdateMetrics(SCStudyInterfaceRef& sc, G3Context& ctx, const char* operation) {
+  ctx.metrics.total_bars_processed++;
+  ctx.metrics.buffer_size = ctx.coalesce_buf_by_key.size();
+  ctx.metrics.last_update = time(NULL);
   
-  if (strcmp(operation, "study") == 0) g_metrics.studies_written++;
-  else if (strcmp(operation, "quote") == 0) g_metrics.quotes_written++;
-  else if (strcmp(operation, "trade") == 0) g_metrics.trades_written++;
-  else if (strcmp(operation, "depth") == 0) g_metrics.depth_written++;
+  if (strcmp(operation, "study") == 0) ctx.metrics.studies_written++;
+  else if (strcmp(operation, "quote") == 0) ctx.metrics.quotes_written++;
+  else if (strcmp(operation, "trade") == 0) ctx.metrics.trades_written++;
+  else if (strcmp(operation, "depth") == 0) ctx.metrics.depth_written++;
 }
 
-static void CheckAutoFlush(SCStudyInterfaceRef& sc) {
+static void CheckAutoFlush(SCStudyInterfaceRef& sc, G3Context& ctx) {
   time_t now = time(NULL);
   
   // Flush temporel (toutes les 30 secondes)
-  if (now - g_metrics.last_flush > 30) {
-    FlushAllBuffers(sc, "AUTO-TIME");
-    g_metrics.last_flush = now;
+  if (now - ctx.metrics.last_flush > 30) {
+    FlushAllBuffers(sc, ctx, "AUTO-TIME");
+    ctx.metrics.last_flush = now;
   }
   
   // Flush par nombre de barres (toutes les 10 barres)
-  g_metrics.bars_since_flush++;
-  if (g_metrics.bars_since_flush >= 10) {
-    FlushAllBuffers(sc, "AUTO-BAR");
-    g_metrics.bars_since_flush = 0;
+  ctx.metrics.bars_since_flush++;
+  if (ctx.metrics.bars_since_flush >= 10) {
+    FlushAllBuffers(sc, ctx, "AUTO-BAR");
+    ctx.metrics.bars_since_flush = 0;
   }
   
   // Rapport de performance (toutes les 5 minutes)
-  if (ShouldLog(sc, LOG_KEY) && (now - g_metrics.last_metrics_report > 300)) {
+  if (ShouldLog(sc, LOG_KEY) && (now - ctx.metrics.last_metrics_report > 300)) {
     SCString perfMsg1;
     perfMsg1.Format("PERF: Bars=%d, Studies=%d, Quotes=%d, Trades=%d, Depth=%d", 
-                   g_metrics.total_bars_processed,
-                   g_metrics.studies_written,
-                   g_metrics.quotes_written,
-                   g_metrics.trades_written,
-                   g_metrics.depth_written);
+                   ctx.metrics.total_bars_processed,
+                   ctx.metrics.studies_written,
+                   ctx.metrics.quotes_written,
+                   ctx.metrics.trades_written,
+                   ctx.metrics.depth_written);
     DebugLog(sc, perfMsg1.GetChars());
     
     SCString perfMsg2;
     perfMsg2.Format("PERF: BufferSize=%d, Quality: Invalid=%d, Missing=%d", 
-                   g_metrics.buffer_size,
-                   g_quality.invalid_values,
-                   g_quality.missing_studies);
+                   ctx.metrics.buffer_size,
+                   ctx.quality.invalid_values,
+                   ctx.quality.missing_studies);
     DebugLog(sc, perfMsg2.GetChars());
     
-    g_metrics.last_metrics_report = now;
+    ctx.metrics.last_metrics_report = now;
+  }
+}
+
+// ========== HORLOGE MARCHÉ ==========
+// Horodatage des flux dérivés du carnet (pas d'heure bourse sur les mises à
+// jour DOM): dernier enregistrement T&S traité (trade ou BBO, UTC comme les
+// lignes trade/quote), prolongé par le temps écoulé depuis son traitement.
+// Avant le premier enregistrement: ouverture du bar ramenée en UTC. Non
+// décroissant (un lot T&S en retard ne fait pas reculer l'horloge), ce que
+// la reconstruction du carnet par temps suppose.
+static double MarketTimeNow(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  const double last = ctx.last_ts_time.GetAsDouble();
+  double t;
+  if (last <= 0.0 || ctx.last_ts_steady_ms == 0) {
+    t = sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble() - sc.TimeScaleAdjustment.GetAsDouble();
+  } else {
+    t = last + (double)(MiaSteadyMs() - ctx.last_ts_steady_ms) / 86400000.0;
+  }
+  if (t < ctx.last_market_t) t = ctx.last_market_t;
+  ctx.last_market_t = t;
+  return t;
+}
+
+// ========== CONFLATION TEMPORELLE DU DOM ==========
+static void AccumulateDepthChange(DepthWindow& w, bool bid, int lvl, double price, int size) {
+  DepthLevelAcc& acc = bid ? w.bid[lvl] : w.ask[lvl];
+  acc.price = price;
+  acc.size = size;
+  acc.changes++;
+  w.total_changes++;
+}
+
+static void AppendDepthLevels(SCString& j, DepthLevelAcc* levels, int maxLevels) {
+  bool first = true;
+  for (int lvl = 1; lvl <= maxLevels && lvl < 256; ++lvl) {
+    DepthLevelAcc& acc = levels[lvl];
+    if (acc.changes == 0) continue;
+    j.AppendFormat("%s[%d,%.8f,%d,%d]", first ? "" : ",", lvl, acc.price, acc.size, acc.changes);
+    acc.changes = 0;
+    first = false;
+  }
+}
+
+// Émet la fenêtre courante si elle est échue (ou si 'force', ex. LastCall)
+static void EmitDepthWindow(SCStudyInterfaceRef& sc, G3Context& ctx, int windowMs, int maxLevels, bool force) {
+  DepthWindow& w = ctx.depth_window;
+
+  // En-tête du fichier quotidien: cadence déclarée (redéclarée si l'input change)
+  if (w.header_window_ms != windowMs) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"depth_conflated\",\"version\":2,\"clock\":\"ts\",\"window_ms\":%d,"
+             "\"levels_format\":[\"lvl\",\"price\",\"size\",\"changes\"],\"sym\":\"%s\",\"chart\":%d}",
+             windowMs, sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "depth_conflated", h);
+    w.header_window_ms = windowMs;
+  }
+
+  const int64_t now = MiaSteadyMs();
+  if (!force && now - w.last_emit_ms < windowMs) return;
+  if (w.total_changes == 0) { w.last_emit_ms = now; return; }
+
+  int nlevels = 0;
+  for (int lvl = 1; lvl <= maxLevels && lvl < 256; ++lvl) {
+    if (w.bid[lvl].changes) nlevels++;
+    if (w.ask[lvl].changes) nlevels++;
+  }
+
+  SCString j;
+  j.Format("{\"t\":%.9f,\"sym\":\"%s\",\"type\":\"depth_conflated\",\"window_ms\":%d,\"changes\":%d,\"levels\":%d,\"bids\":[",
+           MarketTimeNow(sc, ctx), sc.Symbol.GetChars(), windowMs, w.total_changes, nlevels);  // fin de fenêtre, pas le bar
+  AppendDepthLevels(j, w.bid, maxLevels);
+  j += "],\"asks\":[";
+  AppendDepthLevels(j, w.ask, maxLevels);
+  j.AppendFormat("],\"chart\":%d}", sc.ChartNumber);
+  WriteToSpecializedFile(sc.ChartNumber, "depth_conflated", j);
+
+  w.total_changes = 0;
+  w.last_emit_ms = now;
+}
+
+static void AppendBookLevels(SCString& j, const MiaL2Book& book, int side, double tick) {
+  for (int lvl = 1; lvl <= book.LevelCount(side); ++lvl) {
+    j.AppendFormat("%s[%.8f,%d]", lvl == 1 ? "" : ",", MiaTicksToPrice(book.LevelTicks(side, lvl), tick),
+                   (int)book.LevelSize(side, lvl));
+  }
+}
+
+// Plus grand "bseq" des lignes complètes en fin du fichier depth_book du
+// jour (0 si absent): un redémarrage reprend la séquence après la dernière
+// ligne réellement écrite, pas après le dernier checkpoint
+static uint64_t LastBookSeqOnDisk(int chartNumber) {
+  const std::string& path = MiaCachedDailyPath(MIA_LAYOUT_ORGANIZED, MIA_DEFAULT_BASE_DIR, chartNumber, "depth_book");
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return 0;
+  std::string tail(65536, '\0');
+#ifdef _WIN32
+  _fseeki64(f, 0, SEEK_END);
+  const int64_t size = _ftelli64(f);
+  _fseeki64(f, size > (int64_t)tail.size() ? size - (int64_t)tail.size() : 0, SEEK_SET);
+#else
+  fseeko(f, 0, SEEK_END);
+  const int64_t size = (int64_t)ftello(f);
+  fseeko(f, size > (int64_t)tail.size() ? (off_t)(size - (int64_t)tail.size()) : 0, SEEK_SET);
+#endif
+  tail.resize(fread(&tail[0], 1, tail.size(), f));
+  fclose(f);
+
+  const size_t end = tail.rfind('\n');  // ligne partielle finale ignorée
+  if (end == std::string::npos) return 0;
+  uint64_t last = 0;
+  for (size_t pos = tail.find("\"bseq\":"); pos != std::string::npos && pos < end;
+       pos = tail.find("\"bseq\":", pos + 7)) {
+    const uint64_t seq = strtoull(tail.c_str() + pos + 7, NULL, 10);
+    if (seq > last) last = seq;
+  }
+  return last;
+}
+
+// Émet un snapshot (si échu) ou une ligne de diffs (ops produites par le
+// dernier Apply du carnet)
+static void EmitDepthBook(SCStudyInterfaceRef& sc, G3Context& ctx, int intervalS) {
+  DepthBook& b = ctx.depth_book;
+
+  if (b.header_interval_s != intervalS) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"depth_book\",\"version\":2,\"clock\":\"ts\",\"snapshot_interval_s\":%d,"
+             "\"tick\":%.8f,\"levels_format\":[\"price\",\"size\"],\"ops_format\":[\"side\",\"op\",\"price\",\"size\"],"
+             "\"sym\":\"%s\",\"chart\":%d}",
+             intervalS, MiaTickSize(sc), sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "depth_book", h);
+    b.header_interval_s = intervalS;
+  }
+
+  const double t = MarketTimeNow(sc, ctx);  // heure de la mise à jour, pas du bar
+  const double tick = MiaTickSize(sc);
+  const int64_t now = MiaSteadyMs();
+  const int today = MiaToday().AsInt();
+
+  // Snapshot: premier appel, nouveau fichier du jour ou intervalle échu.
+  // Il remplace les diffs de cet appel (l'état complet les contient déjà).
+  if (b.last_snapshot_ms == 0 || b.snapshot_date != today || now - b.last_snapshot_ms >= (int64_t)intervalS * 1000) {
+    if (b.snapshot_date != today) {
+      // Premier snapshot de ce fichier pour l'instance: nouveau jour -> 0,
+      // démarrage -> après la dernière ligne déjà sur disque (le checkpoint
+      // périodique peut être plus ancien que le fichier)
+      if (b.snapshot_date != 0) b.bseq = 0;
+      else MiaGetWriter()->Flush();
+      const uint64_t onDisk = LastBookSeqOnDisk(sc.ChartNumber);
+      if (onDisk > b.bseq) b.bseq = onDisk;
+    }
+    SCString j;
+    j.Format("{\"t\":%.9f,\"sym\":\"%s\",\"type\":\"depth_snapshot\",\"bseq\":%llu,\"tick\":%.8f,\"bids\":[",
+             t, sc.Symbol.GetChars(), (unsigned long long)++b.bseq, tick);
+    AppendBookLevels(j, ctx.book, MIA_BOOK_BID, tick);
+    j += "],\"asks\":[";
+    AppendBookLevels(j, ctx.book, MIA_BOOK_ASK, tick);
+    j.AppendFormat("],\"chart\":%d}", sc.ChartNumber);
+    WriteToSpecializedFile(sc.ChartNumber, "depth_book", j);
+    b.last_snapshot_ms = now;
+    b.snapshot_date = today;
+    return;
+  }
+
+  if (b.ops.empty()) return;
+
+  SCString j;
+  j.Format("{\"t\":%.9f,\"sym\":\"%s\",\"type\":\"depth_diff\",\"bseq\":%llu,\"ops\":[",
+           t, sc.Symbol.GetChars(), (unsigned long long)++b.bseq);
+  bool first = true;
+  for (const MiaBookDiff& d : b.ops) {
+    j.AppendFormat("%s[\"%c\",\"%c\",%.8f,%lld]", first ? "" : ",", d.side == MIA_BOOK_BID ? 'B' : 'A',
+                   (char)d.op, MiaTicksToPrice(d.ticks, tick), (long long)d.size);
+    first = false;
+  }
+  j.AppendFormat("],\"chart\":%d}", sc.ChartNumber);
+  WriteToSpecializedFile(sc.ChartNumber, "depth_book", j);
+}
+
+// Met à jour les features depuis le carnet puis émet la fenêtre si échue
+static void UpdateOfFeatures(SCStudyInterfaceRef& sc, G3Context& ctx, int intervalMs, int topN) {
+  OfFeaturesState& of = ctx.of_features;
+
+  if (of.header_interval_ms != intervalMs) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"of_features\",\"version\":2,\"clock\":\"ts\",\"interval_ms\":%d,\"topn\":%d,"
+             "\"tick\":%.8f,\"sym\":\"%s\",\"chart\":%d}",
+             intervalMs, topN, MiaTickSize(sc), sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "of_features", h);
+    of.header_interval_ms = intervalMs;
+  }
+
+  // OFI cumulé par session
+  const int day = MiaSessionDay(sc, sc.BaseDateTimeIn[sc.ArraySize - 1]);
+  if (of.session_date != day) {
+    of.engine.ResetSession();
+    of.session_date = day;
+  }
+
+  of.engine.OnBook(ctx.book, topN);
+
+  const int64_t now = MiaSteadyMs();
+  if (now - of.last_emit_ms < intervalMs || !of.engine.HasUpdates()) return;
+
+  const MiaOfFeatures& f = of.engine.Current();
+  const double tick = MiaTickSize(sc);
+  SCString j;
+  j.Format("{\"t\":%.9f,\"sym\":\"%s\",\"type\":\"of_features\",\"ofi\":%lld,\"ofi_cum\":%lld,\"n_upd\":%u,"
+           "\"mp\":%.8f,\"mid\":%.8f,\"spread_ticks\":%lld,\"imb_l1\":%.4f,\"imb_topn\":%.4f,\"chart\":%d}",
+           MarketTimeNow(sc, ctx), sc.Symbol.GetChars(), (long long)f.ofi,
+           (long long)f.ofi_cum, f.updates, f.microprice_ticks * tick, f.mid_ticks * tick,
+           (long long)f.spread_ticks, f.imbalance_l1, f.imbalance_topn, sc.ChartNumber);
+  WriteToSpecializedFile(sc.ChartNumber, "of_features", j);
+  of.engine.TakeWindow();
+  of.last_emit_ms = now;
+}
+
+// Un parcours de GetVAPElementAtIndex pour le bar 'bar'
+static void ScanFootprintBar(SCStudyInterfaceRef& sc, MiaFootprintTracker& tr, int bar) {
+  tr.BeginScan(bar);
+  const int n = sc.VolumeAtPriceForBars->GetSizeAtBarIndex(bar);
+  for (int k = 0; k < n; ++k) {
+    const s_VolumeAtPriceV2* v = nullptr;
+    if (sc.VolumeAtPriceForBars->GetVAPElementAtIndex(bar, k, &v) && v) {
+      tr.AddRow(v->PriceInTicks, v->BidVolume, v->AskVolume, v->NumberOfTrades);
+    }
+  }
+  tr.EndScan();
+}
+
+// "rows":[[dticks,bid,ask,trades],...]: dticks = écart au prix de la ligne
+// précédente (0 pour la première, au prix "p0")
+static void EmitFootprint(SCStudyInterfaceRef& sc, const MiaFootprintTracker& tr, bool closed) {
+  const std::vector<MiaFootprintRow>& rows = closed ? tr.Rows() : tr.Changed();
+  if (rows.empty()) return;
+
+  const int bar = tr.Bar();
+  SCString j;
+  j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"footprint\",\"i\":%d,\"state\":\"%s\",\"p0\":%.8f,\"rows\":[",
+           sc.BaseDateTimeIn[bar].GetAsDouble(), sc.Symbol.GetChars(), bar, closed ? "closed" : "open",
+           NormalizePx(sc, MiaTicksToPrice(rows[0].ticks, MiaTickSize(sc))));
+  int32_t prev = rows[0].ticks;
+  for (size_t k = 0; k < rows.size(); ++k) {
+    const MiaFootprintRow& r = rows[k];
+    j.AppendFormat("%s[%d,%u,%u,%u]", k ? "," : "", r.ticks - prev, r.bid_vol, r.ask_vol, r.trades);
+    prev = r.ticks;
+  }
+  j += "]";
+  if (closed) {
+    uint64_t vol; int64_t delta; int32_t poc;
+    tr.Totals(vol, delta, poc);
+    j.AppendFormat(",\"vol\":%llu,\"delta\":%lld,\"poc\":%.8f", (unsigned long long)vol, (long long)delta,
+                   NormalizePx(sc, MiaTicksToPrice(poc, MiaTickSize(sc))));
+  }
+  j.AppendFormat(",\"chart\":%d}", sc.ChartNumber);
+  WriteToSpecializedFile(sc.ChartNumber, "footprint", j);
+}
+
+static void UpdateFootprint(SCStudyInterfaceRef& sc, G3Context& ctx, int intervalMs) {
+  FootprintState& fp = ctx.footprint;
+  if (fp.header_interval_ms != intervalMs) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"footprint\",\"version\":1,\"interval_ms\":%d,\"tick\":%.8f,"
+             "\"rows_format\":[\"dticks\",\"bid_vol\",\"ask_vol\",\"trades\"],"
+             "\"open\":\"changed rows\",\"closed\":\"all rows\",\"sym\":\"%s\",\"chart\":%d}",
+             intervalMs, MiaTickSize(sc), sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "footprint", h);
+    fp.header_interval_ms = intervalMs;
+  }
+
+  const int last = sc.ArraySize - 1;
+
+  // Bar suivi désormais clos: parcours final et lignes complètes
+  const int tracked = fp.tracker.Bar();
+  if (tracked >= 0 && tracked < last) {
+    ScanFootprintBar(sc, fp.tracker, tracked);
+    EmitFootprint(sc, fp.tracker, true);
+    fp.last_scan_ms = 0;  // premier parcours du nouveau bar sans attendre
+  }
+
+  const int64_t now = MiaSteadyMs();
+  if (fp.last_scan_ms != 0 && now - fp.last_scan_ms < intervalMs) return;
+  ScanFootprintBar(sc, fp.tracker, last);
+  EmitFootprint(sc, fp.tracker, false);
+  fp.last_scan_ms = now;
+}
+
+// Lit un bar de c_ACSILDepthBars et l'écrit; false si pas de données
+static bool ExportDepthBar(SCStudyInterfaceRef& sc, c_ACSILDepthBars* db, DepthBarsState& st, int bar, uint8_t flags) {
+  if (!db->DepthDataExistsAt(bar)) return false;
+  const int lo = db->GetBarLowestPriceTickIndex(bar);
+  const int hi = db->GetBarHighestPriceTickIndex(bar);
+  if (hi < lo || hi - lo > 100000) return false;
+
+  MiaDepthBarRecord& r = st.rec;
+  r.bar = bar;
+  r.t = sc.BaseDateTimeIn[bar].GetAsDouble();
+  r.flags = flags;
+  r.low_tick = lo;
+  r.bid_max.assign((size_t)(hi - lo + 1), 0);
+  r.ask_max.assign((size_t)(hi - lo + 1), 0);
+  int idx = lo;
+  do {
+    if (idx > hi) break;
+    r.bid_max[(size_t)(idx - lo)] = db->GetMaxBidQuantity(bar, idx);
+    r.ask_max[(size_t)(idx - lo)] = db->GetMaxAskQuantity(bar, idx);
+  } while (db->GetNextHigherPriceTickIndex(bar, idx));
+
+  MiaEncodeDepthBar(r, st.buf);
+  WriteBinaryRecord(sc.ChartNumber, "depthbars", st.buf);
+  return true;
+}
+
+static void UpdateDepthBars(SCStudyInterfaceRef& sc, G3Context& ctx, int mode, int backfillBars, int liveIntervalS) {
+  c_ACSILDepthBars* db = sc.GetMarketDepthBars();
+  if (!db) return;
+  DepthBarsState& st = ctx.depth_bars;
+  const int last = sc.ArraySize - 1;
+
+  if (!st.header_set) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"depthbars\",\"version\":1,\"format\":\"MDB1\",\"tick\":%.8f,"
+             "\"record\":[\"u32 magic\",\"u32 len\",\"i32 bar\",\"f64 t\",\"u8 flags\",\"i32 low_tick\",\"u32 n\",\"rle bid_max\",\"rle ask_max\",\"lf\"],"
+             "\"flags\":{\"closed\":1,\"backfill\":2},\"sym\":\"%s\",\"chart\":%d}",
+             MiaTickSize(sc), sc.Symbol.GetChars(), sc.ChartNumber);
+    SetBinaryFileHeader(sc.ChartNumber, "depthbars", h);
+    st.header_set = true;
+
+    // Plage de rattrapage: bars clos non encore exportés (checkpoint)
+    if (mode >= 2) {
+      int from = backfillBars > 0 ? last - backfillBars : 0;
+      if (from < 0) from = 0;
+      while (from < last && sc.BaseDateTimeIn[from].GetAsDouble() <= st.last_closed_t) ++from;
+      st.backfill_next = from;
+      st.backfill_end = last;
+    }
+  }
+
+  // Rattrapage borné par appel
+  if (st.backfill_next >= 0) {
+    const int stop = std::min(st.backfill_end, st.backfill_next + DEPTHBARS_BACKFILL_PER_CALL);
+    for (; st.backfill_next < stop; ++st.backfill_next) {
+      if (ExportDepthBar(sc, db, st, st.backfill_next, MIA_DEPTHBAR_CLOSED | MIA_DEPTHBAR_BACKFILL)) {
+        st.last_closed_t = sc.BaseDateTimeIn[st.backfill_next].GetAsDouble();
+      }
+    }
+    if (st.backfill_next >= st.backfill_end) st.backfill_next = -1;
+  }
+
+  // Bar suivi clos: export définitif
+  if (st.live_bar >= 0 && st.live_bar < last) {
+    if (ExportDepthBar(sc, db, st, st.live_bar, MIA_DEPTHBAR_CLOSED)) {
+      st.last_closed_t = sc.BaseDateTimeIn[st.live_bar].GetAsDouble();
+    }
+    st.last_live_ms = 0;
+  }
+  st.live_bar = last;
+
+  // Bar en cours: export incrémental
+  const int64_t now = MiaSteadyMs();
+  if (st.last_live_ms != 0 && now - st.last_live_ms < (int64_t)liveIntervalS * 1000) return;
+  ExportDepthBar(sc, db, st, last, 0);
+  st.last_live_ms = now;
+}
+
+// ========== MÉTA-TRADES (trade_meta) ==========
+// Prints consécutifs de même côté et même DateTime fusionnés: une ligne par
+// ordre agressif, émise en plus du flux trade brut (Input[44])
+static void EmitMetaTrade(SCStudyInterfaceRef& sc, const MiaMetaTrade& m) {
+  const double tick = MiaTickSize(sc);
+  SCString j;
+  j.Format(R"({"t":%.6f,"sym":"%s","type":"trade_meta","side":"%s","vwap":%.8f,"vol":%llu,"levels":%u,"prints":%u,"px_first":%.8f,"px_last":%.8f,"seq_first":%u,"seq_last":%u,"chart":%d})",
+           m.t, sc.Symbol.GetChars(), m.side > 0 ? "BUY" : (m.side < 0 ? "SELL" : "TRADE"), m.VwapTicks() * tick,
+           (unsigned long long)m.vol, m.levels, m.prints, MiaTicksToPrice(m.first_ticks, tick),
+           MiaTicksToPrice(m.last_ticks, tick), m.first_seq, m.last_seq, sc.ChartNumber);
+  WriteToSpecializedFile(sc.ChartNumber, "trade_meta", j);
+}
+
+// ========== ABSORPTION / ICEBERGS (absorption) ==========
+// Évalue, à la fin du lot T&S, les niveaux tradés contre le carnet courant;
+// horodaté au dernier print traité. Coût borné par le nombre de niveaux touchés
+static void UpdateAbsorption(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  AbsorptionState& st = ctx.absorption;
+  MiaAbsorptionConfig cfg;
+  cfg.min_absorb_volume = sc.Input[45].GetInt();
+  cfg.min_hidden_volume = sc.Input[46].GetInt();
+  cfg.min_refills = (uint32_t)std::max(1, sc.Input[47].GetInt());
+
+  if (st.header_min_vol != cfg.min_absorb_volume || st.header_min_hidden != cfg.min_hidden_volume ||
+      st.header_min_refills != (int)cfg.min_refills) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"absorption\",\"version\":1,\"min_absorb_vol\":%lld,"
+             "\"min_hidden_vol\":%lld,\"min_refills\":%u,\"tick\":%.8f,\"sym\":\"%s\",\"chart\":%d}",
+             (long long)cfg.min_absorb_volume, (long long)cfg.min_hidden_volume, cfg.min_refills, MiaTickSize(sc),
+             sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "absorption", h);
+    st.engine.Configure(cfg);
+    st.header_min_vol = cfg.min_absorb_volume;
+    st.header_min_hidden = cfg.min_hidden_volume;
+    st.header_min_refills = (int)cfg.min_refills;
+  }
+
+  const double t = ctx.last_ts_time.GetAsDouble();
+  st.engine.OnBook(t, ctx.book, st.events);
+  if (st.events.empty()) return;
+
+  const double tick = MiaTickSize(sc);
+  for (const MiaAbsorptionEvent& e : st.events) {
+    SCString j;
+    j.Format(R"({"t":%.6f,"sym":"%s","type":"absorption","kind":"%s","side":"%s","px":%.8f,"traded":%lld,"hidden":%lld,"refills":%u,"display":%lld,"dur_s":%.3f,"chart":%d})",
+             e.t, sc.Symbol.GetChars(), e.kind == MIA_EVT_ICEBERG ? "iceberg" : "absorption",
+             e.side == MIA_BOOK_BID ? "BID" : "ASK", MiaTicksToPrice(e.ticks, tick), (long long)e.traded,
+             (long long)e.hidden, e.refills, (long long)e.display, (e.t - e.first_t) * 86400.0, sc.ChartNumber);
+    WriteToSpecializedFile(sc.ChartNumber, "absorption", j);
+  }
+}
+
+// ========== AGRÉGATS DE FLUX GLISSANTS (trade_summary) ==========
+// Imputation d'un print classé; nouvelle session au changement de jour
+static void AddTradeFlow(G3Context& ctx, int day, double tsec, int side, uint32_t vol) {
+  TradeFlowState& st = ctx.trade_flow;
+  if (day != st.session_day) {
+    st.engine.ResetSession();
+    st.session_day = day;
+  }
+  st.last_print_ms = (int64_t)llround(tsec * 86400000.0);
+  st.last_print_steady = MiaSteadyMs();
+  st.engine.Add(st.last_print_ms, side, vol);
+}
+
+// Fait glisser les fenêtres sur l'horloge des prints et émet à cadence fixe
+static void UpdateTradeFlow(SCStudyInterfaceRef& sc, G3Context& ctx, int intervalMs) {
+  TradeFlowState& st = ctx.trade_flow;
+
+  if (st.header_interval_ms != intervalMs) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"trade_summary\",\"version\":2,\"interval_ms\":%d,"
+             "\"windows\":[\"1s\",\"10s\",\"60s\",\"5m\"],"
+             "\"w_fields\":[\"buy_trades\",\"sell_trades\",\"buy_vol\",\"sell_vol\",\"delta\"],"
+             "\"sym\":\"%s\",\"chart\":%d}",
+             intervalMs, sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "trade_summary", h);
+    st.header_interval_ms = intervalMs;
+  }
+
+  if (st.last_print_ms == 0) return;  // aucun print depuis le chargement
+
+  // Horloge unique: dernier print T&S + temps écoulé depuis son traitement
+  const int64_t now = MiaSteadyMs();
+  const int64_t now_ms = st.last_print_ms + (now - st.last_print_steady);
+  st.engine.Advance(now_ms);
+  const double now_t = (double)now_ms / 86400000.0;
+
+  if (now - st.last_emit_ms < intervalMs) return;
+  st.last_emit_ms = now;
+
+  const MiaFlowAgg& s = st.engine.Session();
+  SCString j;
+  j.Format(R"({"t":%.6f,"sym":"%s","type":"trade_summary","buy_trades":%llu,"sell_trades":%llu,"buy_vol":%llu,"sell_vol":%llu,"delta":%lld,"w":{)",
+           now_t, sc.Symbol.GetChars(), (unsigned long long)s.buy_trades, (unsigned long long)s.sell_trades,
+           (unsigned long long)s.buy_vol, (unsigned long long)s.sell_vol, (long long)s.Delta());
+  for (int w = 0; w < MiaTradeFlowWindows::kCount; ++w) {
+    const MiaFlowAgg& a = st.engine.Window(w);
+    j.AppendFormat("%s\"%s\":[%llu,%llu,%llu,%llu,%lld]", w ? "," : "", MiaTradeFlowWindows::WindowName(w),
+                   (unsigned long long)a.buy_trades, (unsigned long long)a.sell_trades,
+                   (unsigned long long)a.buy_vol, (unsigned long long)a.sell_vol, (long long)a.Delta());
+  }
+  j.AppendFormat("},\"chart\":%d}", sc.ChartNumber);
+  WriteToSpecializedFile(sc.ChartNumber, "trade_summary", j);
+}
+
+// ========== GROS LOTS (large_trades) ==========
+// Ajoute la taille au sketch de la session et retourne son percentile (0..100,
+// -1 pendant l'amorçage); *threshold reçoit le quantile Input[49] courant
+static double TagTradeSize(SCStudyInterfaceRef& sc, G3Context& ctx, int day, double vol, double pct,
+                           double* threshold) {
+  LargeTradesState& st = ctx.large_trades;
+  if (st.header_pct != (float)pct) {
+    // Marqueurs P² resserrés autour du seuil configuré
+    const double p = pct / 100.0;
+    const double probs[] = {0.25, 0.5, 0.75, 0.9, p, (1.0 + p) / 2.0, 0.99};
+    st.sizes.SetProbs(probs, sizeof(probs) / sizeof(probs[0]));
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"large_trades\",\"version\":1,\"pct\":%.2f,\"warmup\":%d,"
+             "\"sym\":\"%s\",\"chart\":%d}",
+             pct, LARGE_TRADES_WARMUP, sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "large_trades", h);
+    st.header_pct = (float)pct;
+  }
+
+  if (day != st.session_day) {
+    st.sizes.Reset();
+    st.session_day = day;
+  }
+
+  // Seuil et percentile évalués avant d'intégrer le print
+  const bool ready = st.sizes.Count() >= LARGE_TRADES_WARMUP;
+  *threshold = ready ? st.sizes.Quantile(pct / 100.0) : -1.0;
+  const double rank = ready ? st.sizes.Percentile(vol) * 100.0 : -1.0;
+  st.sizes.Add(vol);
+  return rank;
+}
+
+// ========== VPIN (vpin) ==========
+// Impute un trade classé aux buckets de volume; émet chaque bucket complété
+static void AddVpinTrade(SCStudyInterfaceRef& sc, G3Context& ctx, int day, double tsec, int side, double vol) {
+  VpinState& st = ctx.vpin;
+  const int bucketVol = sc.Input[50].GetInt();
+  const int window = std::max(1, sc.Input[51].GetInt());
+
+  if (st.cfg_bucket_vol != bucketVol || st.cfg_window != window) {
+    st.engine.Configure((double)bucketVol, window);
+    st.done.reserve(16);
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"vpin\",\"version\":1,\"bucket_vol\":%d,\"window\":%d,"
+             "\"sym\":\"%s\",\"chart\":%d}",
+             bucketVol, window, sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "vpin", h);
+    st.cfg_bucket_vol = bucketVol;
+    st.cfg_window = window;
+  }
+
+  if (day != st.session_day) {
+    st.engine.Reset();
+    st.session_day = day;
+  }
+
+  st.engine.Add(tsec, side, vol, st.done);
+  for (const MiaVpinBucket& b : st.done) {
+    SCString j;
+    j.Format(R"({"t":%.6f,"sym":"%s","type":"vpin","vpin":%.5f,"bucket":%llu,"imb":%.1f,"n":%u,"dur_s":%.3f,"chart":%d})",
+             b.t, sc.Symbol.GetChars(), b.vpin, (unsigned long long)b.index, b.imbalance, b.window,
+             (b.t - b.first_t) * 86400.0, sc.ChartNumber);
+    WriteToSpecializedFile(sc.ChartNumber, "vpin", j);
+  }
+}
+
+// ========== INDICATEURS NATIFS (ATR, CORRÉLATION) ==========
+// ATR de Wilder du bar i; historique rattrapé en batch à la reconstruction
+static bool NativeAtr(SCStudyInterfaceRef& sc, G3Context& ctx, int i, double& val) {
+  NativeKernelsState& k = ctx.kernels;
+  const int period = std::max(1, sc.Input[53].GetInt());
+  SCFloatArray& H = sc.BaseDataIn[SC_HIGH];
+  SCFloatArray& L = sc.BaseDataIn[SC_LOW];
+  SCFloatArray& C = sc.BaseDataIn[SC_LAST];
+
+  if (k.atr_period != period || k.atr_bar >= i) {
+    k.atr.Init(period);
+    k.atr_bar = -1;
+    k.atr_period = period;
+    if (i > 0) {
+      k.h.resize(i); k.l.resize(i); k.c.resize(i); k.out.resize(i);
+      for (int b = 0; b < i; ++b) { k.h[b] = H[b]; k.l[b] = L[b]; k.c[b] = C[b]; }
+      MiaWilderAtrBatch(k.h.data(), k.l.data(), k.c.data(), i, period, k.out.data());
+      k.atr.Seed(k.out[i - 1], k.c[i - 1], i);
+      k.atr_bar = i - 1;
+    }
+  }
+  while (k.atr_bar < i - 1) {
+    ++k.atr_bar;
+    k.atr.Push(H[k.atr_bar], L[k.atr_bar], C[k.atr_bar]);
+  }
+  val = k.atr.Peek(H[i], L[i]);
+  return true;
+}
+
+// Clôture du chart Input[54] alignée sur le DateTime du bar (false si absente)
+static bool OtherChartClose(SCStudyInterfaceRef& sc, SCGraphData& other, int chart, int i, double& close) {
+  const int j = sc.GetNearestMatchForSCDateTime(chart, sc.BaseDateTimeIn[i]);
+  if (j < 0 || j >= other[SC_LAST].GetArraySize()) return false;
+  close = other[SC_LAST][j];
+  return close != 0.0;
+}
+
+// Corrélation glissante des clôtures du bar i avec le chart Input[54]
+static bool NativeCorrelation(SCStudyInterfaceRef& sc, G3Context& ctx, int i, double& cc) {
+  NativeKernelsState& k = ctx.kernels;
+  const int chart = sc.Input[54].GetInt();
+  const int period = std::max(2, sc.Input[55].GetInt());
+  if (chart <= 0) return false;
+
+  SCGraphData other;
+  sc.GetChartBaseData(chart, other);
+  if (other[SC_LAST].GetArraySize() <= 0) return false;
+  SCFloatArray& C = sc.BaseDataIn[SC_LAST];
+
+  // Reconstruction: seuls les 'period' derniers bars clos comptent
+  if (k.corr_period != period || k.corr_chart != chart || k.corr_bar >= i) {
+    k.corr.Init(period);
+    k.corr_period = period;
+    k.corr_chart = chart;
+    k.corr_bar = std::max(-1, i - 1 - period);
+  }
+  double y;
+  while (k.corr_bar < i - 1) {
+    ++k.corr_bar;
+    if (OtherChartClose(sc, other, chart, k.corr_bar, y)) k.corr.Push(C[k.corr_bar], y);
+  }
+  if (!OtherChartClose(sc, other, chart, i, y)) return false;
+  cc = k.corr.Peek(C[i], y);
+  return true;
+}
+
+// ========== AGRÉGATION MULTI-UNITÉS DE TEMPS (rollup) ==========
+// Prix normalisés à l'entrée: o/h/l/c et vwap (pv / vol) sont sur la même échelle
+static void FeedRollupBar(SCStudyInterfaceRef& sc, RollupState& st, int b) {
+  st.engine.OnBar(sc.BaseDateTimeIn[b].GetAsDouble(), NormalizePx(sc, sc.BaseDataIn[SC_OPEN][b]),
+                  NormalizePx(sc, sc.BaseDataIn[SC_HIGH][b]), NormalizePx(sc, sc.BaseDataIn[SC_LOW][b]),
+                  NormalizePx(sc, sc.BaseDataIn[SC_LAST][b]), sc.BaseDataIn[SC_VOLUME][b],
+                  sc.BaseDataIn[SC_BIDVOL][b], sc.BaseDataIn[SC_ASKVOL][b], st.closed);
+}
+
+// Intègre les bars 1 min clos depuis l'appel précédent; une ligne par bar
+// supérieur clos
+static void UpdateRollups(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  RollupState& st = ctx.rollup;
+  const int lastClosed = sc.ArraySize - 2;
+  if (lastClosed < 0) return;
+
+  if (!st.header_set) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"rollup\",\"version\":1,\"frames\":[5,15,30,60],"
+             "\"base_min\":%d,\"vwap\":\"hlc3\",\"sym\":\"%s\",\"chart\":%d}",
+             ROLLUP_BASE_MINUTES, sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "rollup", h);
+    st.header_set = true;
+  }
+
+  // Premier appel ou chart rechargé: reconstruction silencieuse
+  if (st.last_fed < 0 || st.last_fed > lastClosed) {
+    static const int kFrames[] = {5, 15, 30, 60};
+    st.engine.Init(kFrames, 4, ROLLUP_BASE_MINUTES);
+    st.closed.reserve(8);
+    for (int b = std::max(0, lastClosed - ROLLUP_BACKFILL_BARS); b <= lastClosed; ++b) {
+      FeedRollupBar(sc, st, b);
+      st.closed.clear();
+    }
+    st.last_fed = lastClosed;
+    return;
+  }
+
+  while (st.last_fed < lastClosed) {
+    FeedRollupBar(sc, st, ++st.last_fed);
+    for (const MiaRollupBar& r : st.closed) {
+      SCString j;
+      j.Format(R"({"t":%.6f,"sym":"%s","type":"rollup","tf":%d,"o":%.8f,"h":%.8f,"l":%.8f,"c":%.8f,"v":%.0f,"bv":%.0f,"av":%.0f,"delta":%.0f,"vwap":%.8f,"bars":%d,"chart":%d})",
+               r.StartDateTime(), sc.Symbol.GetChars(), r.minutes, r.open, r.high, r.low, r.close,
+               r.vol, r.bid_vol, r.ask_vol, r.Delta(), r.Vwap(), r.bars, sc.ChartNumber);
+      WriteToSpecializedFile(sc.ChartNumber, "rollup", j);
+    }
+    st.closed.clear();
+  }
+}
+
+// ========== BARS TICK / VOLUME / RANGE ==========
+static void AddTradeBars(SCStudyInterfaceRef& sc, G3Context& ctx, double tsec, int side, int64_t ticks,
+                         uint32_t vol) {
+  static const char* kStreams[3] = {"bars_tick", "bars_volume", "bars_range"};
+  static const char* kUnits[3] = {"trades", "volume", "ticks"};
+  TradeBarsState& st = ctx.trade_bars;
+  const double tick = MiaTickSize(sc);
+
+  for (int k = MIA_BARS_TICK; k <= MIA_BARS_RANGE; ++k) {
+    const int n = sc.Input[57 + k].GetInt();
+    if (n != st.thresholds[k]) {
+      st.builders[k].Init(k, n);
+      st.thresholds[k] = n;
+      if (n > 0) {
+        SCString h;
+        h.Format("{\"type\":\"header\",\"stream\":\"%s\",\"version\":1,\"n\":%d,\"unit\":\"%s\","
+                 "\"sym\":\"%s\",\"chart\":%d}",
+                 kStreams[k], n, kUnits[k], sc.Symbol.GetChars(), sc.ChartNumber);
+        SetDailyFileHeader(sc.ChartNumber, kStreams[k], h);
+      }
+    }
+    if (n <= 0) continue;
+
+    MiaTradeBar b;
+    if (!st.builders[k].Add(tsec, side, ticks, vol, b)) continue;
+    SCString j;
+    j.Format(R"({"t":%.6f,"sym":"%s","type":"%s","n":%d,"idx":%llu,"t_open":%.6f,"o":%.8f,"h":%.8f,"l":%.8f,"c":%.8f,"v":%llu,"bv":%llu,"av":%llu,"delta":%lld,"trades":%u,"chart":%d})",
+             b.t_close, sc.Symbol.GetChars(), kStreams[k], n, (unsigned long long)b.index, b.t_open,
+             MiaTicksToPrice(b.open, tick), MiaTicksToPrice(b.high, tick), MiaTicksToPrice(b.low, tick),
+             MiaTicksToPrice(b.close, tick), (unsigned long long)b.vol, (unsigned long long)b.bid_vol,
+             (unsigned long long)b.ask_vol, (long long)b.Delta(), b.trades, sc.ChartNumber);
+    WriteToSpecializedFile(sc.ChartNumber, kStreams[k], j);
   }
 }
 
@@ -332,15 +1242,346 @@ static double CapVolume(double volume, double median, double iqr, double multipl
   return volume;
 }
 
-// ========== DÉTECTION DE CHANGEMENT ==========
-static inline bool has_changed(double a, double b, double eps=1e-9) {
-  return fabs(a-b) > eps;
+// ========== SNAPSHOT CONSOLIDÉ PAR BAR (bar_snapshot) ==========
+// Slot du bar i (NULL si le flux est désactivé); un autre bar repart à vide
+static BarSnapshot* SnapSlot(SCStudyInterfaceRef& sc, G3Context& ctx, int i) {
+  if (sc.Input[60].GetInt() == 0) return NULL;
+  BarSnapshot& s = ctx.bar_snap.cur;
+  if (s.bar != i) {
+    s = BarSnapshot();
+    s.bar = i;
+    s.t = sc.BaseDateTimeIn[i].GetAsDouble();
+  }
+  return &s;
+}
+
+static void AppendSnapValues(SCString& j, unsigned have, unsigned field, const char* const* keys,
+                             const double* vals, int n, const char* fmt) {
+  for (int k = 0; k < n; ++k) {
+    if (have & field) {
+      j.AppendFormat(",\"%s\":", keys[k]);
+      j.AppendFormat(fmt, vals[k]);
+    } else {
+      j.AppendFormat(",\"%s\":null", keys[k]);
+    }
+  }
 }
 
+// Bandes VWAP: inversion éventuelle corrigée, ordre monotone forcé
+// (up1 <= up2 <= up3 et dn1 >= dn2 >= dn3)
+static void FixVwapBands(double v, double& up1, double& dn1, double& up2, double& dn2, double& up3, double& dn3) {
+  auto fix_band = [&](double& up, double& dn){
+    if (up < v && dn > v) {
+      double tmp = up; up = dn; dn = tmp;
+    }
+  };
+  fix_band(up1, dn1);
+  fix_band(up2, dn2);
+  fix_band(up3, dn3);
+  if (up2 < up1) { double tmp = up1; up1 = up2; up2 = tmp; }
+  if (up3 < up2) { double tmp = up2; up2 = up3; up3 = tmp; }
+  if (dn2 > dn1) { double tmp = dn1; dn1 = dn2; dn2 = tmp; }
+  if (dn3 > dn2) { double tmp = dn2; dn2 = dn3; dn3 = tmp; }
+}
+
+// Pression order flow NBCV (Inputs 19-21): 1 acheteurs, -1 vendeurs, 0 neutre
+static int NbcvPressure(SCStudyInterfaceRef& sc, double delta, double totalVolume, double askPct, double bidPct,
+                        double dltPct) {
+  const double min_vol   = sc.Input[19].GetFloat();  // Min Total Volume
+  const double th_ratio  = sc.Input[20].GetFloat();  // Min |Delta Ratio|
+  const double th_ratioR = sc.Input[21].GetFloat();  // Min Ask/Bid or Bid/Ask Ratio
+  const double bidAskRatio = (askPct > 0.0) ? (bidPct / askPct) : 0.0;
+  const double askBidRatio = (bidPct > 0.0) ? (askPct / bidPct) : 0.0;
+
+  if (totalVolume < min_vol) return 0;
+  // Signe du delta = côté dominant brut
+  if (delta > 0.0 && (fabs(dltPct) >= th_ratio || askBidRatio >= th_ratioR)) return 1;
+  if (delta < 0.0 && (fabs(dltPct) >= th_ratio || bidAskRatio >= th_ratioR)) return -1;
+  return 0;
+}
+
+// Relit le bar enregistré à son index: valeurs finales, y compris pour les
+// sections qui ne sont pas repassées depuis ses derniers prints
+static void RefreshBarSnapshot(SCStudyInterfaceRef& sc, G3Context& ctx, BarSnapshot& s) {
+  const BarSnapshotSources& src = ctx.bar_snap.src;
+  const int i = s.bar;
+
+  s.o = sc.BaseDataIn[SC_OPEN][i];
+  s.h = sc.BaseDataIn[SC_HIGH][i];
+  s.l = sc.BaseDataIn[SC_LOW][i];
+  s.c = sc.BaseDataIn[SC_LAST][i];
+  s.v = sc.BaseDataIn[SC_VOLUME][i];
+  s.bidvol = sc.BaseDataIn[SC_BIDVOL][i];
+  s.askvol = sc.BaseDataIn[SC_ASKVOL][i];
+  if (sc.Input[17].GetInt() != 0 && ctx.volume_iqr > 0) {
+    const double m = sc.Input[18].GetFloat();
+    s.v = CapVolume(s.v, ctx.volume_median, ctx.volume_iqr, m);
+    s.bidvol = CapVolume(s.bidvol, ctx.volume_median, ctx.volume_iqr, m);
+    s.askvol = CapVolume(s.askvol, ctx.volume_median, ctx.volume_iqr, m);
+  }
+  s.have |= SNAP_BASE;
+
+  SCFloatArray a;
+  auto read = [&](int id, int sg, double& out, bool px) -> bool {
+    if (id <= 0 || !ReadSubgraph(sc, id, sg, a) || !ValidateStudyData(a, i)) return false;
+    out = px ? NormalizePx(sc, a[i]) : a[i];
+    return true;
+  };
+
+  if (sc.Input[2].GetInt() != 0 && read(src.vwap_id, VWAP_SG_MAIN, s.vwap, true)) {
+    s.up1 = s.dn1 = s.up2 = s.dn2 = s.up3 = s.dn3 = 0.0;
+    if (src.vwap_bands >= 1) { read(src.vwap_id, VWAP_SG_UP1, s.up1, true); read(src.vwap_id, VWAP_SG_DN1, s.dn1, true); }
+    if (src.vwap_bands >= 2) { read(src.vwap_id, VWAP_SG_UP2, s.up2, true); read(src.vwap_id, VWAP_SG_DN2, s.dn2, true); }
+    if (src.vwap_bands >= 3) { read(src.vwap_id, VWAP_SG_UP3, s.up3, true); read(src.vwap_id, VWAP_SG_DN3, s.dn3, true); }
+    FixVwapBands(s.vwap, s.up1, s.dn1, s.up2, s.dn2, s.up3, s.dn3);
+    s.have |= SNAP_VWAP;
+  }
+
+  if (sc.Input[5].GetInt() != 0 && (src.vva_curr > 0 || src.vva_prev > 0)) {
+    s.vah = s.val = s.vpoc = s.pvah = s.pval = s.ppoc = 0.0;
+    read(src.vva_curr, VVA_SG_POC, s.vpoc, true);
+    read(src.vva_curr, VVA_SG_VAH, s.vah, true);
+    read(src.vva_curr, VVA_SG_VAL, s.val, true);
+    read(src.vva_prev, VVA_SG_POC, s.ppoc, true);
+    read(src.vva_prev, VVA_SG_VAH, s.pvah, true);
+    read(src.vva_prev, VVA_SG_VAL, s.pval, true);
+    s.have |= SNAP_VVA;
+  }
+
+  double ask = 0.0, bid = 0.0;
+  if (sc.Input[10].GetInt() != 0 && read(src.nbcv_id, NBCV_SG_ASK_VOLUME, ask, false) &&
+      read(src.nbcv_id, NBCV_SG_BID_VOLUME, bid, false)) {
+    double delta = ask - bid, total = ask + bid, trades = 0.0, cum = 0.0;
+    double askPct = 0.0, bidPct = 0.0, dltPct = 0.0;
+    read(src.nbcv_id, NBCV_SG_DELTA, delta, false);
+    read(src.nbcv_id, NBCV_SG_TOTAL_VOLUME, total, false);
+    read(src.nbcv_id, NBCV_SG_TRADES, trades, false);
+    read(src.nbcv_id, NBCV_SG_CUMULATIVE, cum, false);
+    if (read(src.nbcv_id, NBCV_SG_ASK_PCT, askPct, false) && read(src.nbcv_id, NBCV_SG_BID_PCT, bidPct, false)) {
+      askPct /= 100.0;
+      bidPct /= 100.0;
+    } else if (total > 0.0) {
+      askPct = ask / total;
+      bidPct = bid / total;
+    }
+    if (read(src.nbcv_id, NBCV_SG_DELTA_PCT, dltPct, false)) dltPct /= 100.0;
+    else if (total > 0.0) dltPct = delta / total;
+    s.nbcv_ask = ask; s.nbcv_bid = bid; s.nbcv_delta = delta; s.nbcv_trades = trades; s.nbcv_cum = cum;
+    s.pressure = NbcvPressure(sc, delta, total, askPct, bidPct, dltPct);
+    s.have |= SNAP_NBCV;
+  }
+
+  if (sc.Input[14].GetInt() != 0 && read(src.cd_id, src.cd_sg, s.cum_delta, false)) s.have |= SNAP_CD;
+
+  if (sc.Input[22].GetInt() != 0) {
+    if (src.atr_native) {
+      if (NativeAtr(sc, ctx, i, s.atr)) s.have |= SNAP_ATR;
+    } else if (read(src.atr_id, src.atr_sg, s.atr, false)) {
+      s.have |= SNAP_ATR;
+    }
+  }
+
+  if (sc.Input[28].GetInt() != 0 && read(src.vix_id, src.vix_sg, s.vix, false)) s.have |= SNAP_VIX;
+}
+
+// Barrière de clôture: relit puis écrit le bar enregistré dès qu'un bar plus
+// récent existe
+static void EmitBarSnapshot(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  BarSnapshotState& st = ctx.bar_snap;
+  BarSnapshot& s = st.cur;
+  if (s.bar < 0 || s.bar >= sc.ArraySize - 1) return;
+  RefreshBarSnapshot(sc, ctx, s);
+
+  if (!st.header_set) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"bar_snapshot\",\"version\":1,"
+             "\"sources\":[\"basedata\",\"vwap\",\"vva\",\"nbcv\",\"cumulative_delta\",\"atr\",\"vix\"],"
+             "\"missing\":null,\"sym\":\"%s\",\"chart\":%d}",
+             sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "bar_snapshot", h);
+    st.header_set = true;
+  }
+
+  SCString j;
+  j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"bar_snapshot\",\"i\":%d", s.t, sc.Symbol.GetChars(), s.bar);
+  {
+    static const char* const k[] = {"o", "h", "l", "c"};
+    const double v[] = {s.o, s.h, s.l, s.c};
+    AppendSnapValues(j, s.have, SNAP_BASE, k, v, 4, "%.8f");
+  }
+  {
+    static const char* const k[] = {"v", "bidvol", "askvol"};
+    const double v[] = {s.v, s.bidvol, s.askvol};
+    AppendSnapValues(j, s.have, SNAP_BASE, k, v, 3, "%.0f");
+  }
+  {
+    static const char* const k[] = {"vwap", "vwap_up1", "vwap_dn1", "vwap_up2", "vwap_dn2", "vwap_up3", "vwap_dn3"};
+    const double v[] = {s.vwap, s.up1, s.dn1, s.up2, s.dn2, s.up3, s.dn3};
+    AppendSnapValues(j, s.have, SNAP_VWAP, k, v, 7, "%.8f");
+  }
+  {
+    static const char* const k[] = {"vah", "val", "vpoc", "pvah", "pval", "ppoc"};
+    const double v[] = {s.vah, s.val, s.vpoc, s.pvah, s.pval, s.ppoc};
+    AppendSnapValues(j, s.have, SNAP_VVA, k, v, 6, "%.8f");
+  }
+  {
+    static const char* const k[] = {"nbcv_ask", "nbcv_bid", "nbcv_delta", "nbcv_trades", "nbcv_cum", "nbcv_pressure"};
+    const double v[] = {s.nbcv_ask, s.nbcv_bid, s.nbcv_delta, s.nbcv_trades, s.nbcv_cum, (double)s.pressure};
+    AppendSnapValues(j, s.have, SNAP_NBCV, k, v, 6, "%.0f");
+  }
+  {
+    static const char* const k[] = {"cum_delta"};
+    AppendSnapValues(j, s.have, SNAP_CD, k, &s.cum_delta, 1, "%.6f");
+  }
+  {
+    static const char* const k[] = {"atr"};
+    AppendSnapValues(j, s.have, SNAP_ATR, k, &s.atr, 1, "%.6f");
+  }
+  {
+    static const char* const k[] = {"vix"};
+    AppendSnapValues(j, s.have, SNAP_VIX, k, &s.vix, 1, "%.6f");
+  }
+  j.AppendFormat(",\"chart\":%d}", sc.ChartNumber);
+  WriteToSpecializedFile(sc.ChartNumber, "bar_snapshot", j);
+  s = BarSnapshot();
+}
+
+// ========== GRILLE TEMPORELLE À PAS FIXE (flux grid) ==========
+// Grille active (NULL si Input[61] = 0); reconfigurée si le pas change
+static MiaTimeGrid* GridFor(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  TimeGridState& st = ctx.time_grid;
+  const int step = sc.Input[61].GetInt();
+  if (step != st.step_ms) {
+    st.step_ms = step;
+    st.rows.clear();
+    if (step > 0) {
+      st.grid.Configure(step, TIME_GRID_MAX_FILL_MS);
+      st.rows.reserve(64);
+      SCString h;
+      h.Format("{\"type\":\"header\",\"stream\":\"grid\",\"version\":1,\"step_ms\":%d,\"max_fill_ms\":%d,"
+               "\"fill\":\"forward\",\"cols\":[",
+               step, TIME_GRID_MAX_FILL_MS);
+      for (int c = 0; c < MIA_GRID_COLUMNS; ++c) h.AppendFormat("%s\"%s\"", c ? "," : "", kMiaGridColumnNames[c]);
+      h.AppendFormat("],\"sym\":\"%s\",\"chart\":%d}", sc.Symbol.GetChars(), sc.ChartNumber);
+      SetDailyFileHeader(sc.ChartNumber, "grid", h);
+    }
+  }
+  return step > 0 ? &st.grid : NULL;
+}
+
+// Écrit les points de grille produits depuis le dernier appel
+static void FlushTimeGrid(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  TimeGridState& st = ctx.time_grid;
+  for (const MiaGridRow& r : st.rows) {
+    SCString j;
+    j.Format("{\"t\":%.9f,\"sym\":\"%s\",\"type\":\"grid\",\"v\":[", r.DateTime(), sc.Symbol.GetChars());
+    for (int c = 0; c < MIA_GRID_COLUMNS; ++c) {
+      if (c) j += ",";
+      if (r.Has(c)) j.AppendFormat("%.8g", r.v[c]);
+      else j += "null";
+    }
+    j.AppendFormat("],\"cv\":%.0f,\"n\":%u,\"chart\":%d}", r.cell_vol, r.cell_trades, sc.ChartNumber);
+    WriteToSpecializedFile(sc.ChartNumber, "grid", j);
+  }
+  st.rows.clear();
+}
+
+// ========== PROXIMITÉ DES NIVEAUX MENTHORQ (flux level_events) ==========
+// Dernière valeur de chaque subgraph d'une famille sur le chart MenthorQ
+static void PollChartLevels(SCStudyInterfaceRef& sc, LevelProximityState& st, int chart, int group, int studyId,
+                            int sgCount, double tick) {
+  if (studyId <= 0) sgCount = 0;
+  for (int sg = 0; sg < sgCount; ++sg) {
+    SCFloatArray arr;
+    const int n = ReadSubgraph(sc, studyId, sg, arr, chart) ? arr.GetArraySize() : 0;
+    st.raw[sg] = n > 0 ? arr[n - 1] : 0.0f;
+  }
+  MiaNormalizeLevels(st.raw, sgCount, sc.RealTimePriceMultiplier, tick, st.ticks);
+  st.table.UpdateGroup(group, st.ticks, sgCount, st.changes);
+}
+
+// Relecture des niveaux à chaque nouveau bar (ou changement de réglages)
+static void RefreshLevelProximity(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  LevelProximityState& st = ctx.level_prox;
+  const int chart = sc.Input[62].GetInt();
+  if (chart <= 0 || sc.ArraySize <= 0) return;
+
+  if (!st.header_set) {
+    SCString h;
+    h.Format("{\"type\":\"header\",\"stream\":\"level_events\",\"version\":1,\"menthorq_chart\":%d,"
+             "\"touch_ticks\":%d,\"zone_half_ticks\":%d,\"sym\":\"%s\",\"chart\":%d}",
+             chart, sc.Input[65].GetInt(), sc.Input[66].GetInt(), sc.Symbol.GetChars(), sc.ChartNumber);
+    SetDailyFileHeader(sc.ChartNumber, "level_events", h);
+    st.header_set = true;
+  }
+
+  bool rebuild = false;
+  if (sc.Input[65].GetInt() != st.touch || sc.Input[66].GetInt() != st.half) {
+    st.touch = sc.Input[65].GetInt();
+    st.half = sc.Input[66].GetInt();
+    st.prox.Configure(st.touch, st.half);
+    rebuild = true;
+  }
+
+  const int i = sc.ArraySize - 1;
+  if (i == st.last_polled_bar && !rebuild) return;
+  st.last_polled_bar = i;
+
+  const double tick = MiaTickSize(sc);
+  st.changes.clear();
+  PollChartLevels(sc, st, chart, MQ_GAMMA, sc.Input[63].GetInt(), MENTHORQ_GAMMA_SG_COUNT, tick);
+  PollChartLevels(sc, st, chart, MQ_BLIND, sc.Input[64].GetInt(), MENTHORQ_BLIND_SG_COUNT, tick);
+  if (st.changes.empty() && !rebuild) return;
+
+  st.prox.SetLevels(st.table.Sorted(), 1u << MQ_GAMMA, MQ_BLIND);
+
+  // Colonnes MenthorQ de la grille temporelle
+  if (MiaTimeGrid* g = GridFor(sc, ctx)) {
+    for (const MiaLevelChange& c : st.changes) {
+      if (c.level.group != MQ_GAMMA) continue;
+      SCString name;
+      MenthorQLevelName(c.level.group, c.level.sg, name);
+      const int col = MiaGridColumnForLevel(name.GetChars());
+      if (c.kind == MIA_LEVEL_REMOVED) g->Clear(col);
+      else g->Set(col, MiaTicksToPrice(c.level.ticks, tick));
+    }
+  }
+}
+
+// Situe le trade par rapport aux niveaux; une ligne par touch / cross
+static void CheckLevelProximity(SCStudyInterfaceRef& sc, G3Context& ctx, double t, int64_t pxTicks) {
+  LevelProximityState& st = ctx.level_prox;
+  st.events.clear();
+  st.prox.OnTrade(pxTicks, st.events);
+  if (st.events.empty()) return;
+
+  const double tick = MiaTickSize(sc);
+  for (const MiaProximityEvent& e : st.events) {
+    const char* type = e.kind == MIA_PROX_CROSS ? "level_cross" : "level_touch";
+    SCString name, j;
+    if (e.zone) {
+      const MiaProximityZone& z = st.prox.Zones()[e.index];
+      const MiaLevel& first = st.prox.Zoned()[z.first];
+      MenthorQLevelName(first.group, first.sg, name);
+      j.Format(R"({"t":%.6f,"sym":"%s","type":"%s","level_type":"%s","zone_lo":%.8f,"zone_hi":%.8f,"n":%d,"px":%.8f,"dir":%d,"chart":%d})",
+               t, sc.Symbol.GetChars(), type, name.GetChars(), MiaTicksToPrice(z.lo, tick),
+               MiaTicksToPrice(z.hi, tick), z.count, MiaTicksToPrice(e.px, tick), e.dir, sc.ChartNumber);
+    } else {
+      const MiaLevel& l = st.prox.Levels()[e.index];
+      MenthorQLevelName(l.group, l.sg, name);
+      j.Format(R"({"t":%.6f,"sym":"%s","type":"%s","level_type":"%s","level":%.8f,"px":%.8f,"dist":%lld,"dir":%d,"chart":%d})",
+               t, sc.Symbol.GetChars(), type, name.GetChars(), MiaTicksToPrice(l.ticks, tick),
+               MiaTicksToPrice(e.px, tick), (long long)e.dist, e.dir, sc.ChartNumber);
+    }
+    WriteToSpecializedFile(sc.ChartNumber, "level_events", j);
+  }
+}
+
+// ========== DÉDUPLICATION (sym, t, i) ==========
 // Fonction de déduplication améliorée
-static bool ShouldWriteData(const char* symbol, double timestamp, double barIndex) {
+static bool ShouldWriteData(G3Context& ctx, const char* symbol, double timestamp, double barIndex) {
   std::string symKey = std::string(symbol);
-  LastKey& lk = g_LastKeyBySym[symKey];
+  LastKey& lk = ctx.last_key_by_sym[symKey];
   
   // Vérifier si (sym, t, i) identique
   bool same_ti = (fabs(lk.t - timestamp) < 1e-9) && (fabs(lk.i - barIndex) < 1e-9);
@@ -353,74 +1594,17 @@ static bool ShouldWriteData(const char* symbol, double timestamp, double barInde
 }
 
 // --- AJOUTER : déduplication par (sym|type, t, i)
-static bool ShouldWriteDataWithType(const char* symbol, const char* dataType, double timestamp, double barIndex) {
-  static std::unordered_map<std::string, LastKey> s_LastKeyBySymType;
+static bool ShouldWriteDataWithType(G3Context& ctx, const char* symbol, const char* dataType, double timestamp, double barIndex) {
   std::string key = std::string(symbol) + "|" + std::string(dataType);
-  LastKey& lk = s_LastKeyBySymType[key];
+  LastKey& lk = ctx.last_key_by_sym_type[key];
   bool same_ti = (fabs(lk.t - timestamp) < 1e-9) && (fabs(lk.i - barIndex) < 1e-9);
   lk.t = timestamp;
   lk.i = barIndex;
   return !same_ti; // Écrire si différent
 }
 
-// Anti-duplication simple par (chart, type, key)
-static void WriteIfChanged(int chartNumber, const char* dataType, const std::string& key, const SCString& line) {
-  static std::unordered_map<std::string, std::string> s_last_by_key;
-  auto it = s_last_by_key.find(key);
-  const std::string current = std::string(line.GetChars());
-  if (it != s_last_by_key.end() && it->second == current) {
-    return; // identique, on n'écrit pas
-  }
-  WriteToSpecializedFile(chartNumber, dataType, line);
-  s_last_by_key[key] = current;
-}
-
-// ========== NORMALISATION DES PRIX ==========
-inline double NormalizePx(const SCStudyInterfaceRef& sc, double raw)
-{
-  // 1) Dé-multiplier si besoin
-  const double mult = (sc.RealTimePriceMultiplier != 0.0 ? sc.RealTimePriceMultiplier : 1.0);
-  double px = raw / mult;
-
-  // 2) Correction d'échelle avant arrondi (certains flux arrivent x100)
-  if (px > 10000.0) px /= 100.0;
-
-  // 3) Arrondi au tick
-  px = sc.RoundToTickSize(px, sc.TickSize);
-
-  // 4) Correction d'échelle résiduelle puis arrondi final (sécurité)
-  if (px > 10000.0) px /= 100.0;
-  px = sc.RoundToTickSize(px, sc.TickSize);
-  return px;
-}
-
 // ========== HELPERS D'ACCÈS AUX STUDIES ==========
 
-// Helper pour résoudre automatiquement un Study ID par nom
-static int ResolveStudyID(SCStudyInterfaceRef& sc, int chartNumber, const char* studyName, int fallbackID = 0) {
-  int id = sc.GetStudyIDByName(chartNumber, studyName, 0);
-  if (id <= 0 && fallbackID > 0) {
-    id = fallbackID;
-  }
-  return id;
-}
-
-// Helper pour lire un subgraph avec validation
-static bool ReadSubgraph(SCStudyInterfaceRef& sc, int studyID, int subgraphIndex, SCFloatArray& array, int chartNumber = -1) {
-  if (chartNumber > 0) {
-    sc.GetStudyArrayFromChartUsingID(chartNumber, studyID, subgraphIndex, array);
-    return array.GetArraySize() > 0;
-  } else {
-    sc.GetStudyArrayUsingID(studyID, subgraphIndex, array);
-    return array.GetArraySize() > 0;
-  }
-}
-
-// Helper pour valider qu'une étude a des données valides
-static bool ValidateStudyData(const SCFloatArray& array, int index) {
-  return array.GetArraySize() > index && !std::isnan(array[index]) && !std::isinf(array[index]);
-}
-
 // Helper pour déboguer les Study IDs et subgraphs
 static void DebugStudyInfo(SCStudyInterfaceRef& sc, int studyID, const char* studyName, int subgraphIndex, const char* subgraphName) {
   if (studyID <= 0) {
@@ -448,55 +1632,201 @@ static void DebugStudyInfo(SCStudyInterfaceRef& sc, int studyID, const char* stu
   }
 }
 
-// ========== DÉTECTION DE SUPPORT SEQUENCE ==========
-static void DetectSequenceSupport(const c_SCTimeAndSalesArray& TnS, bool& g_UseSeq)
-{
-    // Cherche un enregistrement avec Sequence > 0 (du plus récent au plus ancien)
-    for (int i = (int)TnS.Size() - 1; i >= 0 && i >= (int)TnS.Size() - 50; --i)
-    {
-        if (TnS[i].Sequence > 0)
-        {
-            g_UseSeq = true;
-            break;
-        }
+// ========== CHECKPOINT WARM-RESTART ==========
+// Snapshot binaire compact de l'état de déduplication (caches, curseurs T&S,
+// DOM, buffers de coalescence) pour qu'un rechargement de la DLL ou un
+// redémarrage de Sierra ne réémette pas de doublons.
+// Format: en-tête (magic, version, chart, date, symbole) puis sections
+// dans un ordre fixe. Les structs POD sont sérialisées avec leur taille:
+// une taille différente (nouvelle version) invalide le checkpoint.
+
+static const uint32_t CKPT_MAGIC   = 0x4B41494D; // "MIAK"
+static const uint32_t CKPT_VERSION = 4;  // v2: bseq depth_book, v3: ladder L2, v4: depthbars
+
+// Un fichier par instance (chart + ID d'étude): deux instances sur le même
+// chart ne partagent pas leur checkpoint
+static std::string CheckpointFilename(int chartNumber, int studyID) {
+  char name[96];
+  snprintf(name, sizeof(name), "g3_state_chart_%d_study_%d.bin", chartNumber, studyID);
+  return MiaStatePath(MIA_DEFAULT_BASE_DIR, name);
+}
+
+static void SaveStateCheckpoint(SCStudyInterfaceRef& sc, const G3Context& ctx) {
+  MiaBinWriter w;
+  w.U32(CKPT_MAGIC);
+  w.U32(CKPT_VERSION);
+  w.I32(sc.ChartNumber);
+  w.I32(MiaToday().AsInt());
+  w.Str(sc.Symbol.GetChars());
+
+  // Caches de déduplication
+  MiaPutMap(w, ctx.last_key_by_sym);
+  MiaPutMap(w, ctx.last_key_by_sym_type);
+  MiaPutMap(w, ctx.last_base_by_sym);
+  MiaPutMap(w, ctx.last_vwap_by_sym);
+  MiaPutMap(w, ctx.last_vva_by_sym);
+  MiaPutMap(w, ctx.last_nbcv_by_sym);
+  MiaPutMap(w, ctx.last_cd_by_sym);
+  MiaPutMap(w, ctx.last_atr_by_sym);
+  MiaPutMap(w, ctx.last_corr_by_sym);
+  MiaPutMap(w, ctx.last_vix_by_sym);
+  MiaPutMap(w, ctx.seq_by_key);
+
+  // Curseurs T&S
+  w.I32(ctx.last_ts_index);
+  w.U32(ctx.last_seq);
+  w.F64(ctx.last_ts_time.GetAsDouble());
+  w.U32(ctx.use_seq ? 1u : 0u);
+  w.U32(ctx.seq_checked ? 1u : 0u);
+
+  // DOM: dernier ladder appliqué au carnet (ticks, taille)
+  for (int side = MIA_BOOK_BID; side <= MIA_BOOK_ASK; ++side) {
+    w.U32((uint32_t)ctx.book.LevelCount(side));
+    for (int lvl = 1; lvl <= ctx.book.LevelCount(side); ++lvl) {
+      w.I64(ctx.book.LevelTicks(side, lvl));
+      w.I32(ctx.book.LevelSize(side, lvl));
     }
+  }
+
+  // Buffers de coalescence (non encore écrits)
+  w.U32((uint32_t)ctx.coalesce_buf_by_key.size());
+  for (const auto& kv : ctx.coalesce_buf_by_key) {
+    w.Str(kv.first);
+    w.Str(kv.second.json.GetChars());
+    w.I32(kv.second.i);
+    w.F64(kv.second.t);
+    w.Str(kv.second.dataType.GetChars());
+  }
+
+  // Séquence du flux depth_book (reste croissante après un redémarrage)
+  w.I64((int64_t)ctx.depth_book.bseq);
+
+  // Dernier bar clos exporté en depthbars (pas de double rattrapage)
+  w.F64(ctx.depth_bars.last_closed_t);
+
+  // Écriture atomique: fichier temporaire puis remplacement
+  if (!MiaWriteFileAtomic(CheckpointFilename(sc.ChartNumber, sc.StudyGraphInstanceID), w.buf)) return;
+
+  if (ShouldLog(sc, LOG_VERBOSE)) {
+    SCString msg;
+    msg.Format("STATE: checkpoint saved (%d bytes, seq=%u, coalesce=%d)",
+               (int)w.buf.size(), ctx.last_seq, (int)ctx.coalesce_buf_by_key.size());
+    DebugLog(sc, msg.GetChars());
+  }
 }
 
-// ========== CONSTANTES DE MAPPING ==========
-
-// VWAP Subgraphs (selon le mapping standard)
-#define VWAP_SG_MAIN 1
-#define VWAP_SG_UP1  2
-#define VWAP_SG_DN1  3
-#define VWAP_SG_UP2  4
-#define VWAP_SG_DN2  5
-#define VWAP_SG_UP3  6
-#define VWAP_SG_DN3  7
-
-// VVA Subgraphs (Volume Value Area) — indexation 0-based
-#define VVA_SG_POC 0
-#define VVA_SG_VAH 1
-#define VVA_SG_VAL 2
-
-// NBCV Subgraphs (Numbers Bars Calculated Values) — mapping confirmé
-// (Ask=5, Bid=6, Delta=0, Trades=11, CumDelta=9, TotalVol=12, Delta%=10, Ask%=16, Bid%=17)
-#define NBCV_SG_DELTA         0
-#define NBCV_SG_ASK_VOLUME    5
-#define NBCV_SG_BID_VOLUME    6
-#define NBCV_SG_TRADES        11
-#define NBCV_SG_CUMULATIVE     9
-#define NBCV_SG_TOTAL_VOLUME  12
-#define NBCV_SG_DELTA_PCT     10
-#define NBCV_SG_ASK_PCT       16
-#define NBCV_SG_BID_PCT       17
-
-// VIX Subgraph
-#define VIX_SG_LAST 4
-
-// MenthorQ Subgraphs
-#define MENTHORQ_GAMMA_SG_COUNT 19
-#define MENTHORQ_BLIND_SG_COUNT 9
-#define MENTHORQ_SWING_SG_COUNT 9
+// Charge le checkpoint s'il correspond au même chart, symbole et jour.
+// Retourne false (état vierge) si absent, périmé ou corrompu.
+static bool LoadStateCheckpoint(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  std::string data;
+  if (!MiaReadFile(CheckpointFilename(sc.ChartNumber, sc.StudyGraphInstanceID), data)) return false;
+
+  MiaBinReader r{data.data(), data.data() + data.size()};
+  if (r.U32() != CKPT_MAGIC || r.U32() != CKPT_VERSION) return false;
+  if (r.I32() != sc.ChartNumber) return false;
+  if (r.I32() != MiaToday().AsInt()) return false;      // nouveaux fichiers du jour: repartir à vide
+  if (r.Str() != std::string(sc.Symbol.GetChars())) return false;
+
+  MiaGetMap(r, ctx.last_key_by_sym);
+  MiaGetMap(r, ctx.last_key_by_sym_type);
+  MiaGetMap(r, ctx.last_base_by_sym);
+  MiaGetMap(r, ctx.last_vwap_by_sym);
+  MiaGetMap(r, ctx.last_vva_by_sym);
+  MiaGetMap(r, ctx.last_nbcv_by_sym);
+  MiaGetMap(r, ctx.last_cd_by_sym);
+  MiaGetMap(r, ctx.last_atr_by_sym);
+  MiaGetMap(r, ctx.last_corr_by_sym);
+  MiaGetMap(r, ctx.last_vix_by_sym);
+  MiaGetMap(r, ctx.seq_by_key);
+
+  const int32_t  tsIndex  = r.I32();
+  const uint32_t lastSeq  = r.U32();
+  const double   lastTime = r.F64();
+  const bool     useSeq   = r.U32() != 0;
+  const bool     checked  = r.U32() != 0;
+
+  MiaLadder ladder;
+  for (int side = MIA_BOOK_BID; side <= MIA_BOOK_ASK && r.ok; ++side) {
+    std::vector<std::pair<int64_t, int64_t>>& lv = (side == MIA_BOOK_BID) ? ladder.bids : ladder.asks;
+    const uint32_t n = r.U32();
+    for (uint32_t k = 0; k < n && k < MiaL2Book::kMaxLevels && r.ok; ++k) {
+      const int64_t ticks = r.I64();
+      lv.emplace_back(ticks, (int64_t)r.I32());
+    }
+  }
+
+  std::unordered_map<std::string, BufPayload> bufs;
+  const uint32_t nbuf = r.U32();
+  for (uint32_t k = 0; k < nbuf && r.ok; ++k) {
+    std::string key = r.Str();
+    BufPayload slot;
+    slot.json = r.Str().c_str();
+    slot.i = r.I32();
+    slot.t = r.F64();
+    slot.dataType = r.Str().c_str();
+    if (r.ok) bufs[key] = slot;
+  }
+
+  const uint64_t bookSeq = (uint64_t)r.I64();
+  const double depthBarsClosedT = r.F64();
+
+  if (!r.ok) {
+    // Checkpoint tronqué: on repart d'un état vierge plutôt que d'un état partiel
+    ctx.last_key_by_sym.clear(); ctx.last_key_by_sym_type.clear();
+    ctx.last_base_by_sym.clear(); ctx.last_vwap_by_sym.clear(); ctx.last_vva_by_sym.clear();
+    ctx.last_nbcv_by_sym.clear(); ctx.last_cd_by_sym.clear(); ctx.last_atr_by_sym.clear();
+    ctx.last_corr_by_sym.clear(); ctx.last_vix_by_sym.clear(); ctx.seq_by_key.clear();
+    return false;
+  }
+
+  ctx.last_ts_index = tsIndex;
+  ctx.last_seq     = lastSeq;
+  ctx.last_ts_time  = SCDateTime(lastTime);
+  ctx.use_seq      = useSeq;
+  ctx.seq_checked  = checked;
+  ctx.ts_restored  = true;
+  ctx.coalesce_buf_by_key.swap(bufs);
+  ctx.book.Apply(ladder, NULL);  // niveaux déjà écrits: pas de réémission au premier appel
+  ctx.depth_bars.last_closed_t = depthBarsClosedT;
+  ctx.depth_book.bseq = bookSeq;  // relevé contre la fin du fichier du jour au premier snapshot
+
+  if (ShouldLog(sc, LOG_KEY)) {
+    SCString msg;
+    msg.Format("STATE: checkpoint loaded (seq=%u, ts_index=%d, coalesce=%d)",
+               ctx.last_seq, ctx.last_ts_index, (int)ctx.coalesce_buf_by_key.size());
+    DebugLog(sc, msg.GetChars());
+  }
+  return true;
+}
+
+// Checkpoint périodique (Input[34] secondes, 0 = seulement au LastCall)
+static void CheckStateCheckpoint(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  const int interval = sc.Input[34].GetInt();
+  if (sc.Input[33].GetInt() == 0 || interval <= 0) return;
+  time_t now = time(NULL);
+  if (now - ctx.last_checkpoint >= interval) {
+    SaveStateCheckpoint(sc, ctx);
+    ctx.last_checkpoint = now;
+  }
+}
+
+// ========== FLUX METRICS ==========
+// Ligne "metrics" périodique (Input[35] secondes, 0 = désactivé): lignes/octets
+// par flux pour ce chart + état du writer partagé (file, erreurs, handles)
+static void CheckStreamMetrics(SCStudyInterfaceRef& sc, G3Context& ctx) {
+  const int interval = sc.Input[35].GetInt();
+  if (interval <= 0) return;
+  time_t now = time(NULL);
+  if (ctx.last_metrics_emit == 0) { ctx.last_metrics_emit = now; return; }
+  if (now - ctx.last_metrics_emit < interval) return;
+  ctx.last_metrics_emit = now;
+
+  MiaWriterStats ws;
+  MiaGetWriter()->GetStats(ws);
+  const std::string line = MiaFormatMetricsLine(sc.ChartNumber, sc.CurrentSystemDateTime.GetAsDouble(),
+                                                MiaMetricsForChart(sc.ChartNumber), ws);
+  WriteToSpecializedFile(sc.ChartNumber, "metrics", SCString(line.c_str()));
+}
 
 // =======================================================================
 // ===============    STUDY ENTRYPOINT (G3 CORE)    =======================
@@ -613,14 +1943,152 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
     sc.Input[32].Name = "Prod Log Level (0=Errors,1=Key,2=Verbose)";
     sc.Input[32].SetInt(0);
 
+    // --- Inputs Warm Restart ---
+    sc.Input[33].Name = "Warm Restart State (0=Off,1=On)";
+    sc.Input[33].SetInt(1);
+    sc.Input[34].Name = "State Checkpoint Interval (s, 0=LastCall only)";
+    sc.Input[34].SetInt(60);
+
+    // --- Inputs Runtime ---
+    sc.Input[35].Name = "Stream Metrics Interval (s, 0=Off)";
+    sc.Input[35].SetInt(0);
+
+    // --- Inputs Depth ---
+    sc.Input[36].Name = "Depth Conflation Window (ms, 0=per-level lines)";
+    sc.Input[36].SetInt(0);
+
+    // --- Carnet complet + diffs numérotés (flux depth_book) ---
+    sc.Input[37].Name = "Depth Book Snapshot Interval (s, 0=Off)";
+    sc.Input[37].SetInt(0);
+
+    // --- Features order flow (flux of_features) ---
+    sc.Input[38].Name = "OF Features Interval (ms, 0=Off)";
+    sc.Input[38].SetInt(0);
+    sc.Input[39].Name = "OF Features Top-N Levels";
+    sc.Input[39].SetInt(5);
+
+    // --- Footprint par bar (flux footprint, VAP) ---
+    sc.Input[40].Name = "Footprint Interval (ms, 0=Off)";
+    sc.Input[40].SetInt(0);
+
+    // --- Profondeur historique par bar (flux binaire depthbars) ---
+    sc.Input[41].Name = "Depth Bars Export (0=Off,1=Live,2=Live+Backfill)";
+    sc.Input[41].SetInt(0);
+    sc.Input[42].Name = "Depth Bars Backfill Bars (0=all)";
+    sc.Input[42].SetInt(1440);
+    sc.Input[43].Name = "Depth Bars Live Interval (s)";
+    sc.Input[43].SetInt(5);
+
+    // --- Agrégation des sweeps (flux trade_meta) ---
+    sc.Input[44].Name = "Meta-Trade Stream (0/1)";
+    sc.Input[44].SetInt(0);
+
+    // --- Absorption / icebergs (flux absorption) ---
+    sc.Input[45].Name = "Absorption Min Volume (0=Off)";
+    sc.Input[45].SetInt(0);
+    sc.Input[46].Name = "Iceberg Min Hidden Volume";
+    sc.Input[46].SetInt(100);
+    sc.Input[47].Name = "Iceberg Min Refills";
+    sc.Input[47].SetInt(3);
+
+    // --- Résumé BUY/SELL glissant (flux trade_summary) ---
+    sc.Input[48].Name = "Trade Summary Interval (ms, 0=Off)";
+    sc.Input[48].SetInt(1000);
+
+    // --- Gros lots (flux large_trades, percentile dynamique) ---
+    sc.Input[49].Name = "Large Trade Percentile (0=Off)";
+    sc.Input[49].SetFloat(0.0f);
+
+    // --- VPIN (flux vpin) ---
+    sc.Input[50].Name = "VPIN Bucket Volume (0=Off)";
+    sc.Input[50].SetInt(0);
+    sc.Input[51].Name = "VPIN Window (buckets)";
+    sc.Input[51].SetInt(50);
+
+    // --- ATR / corrélation natifs (sans étude Sierra) ---
+    sc.Input[52].Name = "ATR/Correlation Source (0=Study,1=Native)";
+    sc.Input[52].SetInt(0);
+    sc.Input[53].Name = "Native ATR Period";
+    sc.Input[53].SetInt(14);
+    sc.Input[54].Name = "Native Correlation Chart # (0=Off)";
+    sc.Input[54].SetInt(0);
+    sc.Input[55].Name = "Native Correlation Period";
+    sc.Input[55].SetInt(20);
+
+    // --- Bars multi-unités de temps (flux rollup) ---
+    sc.Input[56].Name = "MTF Rollups 5/15/30/60 (0/1)";
+    sc.Input[56].SetInt(0);
+
+    // --- Bars tick / volume / range depuis le T&S (0 = Off) ---
+    sc.Input[57].Name = "Tick Bars (trades per bar, 0=Off)";
+    sc.Input[57].SetInt(0);
+    sc.Input[58].Name = "Volume Bars (contracts per bar, 0=Off)";
+    sc.Input[58].SetInt(0);
+    sc.Input[59].Name = "Range Bars (ticks per bar, 0=Off)";
+    sc.Input[59].SetInt(0);
+
+    // --- Snapshot consolidé par bar clos (flux bar_snapshot) ---
+    sc.Input[60].Name = "Bar Snapshot Stream (0/1)";
+    sc.Input[60].SetInt(0);
+
+    // --- Grille temporelle forward-fill pour l'export ML (flux grid) ---
+    sc.Input[61].Name = "Time Grid Step (ms, 0=Off)";
+    sc.Input[61].SetInt(0);
+
+    // --- Proximité prix / niveaux MenthorQ (flux level_events) ---
+    sc.Input[62].Name = "MenthorQ Levels Chart # (0=Off)";
+    sc.Input[62].SetInt(0);
+    sc.Input[63].Name = "MenthorQ Gamma Levels Study ID";
+    sc.Input[63].SetInt(1);
+    sc.Input[64].Name = "MenthorQ Blind Spots Study ID";
+    sc.Input[64].SetInt(3);
+    sc.Input[65].Name = "Level Touch Distance (ticks)";
+    sc.Input[65].SetInt(2);
+    sc.Input[66].Name = "Blind Spot Zone Half-Width (ticks)";
+    sc.Input[66].SetInt(2);
+
+    return;
+  }
+
+  // Profondeur historique conservée par Sierra seulement si l'export est actif
+  sc.MaintainHistoricalMarketDepthData = (sc.Input[41].GetInt() > 0) ? 1 : 0;
+
+  // ========== CONTEXTE D'INSTANCE ==========
+  G3Context* pctx = (G3Context*)sc.GetPersistentPointer(1);
+
+  // ========== FLUSH FINAL DE SÉCURITÉ ==========
+  // Traité avant tout retour anticipé (déconnexion, T&S vide...) pour
+  // garantir le flush, le checkpoint et la libération du contexte.
+  if (sc.LastCallToFunction) {
+    if (pctx != NULL) {
+      FlushAllBuffers(sc, *pctx, "LAST_CALL");
+      // Fenêtre DOM en cours: émise plutôt que perdue
+      if (sc.Input[36].GetInt() > 0 && pctx->depth_window.total_changes > 0 && sc.ArraySize > 0) {
+        EmitDepthWindow(sc, *pctx, sc.Input[36].GetInt(), sc.Input[0].GetInt(), true);
+      }
+      // Checkpoint après flush: buffers vides, curseurs à jour -> aucun doublon au redémarrage
+      if (sc.Input[33].GetInt() != 0) SaveStateCheckpoint(sc, *pctx);
+      delete pctx;
+      sc.SetPersistentPointer(1, NULL);
+      if (ShouldLog(sc, LOG_KEY)) {
+        DebugLog(sc, "DEBUG G3: Study terminated - final flush completed");
+      }
+      // Lignes encore en file dans le writer partagé -> disque
+      MiaGetWriter()->Flush();
+    }
     return;
   }
 
+  if (pctx == NULL) {
+    pctx = new G3Context;
+    sc.SetPersistentPointer(1, pctx);
+  }
+  G3Context& ctx = *pctx;
+
   if (sc.ServerConnectionState != SCS_CONNECTED) return;
 
   // DEBUG: Log startup
-  static bool startup_logged = false;
-  if (!startup_logged) {
+  if (!ctx.startup_logged) {
     SCString startupMsg;
     startupMsg.Format("DEBUG G3: MIA_Dumper_G3_Core STARTED - Chart=%d, Symbol=%s, ArraySize=%d", 
                      sc.ChartNumber, sc.Symbol.GetChars(), sc.ArraySize);
@@ -638,9 +2106,20 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
     TouchDailyFile(sc.ChartNumber, "cumulative_delta");
     TouchDailyFile(sc.ChartNumber, "atr");
     TouchDailyFile(sc.ChartNumber, "vix");
+    TouchDailyFile(sc.ChartNumber, "metrics");
+    if (sc.Input[36].GetInt() > 0) {
+      EmitDepthWindow(sc, ctx, sc.Input[36].GetInt(), sc.Input[0].GetInt(), false);  // déclare l'en-tête
+      TouchDailyFile(sc.ChartNumber, "depth_conflated");
+    }
     // Correlation désactivée par défaut sur G3: pas de fichier journalier
     // TouchDailyFile(sc.ChartNumber, "correlation");
-    startup_logged = true;
+
+    // Reprise à chaud: caches de dédup + curseurs T&S du dernier checkpoint
+    if (sc.Input[33].GetInt() != 0) {
+      LoadStateCheckpoint(sc, ctx);
+      ctx.last_checkpoint = time(NULL);
+    }
+    ctx.startup_logged = true;
   }
 
   const int max_levels = sc.Input[0].GetInt();
@@ -667,8 +2146,12 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
               SCString j;
               j.Format(R"({"t":%.6f,"sym":"%s","type":"quote","kind":"BIDASK","bid":%.8f,"ask":%.8f,"bq":%d,"aq":%d,"seq":%u,"chart":%d})",
                        tsec, sc.Symbol.GetChars(), bid, ask, ts.BidSize, ts.AskSize, ts.Sequence, sc.ChartNumber);
-              WriteToSpecializedFile(sc.ChartNumber, "quote", j);
-              UpdateMetrics(sc, "quote");
+              // BBO: état conflatable (sous contre-pression seul le dernier est écrit)
+              WriteLatestState(sc.ChartNumber, "quote", "BBO", j);
+              UpdateMetrics(sc, ctx, "quote");
+
+              if (MiaTimeGrid* g = GridFor(sc, ctx))
+                g->SetQuote(tsec, bid, ask, ts.BidSize, ts.AskSize, ctx.time_grid.rows);
           }
           // IMPORTANT: ne pas convertir les quotes en trades
           return;
@@ -681,6 +2164,7 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
           const double bid = NormalizePx(sc, sc.Bid);
           const double ask = NormalizePx(sc, sc.Ask);
           const double tol = sc.TickSize * 0.51; // tolérance demi-tick
+          const int day = MiaSessionDay(sc, MiaTsToChartTime(sc, ts.DateTime));  // remises à zéro de session
 
           // Inférence de l'agresseur
           const char* aggr = "TRADE"; // par défaut
@@ -692,30 +2176,75 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
               else if (fabs(px - bid) <= tol) aggr = "SELL";
           }
 
+          // Percentile de taille (P² de session) si le flux large_trades est actif
+          const double large_pct = sc.Input[49].GetFloat();
+          double size_pct = -1.0, large_thr = -1.0;
+          if (large_pct > 0.0) size_pct = TagTradeSize(sc, ctx, day, (double)ts.Volume, large_pct, &large_thr);
+
           // Ecriture trade détaillée
           SCString j;
-          j.Format(R"({"t":%.6f,"sym":"%s","type":"trade","side":"%s","px":%.8f,"vol":%d,"seq":%u,"tt":%d,"chart":%d})",
-                   tsec, sc.Symbol.GetChars(), aggr, px, ts.Volume, ts.Sequence, tt, sc.ChartNumber);
+          if (size_pct >= 0.0) {
+              j.Format(R"({"t":%.6f,"sym":"%s","type":"trade","side":"%s","px":%.8f,"vol":%d,"seq":%u,"tt":%d,"pct":%.1f,"chart":%d})",
+                       tsec, sc.Symbol.GetChars(), aggr, px, ts.Volume, ts.Sequence, tt, size_pct, sc.ChartNumber);
+          } else {
+              j.Format(R"({"t":%.6f,"sym":"%s","type":"trade","side":"%s","px":%.8f,"vol":%d,"seq":%u,"tt":%d,"chart":%d})",
+                       tsec, sc.Symbol.GetChars(), aggr, px, ts.Volume, ts.Sequence, tt, sc.ChartNumber);
+          }
           WriteToSpecializedFile(sc.ChartNumber, "trade", j);
-          UpdateMetrics(sc, "trade");
-
-          // Résumé périodique BUY/SELL (cumulatif)
-          static unsigned long long s_buyTrades = 0ULL, s_sellTrades = 0ULL;
-          static unsigned long long s_buyVol = 0ULL,    s_sellVol  = 0ULL;
-          if (aggr == std::string("BUY")) { s_buyTrades++; s_buyVol += (unsigned long long)ts.Volume; }
-          else if (aggr == std::string("SELL")) { s_sellTrades++; s_sellVol += (unsigned long long)ts.Volume; }
-
-          const unsigned long long totalTrades = s_buyTrades + s_sellTrades;
-          if ((totalTrades % 256ULL) == 0ULL) {
-              SCString s;
-              s.Format(R"({"t":%.6f,"sym":"%s","type":"trade_summary","buy_trades":%llu,"sell_trades":%llu,"buy_vol":%llu,"sell_vol":%llu,"chart":%d})",
-                       tsec, sc.Symbol.GetChars(), (unsigned long long)s_buyTrades, (unsigned long long)s_sellTrades,
-                       (unsigned long long)s_buyVol, (unsigned long long)s_sellVol, sc.ChartNumber);
-              WriteToSpecializedFile(sc.ChartNumber, "trade_summary", s);
+          UpdateMetrics(sc, ctx, "trade");
+
+          // Gros lot: taille strictement au-dessus du quantile de session
+          if (large_thr > 0.0 && (double)ts.Volume > large_thr) {
+              SCString lj;
+              lj.Format(R"({"t":%.6f,"sym":"%s","type":"large_trades","side":"%s","px":%.8f,"vol":%d,"pct":%.1f,"thr":%.2f,"seq":%u,"chart":%d})",
+                        tsec, sc.Symbol.GetChars(), aggr, px, ts.Volume, size_pct, large_thr, ts.Sequence, sc.ChartNumber);
+              WriteToSpecializedFile(sc.ChartNumber, "large_trades", lj);
+          }
+
+          const int side = (aggr[0] == 'B') ? 1 : (aggr[0] == 'S' ? -1 : 0);
+          const int64_t pxTicks = MiaPriceToTicks(px, MiaTickSize(sc));
+
+          // Méta-trade: le print précédent est clos dès que côté ou DateTime change
+          if (sc.Input[44].GetInt() != 0) {
+              MiaMetaTrade done;
+              if (ctx.meta_trades.Add(tsec, side, pxTicks, (uint32_t)ts.Volume, ts.Sequence, done)) {
+                  EmitMetaTrade(sc, done);
+              }
           }
+
+          // Absorption: volume imputé au niveau passif, évalué en fin de lot
+          if (sc.Input[45].GetInt() > 0 && sc.UsesMarketDepthData &&
+              (!ctx.absorption.before.bids.empty() || !ctx.absorption.before.asks.empty())) {
+              if (ctx.absorption.session_date != day) {
+                  ctx.absorption.engine.Reset();
+                  ctx.absorption.session_date = day;
+              }
+              ctx.absorption.engine.OnTrade(tsec, side, pxTicks, (uint32_t)ts.Volume, ctx.absorption.before);
+          }
+
+          // Résumé BUY/SELL: fenêtres glissantes + session (émis à cadence fixe)
+          AddTradeFlow(ctx, day, tsec, side, (uint32_t)ts.Volume);
+
+          // VPIN: buckets de volume égal
+          if (sc.Input[50].GetInt() > 0) AddVpinTrade(sc, ctx, day, tsec, side, (double)ts.Volume);
+
+          // Bars tick / volume / range
+          AddTradeBars(sc, ctx, tsec, side, pxTicks, (uint32_t)ts.Volume);
+
+          // Grille temporelle: dernier trade + volume de la cellule
+          if (MiaTimeGrid* g = GridFor(sc, ctx)) g->AddTrade(tsec, px, (double)ts.Volume, ctx.time_grid.rows);
+
+          // Proximité des niveaux MenthorQ: touch / cross
+          if (sc.Input[62].GetInt() > 0) CheckLevelProximity(sc, ctx, tsec, pxTicks);
       }
   };
 
+  // ---- Niveaux MenthorQ (chart 10) relus à chaque nouveau bar ----
+  RefreshLevelProximity(sc, ctx);
+
+  // ---- Barrière bar_snapshot: le bar précédent est complet ----
+  if (sc.Input[60].GetInt() != 0 && sc.ArraySize > 1) EmitBarSnapshot(sc, ctx);
+
   // ---- BaseData (avec déduplication améliorée) ----
   if (sc.ArraySize > 0) {
     const int i = sc.ArraySize - 1;
@@ -735,8 +2264,6 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
     // Appliquer le filtrage des volumes si activé
     if (sc.Input[17].GetInt() != 0) {
       // Recalcul dynamique des stats (fenêtre 100 barres)
-      static double volume_median = 0.0;
-      static double volume_iqr = 0.0;
       if (sc.ArraySize >= 10) {
         std::vector<double> volumes;
         int start = ((int)sc.ArraySize - 100 > 0) ? (int)sc.ArraySize - 100 : 0;
@@ -745,23 +2272,28 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
           volumes.push_back(sc.BaseDataIn[SC_VOLUME][j]);
         }
         std::sort(volumes.begin(), volumes.end());
-        volume_median = volumes[volumes.size() / 2];
+        ctx.volume_median = volumes[volumes.size() / 2];
         double q1 = volumes[volumes.size() / 4];
         double q3 = volumes[3 * volumes.size() / 4];
-        volume_iqr = q3 - q1;
+        ctx.volume_iqr = q3 - q1;
       }
 
-      if (volume_iqr > 0) {
+      if (ctx.volume_iqr > 0) {
         double multiplier = sc.Input[18].GetFloat();
-        v = CapVolume(v, volume_median, volume_iqr, multiplier);
-        bvol = CapVolume(bvol, volume_median, volume_iqr, multiplier);
-        avol = CapVolume(avol, volume_median, volume_iqr, multiplier);
+        v = CapVolume(v, ctx.volume_median, ctx.volume_iqr, multiplier);
+        bvol = CapVolume(bvol, ctx.volume_median, ctx.volume_iqr, multiplier);
+        avol = CapVolume(avol, ctx.volume_median, ctx.volume_iqr, multiplier);
       }
     }
 
+    if (BarSnapshot* bs = SnapSlot(sc, ctx, i)) {
+      bs->o = o; bs->h = h; bs->l = l; bs->c = c; bs->v = v; bs->bidvol = bvol; bs->askvol = avol;
+      bs->have |= SNAP_BASE;
+    }
+
     // Détection de changement d'état
     std::string symKey = std::string(symbol);
-    LastBasedata& lb = g_LastBaseBySym[symKey];
+    LastBasedata& lb = ctx.last_base_by_sym[symKey];
     bool payload_changed = 
       has_changed(c, lb.c) || has_changed(o, lb.o) || has_changed(h, lb.h) || has_changed(l, lb.l) ||
       has_changed(bvol, lb.bidvol) || has_changed(avol, lb.askvol) || has_changed(v, lb.v);
@@ -771,7 +2303,7 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
     bool bar_closed = (barStatus == BHCS_BAR_HAS_CLOSED);
 
     // Déduplication par type
-    bool should_write_type = ShouldWriteDataWithType(symbol, "basedata", t, barIndex);
+    bool should_write_type = ShouldWriteDataWithType(ctx, symbol, "basedata", t, barIndex);
 
     // Écrire si : changement de payload OU clôture de barre OU nouvelle clé (typée)
     if (payload_changed || bar_closed || should_write_type) {
@@ -788,7 +2320,6 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
 
   // ---- VWAP export (avec déduplication améliorée) ----
   if (sc.Input[2].GetInt() != 0 && sc.ArraySize > 0) {
-    static int vwapID = -2; // -2: à résoudre, -1: introuvable, >0: OK
     const int i = sc.ArraySize - 1;
     const double t = sc.BaseDateTimeIn[i].GetAsDouble();
     const double barIndex = (double)i;
@@ -796,11 +2327,11 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
     
     // DEBUG: Log VWAP attempt
     SCString debugMsg;
-    debugMsg.Format("DEBUG G3: VWAP attempt - Input[2]=%d, ArraySize=%d, i=%d, vwapID=%d", 
-                   sc.Input[2].GetInt(), sc.ArraySize, i, vwapID);
+    debugMsg.Format("DEBUG G3: VWAP attempt - Input[2]=%d, ArraySize=%d, i=%d, ctx.vwap_id=%d", 
+                   sc.Input[2].GetInt(), sc.ArraySize, i, ctx.vwap_id);
     if (ShouldLog(sc, 2)) DebugLog(sc, debugMsg.GetChars());
   
-    if (vwapID == -2) {
+    if (ctx.vwap_id == -2) {
       int cand[6]; // Augmenter le nombre de candidats
       cand[0] = sc.Input[3].GetInt(); // ID forcé
       cand[1] = ResolveStudyID(sc, sc.ChartNumber, "Volume Weighted Average Price", 0);
@@ -824,15 +2355,15 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
         }
       }
   
-      vwapID = -1;
+      ctx.vwap_id = -1;
       for (int k = 0; k < 6; ++k) {
         if (cand[k] > 0) {
           SCFloatArray test;
           if (ReadSubgraph(sc, cand[k], VWAP_SG_MAIN, test)) {
             if (ValidateStudyData(test, i)) { 
-              vwapID = cand[k];
+              ctx.vwap_id = cand[k];
               SCString debugMsg3;
-              debugMsg3.Format("DEBUG G3: VWAP found - ID=%d, ArraySize=%d", vwapID, test.GetArraySize());
+              debugMsg3.Format("DEBUG G3: VWAP found - ID=%d, ArraySize=%d", ctx.vwap_id, test.GetArraySize());
               if (ShouldLog(sc, 1)) DebugLog(sc, debugMsg3.GetChars());
               break;
             }
@@ -840,14 +2371,14 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
         }
       }
       
-      if (vwapID == -1) {
+      if (ctx.vwap_id == -1) {
         if (ShouldLog(sc, 1)) DebugLog(sc, "DEBUG G3: VWAP NOT FOUND - No valid study data");
       }
     }
   
-    if (vwapID > 0) {
+    if (ctx.vwap_id > 0) {
       SCFloatArray VWAP, UP1, DN1, UP2, DN2, UP3, DN3;
-      ReadSubgraph(sc, vwapID, VWAP_SG_MAIN, VWAP);
+      ReadSubgraph(sc, ctx.vwap_id, VWAP_SG_MAIN, VWAP);
       
       // DEBUG: Log VWAP data reading
       SCString debugMsg4;
@@ -857,16 +2388,16 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       
       int bands = sc.Input[4].GetInt();
       if (bands >= 1) {
-        ReadSubgraph(sc, vwapID, VWAP_SG_UP1, UP1);
-        ReadSubgraph(sc, vwapID, VWAP_SG_DN1, DN1);
+        ReadSubgraph(sc, ctx.vwap_id, VWAP_SG_UP1, UP1);
+        ReadSubgraph(sc, ctx.vwap_id, VWAP_SG_DN1, DN1);
       }
       if (bands >= 2) {
-        ReadSubgraph(sc, vwapID, VWAP_SG_UP2, UP2);
-        ReadSubgraph(sc, vwapID, VWAP_SG_DN2, DN2);
+        ReadSubgraph(sc, ctx.vwap_id, VWAP_SG_UP2, UP2);
+        ReadSubgraph(sc, ctx.vwap_id, VWAP_SG_DN2, DN2);
       }
       if (bands >= 3) {
-        ReadSubgraph(sc, vwapID, VWAP_SG_UP3, UP3);
-        ReadSubgraph(sc, vwapID, VWAP_SG_DN3, DN3);
+        ReadSubgraph(sc, ctx.vwap_id, VWAP_SG_UP3, UP3);
+        ReadSubgraph(sc, ctx.vwap_id, VWAP_SG_DN3, DN3);
       }
 
       if (ValidateStudyData(VWAP, i)) {
@@ -881,18 +2412,11 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
         double dn3 = (ValidateStudyData(DN3, i) ? NormalizePx(sc, DN3[i]) : 0);
 
         // Garde-fou: corriger inversion éventuelle des bandes et forcer l'ordre
-        auto fix_band = [&](double& up, double& dn, double base){
-          if (up < base && dn > base) {
-            double tmp = up; up = dn; dn = tmp;
-          }
-        };
-        fix_band(up1, dn1, v);
-        fix_band(up2, dn2, v);
-        fix_band(up3, dn3, v);
+        FixVwapBands(v, up1, dn1, up2, dn2, up3, dn3);
 
         // Validation de qualité des données VWAP
         if (v < 0 || v > 10000) {
-          g_quality.invalid_values++;
+          ctx.quality.invalid_values++;
           if (ShouldLog(sc, LOG_ERROR)) {
             SCString qualityMsg;
             qualityMsg.Format("QUALITY: Invalid VWAP value: %.2f", v);
@@ -900,15 +2424,17 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
           }
         }
 
-        // Forcer ordre monotone: up1 <= up2 <= up3 et dn1 >= dn2 >= dn3
-        if (up2 < up1) { double tmp = up1; up1 = up2; up2 = tmp; }
-        if (up3 < up2) { double tmp = up2; up2 = up3; up3 = tmp; }
-        if (dn2 > dn1) { double tmp = dn1; dn1 = dn2; dn2 = tmp; }
-        if (dn3 > dn2) { double tmp = dn2; dn2 = dn3; dn3 = tmp; }
+        if (BarSnapshot* bs = SnapSlot(sc, ctx, i)) {
+          ctx.bar_snap.src.vwap_id = ctx.vwap_id;
+          ctx.bar_snap.src.vwap_bands = bands;
+          bs->vwap = v; bs->up1 = up1; bs->dn1 = dn1; bs->up2 = up2; bs->dn2 = dn2; bs->up3 = up3; bs->dn3 = dn3;
+          bs->have |= SNAP_VWAP;
+        }
+        if (MiaTimeGrid* g = GridFor(sc, ctx)) g->Set(MIA_GRID_VWAP, v);
 
         // Détection de changement d'état
         std::string symKey = std::string(symbol);
-        LastVWAP& lv = g_LastVWAPBySym[symKey];
+        LastVWAP& lv = ctx.last_vwap_by_sym[symKey];
         bool payload_changed = 
           has_changed(v, lv.vwap) || has_changed(up1, lv.up1) || has_changed(dn1, lv.dn1) ||
           has_changed(up2, lv.up2) || has_changed(dn2, lv.dn2) || has_changed(up3, lv.up3) || has_changed(dn3, lv.dn3);
@@ -918,7 +2444,7 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
         bool bar_closed = (barStatus == BHCS_BAR_HAS_CLOSED);
 
         // Déduplication par type
-        bool should_write_type = ShouldWriteDataWithType(symbol, "vwap", t, barIndex);
+        bool should_write_type = ShouldWriteDataWithType(ctx, symbol, "vwap", t, barIndex);
 
         // Toujours bufferiser en mode coalesce (sinon seq)
         SCString j;
@@ -930,21 +2456,21 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
         std::string key = MakeBufKey(sc.ChartNumber, symbol, dtype);
 
         if (seqMode == 1) {
-          uint32_t seq = ++g_SeqByKey[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
+          uint32_t seq = ++ctx.seq_by_key[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
           SCString withSeq = InjectSeqField(j, seq);
           WriteToSpecializedFile(sc.ChartNumber, dtype, withSeq);
         } else {
           if (!bar_closed) {
-            BufPayload& slot = g_CoalesceBufByKey[key];
+            BufPayload& slot = ctx.coalesce_buf_by_key[key];
             if (slot.i >= 0 && slot.i != i) {
               WriteToSpecializedFile(sc.ChartNumber, dtype, slot.json);
             }
             slot.json = j; slot.i = i; slot.t = t; slot.dataType = dtype;
           } else {
-            auto itbuf = g_CoalesceBufByKey.find(key);
-            if (itbuf != g_CoalesceBufByKey.end()) {
+            auto itbuf = ctx.coalesce_buf_by_key.find(key);
+            if (itbuf != ctx.coalesce_buf_by_key.end()) {
               WriteToSpecializedFile(sc.ChartNumber, dtype, itbuf->second.json);
-              g_CoalesceBufByKey.erase(itbuf);
+              ctx.coalesce_buf_by_key.erase(itbuf);
             } else {
               WriteToSpecializedFile(sc.ChartNumber, dtype, j);
             }
@@ -1016,11 +2542,10 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
     }
     
     // DEBUG: Test VVA Study IDs (une seule fois, en verbose)
-    static bool s_vva_ids_logged = false;
-    if (!s_vva_ids_logged && ShouldLog(sc, LOG_VERBOSE)) {
+    if (!ctx.vva_ids_logged && ShouldLog(sc, LOG_VERBOSE)) {
       DebugStudyInfo(sc, id_curr, "VVA_CURRENT", VVA_SG_POC, "POC");
       DebugStudyInfo(sc, id_prev, "VVA_PREVIOUS", VVA_SG_POC, "POC");
-      s_vva_ids_logged = true;
+      ctx.vva_ids_logged = true;
     }
 
     auto read_vva = [&](int id, double& vah, double& val, double& vpoc)
@@ -1044,7 +2569,7 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
 
     // Validation de qualité des données VVA
     if (val > vpoc || vpoc > vah) {
-      g_quality.invalid_values++;
+      ctx.quality.invalid_values++;
       if (ShouldLog(sc, LOG_ERROR)) {
         SCString qualityMsg;
         qualityMsg.Format("QUALITY: Invalid VVA order: val=%.2f, vpoc=%.2f, vah=%.2f", val, vpoc, vah);
@@ -1052,9 +2577,21 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       }
     }
 
+    if (BarSnapshot* bs = SnapSlot(sc, ctx, i)) {
+      ctx.bar_snap.src.vva_curr = id_curr;
+      ctx.bar_snap.src.vva_prev = id_prev;
+      bs->vah = vah; bs->val = val; bs->vpoc = vpoc; bs->pvah = pvah; bs->pval = pval; bs->ppoc = ppoc;
+      bs->have |= SNAP_VVA;
+    }
+    if (MiaTimeGrid* g = GridFor(sc, ctx)) {
+      g->Set(MIA_GRID_VAH, vah);
+      g->Set(MIA_GRID_VAL, val);
+      g->Set(MIA_GRID_VPOC, vpoc);
+    }
+
     // Détection de changement d'état
     std::string symKey = std::string(symbol);
-    LastVVA& lv = g_LastVVABySym[symKey];
+    LastVVA& lv = ctx.last_vva_by_sym[symKey];
     bool payload_changed = 
       has_changed(vah, lv.vah) || has_changed(val, lv.val) || has_changed(vpoc, lv.vpoc) ||
       has_changed(pvah, lv.pvah) || has_changed(pval, lv.pval) || has_changed(ppoc, lv.ppoc);
@@ -1064,7 +2601,7 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
     bool bar_closed = (barStatus == BHCS_BAR_HAS_CLOSED);
 
     // Déduplication par type
-    bool should_write_type = ShouldWriteDataWithType(symbol, "vva", t, barIndex);
+    bool should_write_type = ShouldWriteDataWithType(ctx, symbol, "vva", t, barIndex);
 
     // Écrire si : changement de payload OU clôture de barre OU nouvelle clé (typée)
     if (payload_changed || bar_closed || should_write_type) {
@@ -1077,21 +2614,21 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       std::string key = MakeBufKey(sc.ChartNumber, symbol, dtype);
 
       if (seqMode == 1) {
-        uint32_t seq = ++g_SeqByKey[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
+        uint32_t seq = ++ctx.seq_by_key[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
         SCString withSeq = InjectSeqField(j, seq);
         WriteToSpecializedFile(sc.ChartNumber, dtype, withSeq);
       } else {
         if (!bar_closed) {
-          BufPayload& slot = g_CoalesceBufByKey[key];
+          BufPayload& slot = ctx.coalesce_buf_by_key[key];
           if (slot.i >= 0 && slot.i != i) {
             WriteToSpecializedFile(sc.ChartNumber, dtype, slot.json);
           }
           slot.json = j; slot.i = i; slot.t = t; slot.dataType = dtype;
         } else {
-          auto itbuf = g_CoalesceBufByKey.find(key);
-          if (itbuf != g_CoalesceBufByKey.end()) {
+          auto itbuf = ctx.coalesce_buf_by_key.find(key);
+          if (itbuf != ctx.coalesce_buf_by_key.end()) {
             WriteToSpecializedFile(sc.ChartNumber, dtype, itbuf->second.json);
-            g_CoalesceBufByKey.erase(itbuf);
+            ctx.coalesce_buf_by_key.erase(itbuf);
           } else {
             WriteToSpecializedFile(sc.ChartNumber, dtype, j);
           }
@@ -1115,15 +2652,13 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
   if (sc.Input[8].GetInt() != 0 && sc.ArraySize > 0 && sc.VolumeAtPriceForBars)
   {
     const int last = sc.ArraySize - 1;
-    static int last_pvwap_bar = -1;
 
 
     // Force l'exécution au moins une fois par session
-    static bool pvwap_executed_today = false;
-    if (last != last_pvwap_bar || !pvwap_executed_today)
+    if (last != ctx.last_pvwap_bar || !ctx.pvwap_executed_today)
     {
-      last_pvwap_bar = last;
-      pvwap_executed_today = true;
+      ctx.last_pvwap_bar = last;
+      ctx.pvwap_executed_today = true;
 
       // Trouver le début de la session du jour - LOGIQUE ALTERNATIVE
       int currStart = last;
@@ -1195,6 +2730,21 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
     }
   }
 
+  // ========== FOOTPRINT (VAP par bar, Input[40] ms) ==========
+  if (sc.Input[40].GetInt() > 0 && sc.ArraySize > 0 && sc.VolumeAtPriceForBars) {
+    UpdateFootprint(sc, ctx, sc.Input[40].GetInt());
+  }
+
+  // ========== PROFONDEUR HISTORIQUE PAR BAR (Input[41]) ==========
+  if (sc.Input[41].GetInt() > 0 && sc.ArraySize > 0) {
+    UpdateDepthBars(sc, ctx, sc.Input[41].GetInt(), sc.Input[42].GetInt(), sc.Input[43].GetInt());
+  }
+
+  // ========== BARS 5/15/30/60 MIN (Input[56]) ==========
+  if (sc.Input[56].GetInt() != 0 && sc.ArraySize > 1) {
+    UpdateRollups(sc, ctx);
+  }
+
   // ===== NBCV FOOTPRINT (avec déduplication améliorée) =====
   if (sc.Input[10].GetInt() != 0 && sc.ArraySize > 0)
   {
@@ -1283,7 +2833,7 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
 
         // Validation de qualité des données NBCV
         if (totalVolume < (askVolume + bidVolume)) {
-          g_quality.invalid_values++;
+          ctx.quality.invalid_values++;
           if (ShouldLog(sc, LOG_ERROR)) {
             SCString qualityMsg;
             qualityMsg.Format("QUALITY: NBCV total < ask+bid: total=%.0f, ask=%.0f, bid=%.0f", 
@@ -1296,38 +2846,25 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
         const double bidAskRatio = (askPct > 0.0) ? (bidPct / askPct) : 0.0;
         const double askBidRatio = (bidPct > 0.0) ? (askPct / bidPct) : 0.0;
 
-        // Seuils configurables
-        const double min_vol   = sc.Input[19].GetFloat();  // Min Total Volume
-        const double th_ratio  = sc.Input[20].GetFloat();  // Min |Delta Ratio|
-        const double th_ratioR = sc.Input[21].GetFloat();  // Min Ask/Bid or Bid/Ask Ratio
-
-        // ----------------- Logique Bull/Bear -----------------
-        int pressure_bullish = 0;
-        int pressure_bearish = 0;
-
-        if (totalVolume >= min_vol) {
-          // Signe du delta = côté dominant brut
-          if (delta > 0.0) {
-            // Acheteurs dominants
-            if (fabs(dltPct) >= th_ratio || askBidRatio >= th_ratioR) {
-              pressure_bullish = 1;
-            }
-          } else if (delta < 0.0) {
-            // Vendeurs dominants
-            if (fabs(dltPct) >= th_ratio || bidAskRatio >= th_ratioR) {
-              pressure_bearish = 1;
-            }
-          }
-        }
+        // ----------------- Logique Bull/Bear (seuils Inputs 19-21) -----------------
+        const int of_pressure = NbcvPressure(sc, delta, totalVolume, askPct, bidPct, dltPct);  // 1=BULL, -1=BEAR, 0=NEUTRAL
+        const int pressure_bullish = (of_pressure > 0);
+        const int pressure_bearish = (of_pressure < 0);
 
-        // Drapeau unifié
-        int of_pressure = 0; // 1=BULL, -1=BEAR, 0=NEUTRAL
-        if (pressure_bullish) of_pressure = 1;
-        else if (pressure_bearish) of_pressure = -1;
+        if (BarSnapshot* bs = SnapSlot(sc, ctx, i)) {
+          ctx.bar_snap.src.nbcv_id = nbcv_id;
+          bs->nbcv_ask = askVolume; bs->nbcv_bid = bidVolume; bs->nbcv_delta = delta;
+          bs->nbcv_trades = numberOfTrades; bs->nbcv_cum = cumulativeDelta; bs->pressure = of_pressure;
+          bs->have |= SNAP_NBCV;
+        }
+        if (MiaTimeGrid* g = GridFor(sc, ctx)) {
+          g->Set(MIA_GRID_NBCV_DELTA, delta);
+          g->Set(MIA_GRID_NBCV_CUM, cumulativeDelta);
+        }
 
         // Détection de changement d'état
         std::string symKey = std::string(symbol);
-        LastNBCV& ln = g_LastNBCVBySym[symKey];
+        LastNBCV& ln = ctx.last_nbcv_by_sym[symKey];
         bool payload_changed = 
           has_changed(askVolume, ln.askVolume) || has_changed(bidVolume, ln.bidVolume) ||
           has_changed(delta, ln.delta) || has_changed(totalVolume, ln.totalVolume) ||
@@ -1339,7 +2876,7 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
         bool bar_closed = (barStatus == BHCS_BAR_HAS_CLOSED);
 
         // Déduplication par type
-        bool should_write_type = ShouldWriteDataWithType(symbol, "nbcv", t, barIndex);
+        bool should_write_type = ShouldWriteDataWithType(ctx, symbol, "nbcv", t, barIndex);
 
         // Écrire si : changement de payload OU clôture de barre OU nouvelle clé (typée)
         if (payload_changed || bar_closed || should_write_type) {
@@ -1352,21 +2889,21 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
           std::string key = MakeBufKey(sc.ChartNumber, symbol, dtype);
 
           if (seqMode == 1) {
-            uint32_t seq = ++g_SeqByKey[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
+            uint32_t seq = ++ctx.seq_by_key[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
             SCString withSeq = InjectSeqField(j, seq);
             WriteToSpecializedFile(sc.ChartNumber, dtype, withSeq);
           } else {
             if (!bar_closed) {
-              BufPayload& slot = g_CoalesceBufByKey[key];
+              BufPayload& slot = ctx.coalesce_buf_by_key[key];
               if (slot.i >= 0 && slot.i != i) {
                 WriteToSpecializedFile(sc.ChartNumber, dtype, slot.json);
               }
               slot.json = j; slot.i = i; slot.t = t; slot.dataType = dtype;
             } else {
-              auto itbuf = g_CoalesceBufByKey.find(key);
-              if (itbuf != g_CoalesceBufByKey.end()) {
+              auto itbuf = ctx.coalesce_buf_by_key.find(key);
+              if (itbuf != ctx.coalesce_buf_by_key.end()) {
                 WriteToSpecializedFile(sc.ChartNumber, dtype, itbuf->second.json);
-                g_CoalesceBufByKey.erase(itbuf);
+                ctx.coalesce_buf_by_key.erase(itbuf);
               } else {
                 WriteToSpecializedFile(sc.ChartNumber, dtype, j);
               }
@@ -1388,60 +2925,76 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
   }
 
   // ---- DOM live (niveaux 1..max_levels) ----
+  // Le DOM est lu une fois dans le ladder puis appliqué au carnet L2: les
+  // lignes par niveau, depth_conflated, depth_book et of_features sont toutes
+  // dérivées du carnet. Input[36] > 0: conflation temporelle; Input[37] > 0:
+  // depth_book; Input[38] > 0: of_features; Input[45] > 0: absorption.
+  const int depth_window_ms = sc.Input[36].GetInt();
+  const int book_interval_s = sc.Input[37].GetInt();
   if (sc.UsesMarketDepthData) {
-    static double s_last_bid_price[256];
-    static int    s_last_bid_size[256];
-    static double s_last_ask_price[256];
-    static int    s_last_ask_size[256];
-    
+    const double tick = MiaTickSize(sc);
+    MiaLadder& ladder = ctx.dom_ladder;
+    // Absorption: le ladder précédent est la taille affichée avant les prints du lot à venir
+    if (sc.Input[45].GetInt() > 0) std::swap(ctx.absorption.before, ladder);
+    ladder.Clear();
     for (int lvl = 1; lvl <= max_levels && lvl < 256; ++lvl) {
       s_MarketDepthEntry eBid;
-      bool gotB = sc.GetBidMarketDepthEntryAtLevel(eBid, lvl);
-      if (gotB && eBid.Price != 0.0 && eBid.Quantity != 0) {
-        const double t = sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble();
-        double p = (lvl == 1 ? NormalizePx(sc, sc.Bid) : NormalizePx(sc, eBid.Price));
+      if (sc.GetBidMarketDepthEntryAtLevel(eBid, lvl) && eBid.Price != 0.0 && eBid.Quantity != 0) {
+        const double p = (lvl == 1 ? NormalizePx(sc, sc.Bid) : NormalizePx(sc, eBid.Price));
         const int q = (lvl == 1 ? sc.BidSize : (int)eBid.Quantity);
-        if (!(p == s_last_bid_price[lvl] && q == s_last_bid_size[lvl])) {
-          SCString j;
-          j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"depth\",\"side\":\"BID\",\"lvl\":%d,\"price\":%.8f,\"size\":%d,\"chart\":%d}",
-                   t, sc.Symbol.GetChars(), lvl, p, q, sc.ChartNumber);
-          WriteToSpecializedFile(sc.ChartNumber, "depth", j);
-          s_last_bid_price[lvl] = p; s_last_bid_size[lvl] = q;
-        }
+        ladder.bids.emplace_back(MiaPriceToTicks(p, tick), q);
       }
-
       s_MarketDepthEntry eAsk;
-      bool gotA = sc.GetAskMarketDepthEntryAtLevel(eAsk, lvl);
-      if (gotA && eAsk.Price != 0.0 && eAsk.Quantity != 0) {
-        const double t = sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble();
-        double p = (lvl == 1 ? NormalizePx(sc, sc.Ask) : NormalizePx(sc, eAsk.Price));
+      if (sc.GetAskMarketDepthEntryAtLevel(eAsk, lvl) && eAsk.Price != 0.0 && eAsk.Quantity != 0) {
+        const double p = (lvl == 1 ? NormalizePx(sc, sc.Ask) : NormalizePx(sc, eAsk.Price));
         const int q = (lvl == 1 ? sc.AskSize : (int)eAsk.Quantity);
-        if (!(p == s_last_ask_price[lvl] && q == s_last_ask_size[lvl])) {
+        ladder.asks.emplace_back(MiaPriceToTicks(p, tick), q);
+      }
+    }
+
+    ctx.book.Apply(ladder, book_interval_s > 0 ? &ctx.depth_book.ops : NULL);
+
+    // Seuls les niveaux du masque de changement sont sérialisés
+    const double t = sc.BaseDateTimeIn[sc.ArraySize - 1].GetAsDouble();
+    for (int side = MIA_BOOK_BID; side <= MIA_BOOK_ASK; ++side) {
+      const bool bid = (side == MIA_BOOK_BID);
+      const MiaLevelMask& changed = ctx.book.ChangedLevels(side);
+      const int count = ctx.book.LevelCount(side);
+      for (int i = changed.Next(0); i >= 0 && i < count; i = changed.Next(i + 1)) {
+        const int lvl = i + 1;
+        const double p = MiaTicksToPrice(ctx.book.LevelTicks(side, lvl), tick);
+        const int q = ctx.book.LevelSize(side, lvl);
+        if (depth_window_ms > 0) {
+          AccumulateDepthChange(ctx.depth_window, bid, lvl, p, q);
+        } else {
           SCString j;
-          j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"depth\",\"side\":\"ASK\",\"lvl\":%d,\"price\":%.8f,\"size\":%d,\"chart\":%d}",
-                   t, sc.Symbol.GetChars(), lvl, p, q, sc.ChartNumber);
-          WriteToSpecializedFile(sc.ChartNumber, "depth", j);
-          s_last_ask_price[lvl] = p; s_last_ask_size[lvl] = q;
+          j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"depth\",\"side\":\"%s\",\"lvl\":%d,\"price\":%.8f,\"size\":%d,\"chart\":%d}",
+                   t, sc.Symbol.GetChars(), bid ? "BID" : "ASK", lvl, p, q, sc.ChartNumber);
+          WriteLatestState(sc.ChartNumber, "depth", std::string(bid ? "BID|" : "ASK|") + std::to_string(lvl), j);
         }
       }
     }
+    if (depth_window_ms > 0) EmitDepthWindow(sc, ctx, depth_window_ms, max_levels, false);
+    if (book_interval_s > 0) EmitDepthBook(sc, ctx, book_interval_s);
+    if (sc.Input[38].GetInt() > 0) UpdateOfFeatures(sc, ctx, sc.Input[38].GetInt(), sc.Input[39].GetInt());
   }
 
+  // ========== CHECKPOINT D'ÉTAT ET LIGNE METRICS ==========
+  // Avant le lot T&S: ses retours anticipés (rien de nouveau) ne doivent pas
+  // retarder le checkpoint ni la ligne metrics périodiques
+  CheckStateCheckpoint(sc, ctx);
+  CheckStreamMetrics(sc, ctx);
+
   // ========== T&S BATCH + SÉQUENCE (ZÉRO PERTE) ==========
-  if (sc.Input[12].GetInt() != 0 || sc.Input[13].GetInt() != 0) {
+  // Lambda: ses retours anticipés (rien de nouveau) ne sautent pas les
+  // sections suivantes de l'appel
+  auto RunTSBatch = [&]() -> void {
     c_SCTimeAndSalesArray TnS;
     sc.GetTimeAndSales(TnS);
     const int sz = (int)TnS.Size();
     if (sz <= 0) return;
 
-    // États persistants pour batch + séquence
-    static int        g_LastTsIndex = 0;         // fallback index
-    static uint32_t   g_LastSeq     = 0;         // progression par séquence
-    static SCDateTime s_LastTsTime(0.0);         // fallback par temps
-    static int        s_stale_loops = 0;
-
-    const bool use_seq_input = (sc.Input[31].GetInt() != 0); // "Intrabar Seq Mode"
-    static bool g_UseSeq = use_seq_input;                    // ou détection auto ailleurs
+    // États persistants pour batch + séquence: curseurs dans le contexte (ctx)
 
     // Paramètres batch
     const int BATCH_SIZE       = 1000;           // taille de lot
@@ -1450,39 +3003,48 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
     const int STALE_LIMIT      = 10;             // nb de cycles "stale" avant repositionnement
 
     // Première détection du support du Sequence
-    static bool seqChecked = false;
-    if (!seqChecked) { 
-      DetectSequenceSupport(TnS, g_UseSeq); 
-      seqChecked = true; 
+    if (!ctx.seq_checked) { 
+      ctx.use_seq = (sc.Input[31].GetInt() != 0); // "Intrabar Seq Mode" ou détection auto
+      DetectSequenceSupport(TnS, ctx.use_seq); 
+      ctx.seq_checked = true; 
       if (ShouldLog(sc, LOG_KEY)) {
         SCString seqMsg;
-        seqMsg.Format("DEBUG G3: T&S Sequence support detected: %s", g_UseSeq ? "YES" : "NO");
+        seqMsg.Format("DEBUG G3: T&S Sequence support detected: %s", ctx.use_seq ? "YES" : "NO");
         DebugLog(sc, seqMsg.GetChars());
       }
     }
 
     // --- Détection stale ---
     uint32_t seq_tail = (sz > 0 ? TnS[sz-1].Sequence : 0);
-    if ((g_UseSeq && seq_tail == g_LastSeq) || (!g_UseSeq && g_LastTsIndex >= sz)) {
-      s_stale_loops++;
+    if ((ctx.use_seq && seq_tail == ctx.last_seq) || (!ctx.use_seq && ctx.last_ts_index >= sz)) {
+      ctx.stale_loops++;
     } else {
-      s_stale_loops = 0;
+      ctx.stale_loops = 0;
     }
 
     // --- Point de départ ---
     int start = 0;
-    if (g_UseSeq) {
-      // 1) Normal: trouver le 1er idx avec Sequence > g_LastSeq (scan fenêtre de fin)
+    if (ctx.use_seq) {
+      // 1) Normal: trouver le 1er idx avec Sequence > ctx.last_seq (scan fenêtre de fin)
       int scan_from = max(0, sz - SCAN_LAST_WINDOW);
       start = sz; // défaut: rien de nouveau
       for (int i = scan_from; i < sz; ++i) {
-        if (TnS[i].Sequence > g_LastSeq) { start = i; break; }
+        if (TnS[i].Sequence > ctx.last_seq) { start = i; break; }
+      }
+
+      // 1b) Reprise après checkpoint avec séquence remise à zéro par le serveur:
+      //     repositionnement par temps sur le dernier enregistrement émis
+      if (ctx.ts_restored && seq_tail < ctx.last_seq && ctx.last_ts_time.GetAsDouble() > 0.0) {
+        start = sz;
+        for (int i = scan_from; i < sz; ++i) {
+          if (TnS[i].DateTime > ctx.last_ts_time) { start = i; break; }
+        }
       }
 
       // 2) Cas "stale" persistant: on ramène sur la queue
-      if (s_stale_loops >= STALE_LIMIT) {
+      if (ctx.stale_loops >= STALE_LIMIT) {
         start = max(0, sz - KEEP_TAIL);
-        s_stale_loops = 0;
+        ctx.stale_loops = 0;
         if (ShouldLog(sc, LOG_KEY)) {
           SCString staleMsg;
           staleMsg.Format("DEBUG G3: T&S stale -> seq tail reposition to %d", start);
@@ -1496,16 +3058,25 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       }
     } else {
       // Fallback index (si pas de Sequence exploitable)
-      if (g_LastTsIndex >= sz) {
+      if (ctx.last_ts_index >= sz) {
         // index dépassé (buffer a tourné) → ramener en queue
-        g_LastTsIndex = max(0, sz - KEEP_TAIL);
+        ctx.last_ts_index = max(0, sz - KEEP_TAIL);
+      }
+      start = ctx.last_ts_index;
+
+      // Reprise après checkpoint: l'index d'avant redémarrage n'a plus de sens,
+      // on se repositionne sur le premier enregistrement postérieur au dernier émis
+      if (ctx.ts_restored && ctx.last_ts_time.GetAsDouble() > 0.0) {
+        start = sz;
+        for (int i = max(0, sz - SCAN_LAST_WINDOW); i < sz; ++i) {
+          if (TnS[i].DateTime > ctx.last_ts_time) { start = i; break; }
+        }
       }
-      start = g_LastTsIndex;
 
       // Cas "stale" persistant → ramener en queue
-      if (s_stale_loops >= STALE_LIMIT) {
+      if (ctx.stale_loops >= STALE_LIMIT) {
         start = max(0, sz - KEEP_TAIL);
-        s_stale_loops = 0;
+        ctx.stale_loops = 0;
         if (ShouldLog(sc, LOG_KEY)) {
           SCString staleMsg;
           staleMsg.Format("DEBUG G3: T&S stale -> index tail reposition to %d", start);
@@ -1514,12 +3085,14 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       }
     }
 
+    ctx.ts_restored = false;
+
     // --- Fin de batch ---
     int end = min(sz, start + BATCH_SIZE);
 
     // --- Traitement ---
-    uint32_t last_seq_seen = g_LastSeq;
-    SCDateTime last_time   = s_LastTsTime;
+    uint32_t last_seq_seen = ctx.last_seq;
+    SCDateTime last_time   = ctx.last_ts_time;
     int processed_count = 0;
 
     for (int i = start; i < end; ++i) {
@@ -1534,26 +3107,38 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       if (ts.DateTime > last_time)       last_time   = ts.DateTime;
     }
 
+    // Fin du T&S disponible: le dernier méta-trade est complet
+    if (end >= sz && sc.Input[44].GetInt() != 0) {
+      MiaMetaTrade done;
+      if (ctx.meta_trades.Flush(done)) EmitMetaTrade(sc, done);
+    }
+
+    if (!ctx.time_grid.rows.empty()) FlushTimeGrid(sc, ctx);
+
     // --- Mise à jour des curseurs ---
-    if (g_UseSeq) {
-      if (end > start && last_seq_seen > 0) g_LastSeq = last_seq_seen;
+    if (ctx.use_seq) {
+      if (end > start && last_seq_seen > 0) ctx.last_seq = last_seq_seen;
 
       // Sécurité: si on est collé à la fin, garde une marge pour les prochains tours
       if (end >= sz - (KEEP_TAIL / 10)) {
         // rien à faire, on traitera la suite au prochain appel
       }
     } else {
-      g_LastTsIndex = end;
+      ctx.last_ts_index = end;
 
       // Si on a "rattrapé" la fin du buffer, conserve une queue pour
       // absorber les rotations sans perdre d'événements
-      if (g_LastTsIndex >= sz - 100) {
-        g_LastTsIndex = max(0, sz - KEEP_TAIL);
+      if (ctx.last_ts_index >= sz - 100) {
+        ctx.last_ts_index = max(0, sz - KEEP_TAIL);
       }
     }
 
-    // Fallback temps (optionnel) si pas de Sequence: tu peux mettre à jour s_LastTsTime
-    s_LastTsTime = last_time;
+    // Fallback temps (optionnel) si pas de Sequence: tu peux mettre à jour ctx.last_ts_time
+    if (last_time > ctx.last_ts_time) ctx.last_ts_steady_ms = MiaSteadyMs();
+    ctx.last_ts_time = last_time;
+
+    // Absorption: niveaux tradés dans ce lot évalués contre le carnet courant
+    if (sc.Input[45].GetInt() > 0 && sc.UsesMarketDepthData && processed_count > 0) UpdateAbsorption(sc, ctx);
 
     // DEBUG: Log batch processing
     if (ShouldLog(sc, LOG_VERBOSE) && processed_count > 0) {
@@ -1562,7 +3147,11 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
                      processed_count, start, end, sz, last_seq_seen);
       DebugLog(sc, batchMsg.GetChars());
     }
-  }
+  };
+  if (sc.Input[12].GetInt() != 0 || sc.Input[13].GetInt() != 0) RunTSBatch();
+
+  // Résumé BUY/SELL: fenêtres glissées même sans nouveau print
+  if (sc.Input[48].GetInt() > 0) UpdateTradeFlow(sc, ctx, sc.Input[48].GetInt());
 
   // ========== CUMULATIVE DELTA EXPORT ==========
   if (sc.Input[14].GetInt() != 0 && sc.ArraySize > 0) {
@@ -1606,14 +3195,19 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
         const double barIndex = (double)i;
         const char* symbol = sc.Symbol.GetChars();
         const double deltaClose = deltaData[i];
+        if (BarSnapshot* bs = SnapSlot(sc, ctx, i)) {
+          ctx.bar_snap.src.cd_id = deltaStudyID;
+          ctx.bar_snap.src.cd_sg = deltaSG;
+          bs->cum_delta = deltaClose; bs->have |= SNAP_CD;
+        }
 
         // NEW: payload_changed vs dernière valeur
         std::string symKey = std::string(symbol);
-        LastCD& lcd = g_LastCDBySym[symKey];
+        LastCD& lcd = ctx.last_cd_by_sym[symKey];
         bool payload_changed = has_changed(deltaClose, lcd.close);
         
         // Déduplication par type
-        bool should_write_type = ShouldWriteDataWithType(symbol, "cumulative_delta", t, barIndex);
+        bool should_write_type = ShouldWriteDataWithType(ctx, symbol, "cumulative_delta", t, barIndex);
         
         // Vérifier clôture de barre
         int barStatus = sc.GetBarHasClosedStatus(i);
@@ -1630,21 +3224,21 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
           std::string key = MakeBufKey(sc.ChartNumber, sc.Symbol.GetChars(), dtype);
 
           if (seqMode == 1) {
-            uint32_t seq = ++g_SeqByKey[MakeSeqKey(sc.ChartNumber, sc.Symbol.GetChars(), dtype, i)];
+            uint32_t seq = ++ctx.seq_by_key[MakeSeqKey(sc.ChartNumber, sc.Symbol.GetChars(), dtype, i)];
             SCString withSeq = InjectSeqField(j, seq);
             WriteToSpecializedFile(sc.ChartNumber, dtype, withSeq);
           } else {
             if (!bar_closed) {
-              BufPayload& slot = g_CoalesceBufByKey[key];
+              BufPayload& slot = ctx.coalesce_buf_by_key[key];
               if (slot.i >= 0 && slot.i != i) {
                 WriteToSpecializedFile(sc.ChartNumber, dtype, slot.json);
               }
               slot.json = j; slot.i = i; slot.t = t; slot.dataType = dtype;
             } else {
-              auto itbuf = g_CoalesceBufByKey.find(key);
-              if (itbuf != g_CoalesceBufByKey.end()) {
+              auto itbuf = ctx.coalesce_buf_by_key.find(key);
+              if (itbuf != ctx.coalesce_buf_by_key.end()) {
                 WriteToSpecializedFile(sc.ChartNumber, dtype, itbuf->second.json);
-                g_CoalesceBufByKey.erase(itbuf);
+                ctx.coalesce_buf_by_key.erase(itbuf);
               } else {
                 WriteToSpecializedFile(sc.ChartNumber, dtype, j);
               }
@@ -1665,6 +3259,8 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
   }
 
   // ========== ATR EXPORT ==========
+  // Input[52] = 1: ATR de Wilder natif (Input[53] bars), indépendant du
+  // layout des études; sinon lecture de l'étude Input[23]/Input[24]
   if (sc.Input[22].GetInt() != 0 && sc.ArraySize > 0) {
     const int i = sc.ArraySize - 1;
     const double t = sc.BaseDateTimeIn[i].GetAsDouble();
@@ -1673,10 +3269,11 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
                              sc.Input[22].GetInt(), sc.ArraySize, i);
     DebugLog(sc, dbg.GetChars());
 
-    int atrStudyID = sc.Input[23].GetInt();
+    const bool native = (sc.Input[52].GetInt() != 0);
+    int atrStudyID = native ? 0 : sc.Input[23].GetInt();
     const int atrSG = sc.Input[24].GetInt();
 
-    if (atrStudyID <= 0) {
+    if (!native && atrStudyID <= 0) {
       int candidates[] = {45};
       for (int k = 0; k < 1; ++k) {
         SCFloatArray test;
@@ -1688,53 +3285,69 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       }
     }
 
-    if (atrStudyID > 0) {
+    double val = 0.0;
+    bool have = false;
+    if (native) {
+      have = NativeAtr(sc, ctx, i, val);
+    } else if (atrStudyID > 0) {
       SCFloatArray atrArr; ReadSubgraph(sc, atrStudyID, atrSG, atrArr);
-      if (ValidateStudyData(atrArr, i)) {
-        const double val = atrArr[i];
-        const double barIndex = (double)i;
-        const char* symbol = sc.Symbol.GetChars();
+      if (ValidateStudyData(atrArr, i)) { val = atrArr[i]; have = true; }
+    }
 
-        std::string symKey = std::string(symbol);
-        LastATR& last = g_LastATRBySym[symKey];
-        bool payload_changed = has_changed(val, last.atr);
+    if (have) {
+      if (BarSnapshot* bs = SnapSlot(sc, ctx, i)) {
+        ctx.bar_snap.src.atr_native = native;
+        ctx.bar_snap.src.atr_id = atrStudyID;
+        ctx.bar_snap.src.atr_sg = atrSG;
+        bs->atr = val; bs->have |= SNAP_ATR;
+      }
+      const double barIndex = (double)i;
+      const char* symbol = sc.Symbol.GetChars();
 
-        bool should_write_type = ShouldWriteDataWithType(symbol, "atr", t, barIndex);
-        bool bar_closed = (sc.GetBarHasClosedStatus(i) == BHCS_BAR_HAS_CLOSED);
+      std::string symKey = std::string(symbol);
+      LastATR& last = ctx.last_atr_by_sym[symKey];
+      bool payload_changed = has_changed(val, last.atr);
 
-        if (payload_changed || bar_closed || should_write_type) {
-          SCString j;
+      bool should_write_type = ShouldWriteDataWithType(ctx, symbol, "atr", t, barIndex);
+      bool bar_closed = (sc.GetBarHasClosedStatus(i) == BHCS_BAR_HAS_CLOSED);
+
+      if (payload_changed || bar_closed || should_write_type) {
+        SCString j;
+        if (native) {
+          j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"atr\",\"i\":%d,\"atr\":%.6f,\"src\":\"native\",\"period\":%d,\"chart\":%d}",
+                   t, symbol, i, val, sc.Input[53].GetInt(), sc.ChartNumber);
+        } else {
           j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"atr\",\"i\":%d,\"atr\":%.6f,\"study\":%d,\"sg\":%d,\"chart\":%d}",
                    t, symbol, i, val, atrStudyID, atrSG, sc.ChartNumber);
+        }
 
-          const int seqMode = sc.Input[31].GetInt();
-          const char* dtype = "atr";
-          std::string key = MakeBufKey(sc.ChartNumber, symbol, dtype);
+        const int seqMode = sc.Input[31].GetInt();
+        const char* dtype = "atr";
+        std::string key = MakeBufKey(sc.ChartNumber, symbol, dtype);
 
-          if (seqMode == 1) {
-            uint32_t seq = ++g_SeqByKey[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
-            SCString withSeq = InjectSeqField(j, seq);
-            WriteToSpecializedFile(sc.ChartNumber, dtype, withSeq);
+        if (seqMode == 1) {
+          uint32_t seq = ++ctx.seq_by_key[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
+          SCString withSeq = InjectSeqField(j, seq);
+          WriteToSpecializedFile(sc.ChartNumber, dtype, withSeq);
+        } else {
+          if (!bar_closed) {
+            BufPayload& slot = ctx.coalesce_buf_by_key[key];
+            if (slot.i >= 0 && slot.i != i) {
+              WriteToSpecializedFile(sc.ChartNumber, dtype, slot.json);
+            }
+            slot.json = j; slot.i = i; slot.t = t; slot.dataType = dtype;
           } else {
-            if (!bar_closed) {
-              BufPayload& slot = g_CoalesceBufByKey[key];
-              if (slot.i >= 0 && slot.i != i) {
-                WriteToSpecializedFile(sc.ChartNumber, dtype, slot.json);
-              }
-              slot.json = j; slot.i = i; slot.t = t; slot.dataType = dtype;
+            auto itbuf = ctx.coalesce_buf_by_key.find(key);
+            if (itbuf != ctx.coalesce_buf_by_key.end()) {
+              WriteToSpecializedFile(sc.ChartNumber, dtype, itbuf->second.json);
+              ctx.coalesce_buf_by_key.erase(itbuf);
             } else {
-              auto itbuf = g_CoalesceBufByKey.find(key);
-              if (itbuf != g_CoalesceBufByKey.end()) {
-                WriteToSpecializedFile(sc.ChartNumber, dtype, itbuf->second.json);
-                g_CoalesceBufByKey.erase(itbuf);
-              } else {
-                WriteToSpecializedFile(sc.ChartNumber, dtype, j);
-              }
+              WriteToSpecializedFile(sc.ChartNumber, dtype, j);
             }
           }
-
-          last.atr = val;
         }
+
+        last.atr = val;
       }
     }
   }
@@ -1781,11 +3394,16 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       
       if (ValidateStudyData(vixArr, i)) {
         const double vixValue = vixArr[i];
+        if (BarSnapshot* bs = SnapSlot(sc, ctx, i)) {
+          ctx.bar_snap.src.vix_id = vixStudyID;
+          ctx.bar_snap.src.vix_sg = vixSG;
+          bs->vix = vixValue; bs->have |= SNAP_VIX;
+        }
+        if (MiaTimeGrid* g = GridFor(sc, ctx)) g->Set(MIA_GRID_VIX, vixValue);
 
         // Détection de changement d'état
         std::string symKey = std::string(symbol);
-        static std::unordered_map<std::string, double> g_LastVIXBySym;
-        double& lastVix = g_LastVIXBySym[symKey];
+        double& lastVix = ctx.last_vix_by_sym[symKey];
         bool payload_changed = has_changed(vixValue, lastVix);
 
         // Vérifier clôture de barre
@@ -1793,7 +3411,7 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
         bool bar_closed = (barStatus == BHCS_BAR_HAS_CLOSED);
 
         // Déduplication par type
-        bool should_write_type = ShouldWriteDataWithType(symbol, "vix", t, barIndex);
+        bool should_write_type = ShouldWriteDataWithType(ctx, symbol, "vix", t, barIndex);
 
         // Écrire si : payload changé OU clôture de barre OU nouvelle clé typée
         if (payload_changed || bar_closed || should_write_type) {
@@ -1806,21 +3424,21 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
           std::string key = MakeBufKey(sc.ChartNumber, symbol, dtype);
 
           if (seqMode == 1) {
-            uint32_t seq = ++g_SeqByKey[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
+            uint32_t seq = ++ctx.seq_by_key[MakeSeqKey(sc.ChartNumber, symbol, dtype, i)];
             SCString withSeq = InjectSeqField(j, seq);
             WriteToSpecializedFile(sc.ChartNumber, dtype, withSeq);
           } else {
             if (!bar_closed) {
-              BufPayload& slot = g_CoalesceBufByKey[key];
+              BufPayload& slot = ctx.coalesce_buf_by_key[key];
               if (slot.i >= 0 && slot.i != i) {
                 WriteToSpecializedFile(sc.ChartNumber, dtype, slot.json);
               }
               slot.json = j; slot.i = i; slot.t = t; slot.dataType = dtype;
             } else {
-              auto itbuf = g_CoalesceBufByKey.find(key);
-              if (itbuf != g_CoalesceBufByKey.end()) {
+              auto itbuf = ctx.coalesce_buf_by_key.find(key);
+              if (itbuf != ctx.coalesce_buf_by_key.end()) {
                 WriteToSpecializedFile(sc.ChartNumber, dtype, itbuf->second.json);
-                g_CoalesceBufByKey.erase(itbuf);
+                ctx.coalesce_buf_by_key.erase(itbuf);
               } else {
                 WriteToSpecializedFile(sc.ChartNumber, dtype, j);
               }
@@ -1861,10 +3479,13 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
   }
 
   // ========== MÉTRIQUES ET FLUSH AUTOMATIQUE ==========
-  CheckAutoFlush(sc);
-  UpdateMetrics(sc, "study");
+  CheckAutoFlush(sc, ctx);
+  UpdateMetrics(sc, ctx, "study");
 
   // ========== CORRELATION EXPORT ==========
+  // Input[52] = 1 et Input[54] > 0: corrélation de Pearson native des
+  // clôtures avec le chart Input[54] sur Input[55] bars; sinon lecture de
+  // l'étude Input[26]/Input[27]
   if (sc.Input[25].GetInt() != 0 && sc.ArraySize > 0) {
     const int i = sc.ArraySize - 1;
     const double t = sc.BaseDateTimeIn[i].GetAsDouble();
@@ -1875,10 +3496,11 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       DebugLog(sc, dbg.GetChars());
     }
 
-    int corrStudyID = sc.Input[26].GetInt();
+    const bool native = (sc.Input[52].GetInt() != 0 && sc.Input[54].GetInt() > 0);
+    int corrStudyID = native ? 0 : sc.Input[26].GetInt();
     const int corrSG = sc.Input[27].GetInt();
 
-    if (corrStudyID <= 0) {
+    if (!native && corrStudyID <= 0) {
       int candidates[] = {46};
       for (int k = 0; k < 1; ++k) {
         SCFloatArray test;
@@ -1893,36 +3515,38 @@ SCSFExport scsf_MIA_Dumper_G3_Core(SCStudyInterfaceRef sc)
       }
     }
 
-    if (corrStudyID > 0) {
+    double cc = 0.0;
+    bool have = false;
+    if (native) {
+      have = NativeCorrelation(sc, ctx, i, cc);
+    } else if (corrStudyID > 0) {
       SCFloatArray corrArr; ReadSubgraph(sc, corrStudyID, corrSG, corrArr);
-      if (ValidateStudyData(corrArr, i)) {
-        const double cc = corrArr[i];
-        const double barIndex = (double)i;
-        const char* symbol = sc.Symbol.GetChars();
+      if (ValidateStudyData(corrArr, i)) { cc = corrArr[i]; have = true; }
+    }
 
-        std::string symKey = std::string(symbol);
-        LastCorr& last = g_LastCorrBySym[symKey];
-        bool payload_changed = has_changed(cc, last.cc);
+    if (have) {
+      const double barIndex = (double)i;
+      const char* symbol = sc.Symbol.GetChars();
 
-        bool should_write_type = ShouldWriteDataWithType(symbol, "correlation", t, barIndex);
-        bool bar_closed = (sc.GetBarHasClosedStatus(i) == BHCS_BAR_HAS_CLOSED);
+      std::string symKey = std::string(symbol);
+      LastCorr& last = ctx.last_corr_by_sym[symKey];
+      bool payload_changed = has_changed(cc, last.cc);
 
-        if (payload_changed || bar_closed || should_write_type) {
-          SCString j;
+      bool should_write_type = ShouldWriteDataWithType(ctx, symbol, "correlation", t, barIndex);
+      bool bar_closed = (sc.GetBarHasClosedStatus(i) == BHCS_BAR_HAS_CLOSED);
+
+      if (payload_changed || bar_closed || should_write_type) {
+        SCString j;
+        if (native) {
+          j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"correlation\",\"i\":%d,\"cc\":%.6f,\"src\":\"native\",\"with_chart\":%d,\"period\":%d,\"chart\":%d}",
+                   t, symbol, i, cc, sc.Input[54].GetInt(), sc.Input[55].GetInt(), sc.ChartNumber);
+        } else {
           j.Format("{\"t\":%.6f,\"sym\":\"%s\",\"type\":\"correlation\",\"i\":%d,\"cc\":%.6f,\"study\":%d,\"sg\":%d,\"chart\":%d}",
                    t, symbol, i, cc, corrStudyID, corrSG, sc.ChartNumber);
-          WriteToSpecializedFile(sc.ChartNumber, "correlation", j);
-          last.cc = cc;
         }
+        WriteToSpecializedFile(sc.ChartNumber, "correlation", j);
+        last.cc = cc;
       }
     }
   }
-
-  // ========== FLUSH FINAL DE SÉCURITÉ ==========
-  if (sc.LastCallToFunction) {
-    FlushAllBuffers(sc, "LAST_CALL");
-    if (ShouldLog(sc, LOG_KEY)) {
-      DebugLog(sc, "DEBUG G3: Study terminated - final flush completed");
-    }
-  }
 }
\ No newline at end of file
@@ -4,7 +4,7 @@
 // Robustesse : résolution par nom d'étude, anti-doublon (Write-If-Changed), gardes VVA, vérifs NBCV, timestamps monotones.
 // © PRO97 / MIA_IA_SYSTEM
 
-#include "sierrachart.h"
+#include "mia_dump_utils.hpp"
 SCDLLName("MIA_Dumper_G4_Studies")
 
 #include <cstdio>
@@ -78,6 +78,13 @@ SCSFExport scsf_MIA_Dumper_G4_Studies(SCStudyInterfaceRef sc)
         return;
     }
 
+    // Dernier appel: vider la file du writer partagé
+    if (sc.LastCallToFunction)
+    {
+        MiaGetWriter()->Flush();
+        return;
+    }
+
     // =========================
     // ====== HELPERS ==========
     // =========================
@@ -148,37 +155,24 @@ SCSFExport scsf_MIA_Dumper_G4_Studies(SCStudyInterfaceRef sc)
         return (total + eps) >= (ask + bid);
     };
 
-    // Format YYYYMMDD à partir d'un SCDateTime
-    auto DateYYYYMMDD = [&](SCDateTime dt)->SCString {
+    // Date calendaire d'un SCDateTime (les fichiers G4 suivent la date de la barre)
+    auto BarDate = [&](SCDateTime dt)->MiaDate {
         int Year=0, Month=0, Day=0, Hour=0, Minute=0, Second=0;
         dt.GetDateTimeYMDHMS(Year, Month, Day, Hour, Minute, Second);
-        SCString s; s.Format("%04d%02d%02d", Year, Month, Day);
-        return s;
+        MiaDate d; d.y = Year; d.m = Month; d.d = Day;
+        return d;
     };
 
-    // Fichier JSONL (append)
-    auto AppendJSONL = [&](const SCString& filename, const SCString& jsonLine){
-        FILE* f = fopen(filename.GetChars(), "ab");
-        if (f)
-        {
-            fwrite(jsonLine.GetChars(), 1, jsonLine.GetLength(), f);
-            fwrite("\n", 1, 1, f);
-            fclose(f);
-        }
-        else
-        {
-            SCString msg; msg.Format("G4: Impossible d'ouvrir %s", filename.GetChars());
-            sc.AddMessageToLog(msg, 1);
-        }
+    // Fichier JSONL (append asynchrone via le writer partagé)
+    auto AppendJSONL = [&](const std::string& filename, const SCString& jsonLine){
+        MiaGetWriter()->Append(filename.c_str(), jsonLine.GetChars(), (size_t)jsonLine.GetLength(),
+                               MIA_PRIO_STUDY, NULL);
     };
 
-    // Build chemin : "<outdir>\\chart_4_<kind>_<yyyymmdd>.jsonl"
-    auto BuildOutfile = [&](const char* kind, SCDateTime dt)->SCString {
+    // Build chemin : "<outdir>\\chart_4_<kind>_<yyyymmdd>.jsonl" (disposition FLAT)
+    auto BuildOutfile = [&](const char* kind, SCDateTime dt)->std::string {
         SCString outdir = In_OutputDir.GetString();
-        SCString d = DateYYYYMMDD(dt);
-        SCString path;
-        path.Format("%s\\chart_4_%s_%s.jsonl", outdir.GetChars(), kind, d.GetChars());
-        return path;
+        return MiaDailyPath(MIA_LAYOUT_FLAT, outdir.GetChars(), 4, kind, BarDate(dt));
     };
 
     // Write-If-Changed cache par (kind,i)
@@ -438,28 +432,3 @@ SCSFExport scsf_MIA_Dumper_G4_Studies(SCStudyInterfaceRef sc)
         else sc.AddMessageToLog("G4 Correlation: timestamp non monotone -> skip", 1);
     }
 }
-
-                      sym.GetChars(), t, i, cumdelta);
-          AppendJSONL(fn, line);
-          lcd.cumdelta = cumdelta;
-        }
-      }
-    }
-  }
-}
-                      sym.GetChars(), t, i, cumdelta);
-          AppendJSONL(fn, line);
-          lcd.cumdelta = cumdelta;
-        }
-      }
-    }
-  }
-}
-                      sym.GetChars(), t, i, cumdelta);
-          AppendJSONL(fn, line);
-          lcd.cumdelta = cumdelta;
-        }
-      }
-    }
-  }
-}
\ No newline at end of file
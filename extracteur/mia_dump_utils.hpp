@@ -1,78 +1,182 @@
 #pragma once
+// ========== RUNTIME COMMUN DES DUMPERS MIA ==========
+// En-tête unique inclus par toutes les DLL (G3, G4, G8, G10): écriture des
+// fichiers quotidiens via le writer partagé du processus, chemins, prix,
+// sérialisation, métriques et helpers d'accès aux études Sierra.
+// Copier ce fichier ET le dossier mia_runtime\ dans ACS_Source avec les .cpp.
 
 #include "sierrachart.h"
-#ifdef _WIN32
-  #include <windows.h>
-#endif
+#include "mia_runtime/mia_clock.hpp"
+#include "mia_runtime/mia_paths.hpp"
+#include "mia_runtime/mia_writer.hpp"
+#include "mia_runtime/mia_serializer.hpp"
+#include "mia_runtime/mia_price.hpp"
+#include "mia_runtime/mia_metrics.hpp"
+
 #include <time.h>
+#include <string.h>
 #include <cmath>
 #include <unordered_map>
 #include <string>
 #include <vector>
 using std::fabs;
 
-// ========== UTILITAIRES COMMUNS ==========
-
-// Création du répertoire de sortie
-static void EnsureOutDir() {
-#ifdef _WIN32
-  CreateDirectoryA("D:\\MIA_IA_system", NULL);
-#endif
-}
-
-// Génération du nom de fichier quotidien par chart et type
-static SCString DailyFilenameForChartType(int chartNumber, const char* dataType) {
-  time_t now = time(NULL);
-  struct tm* lt = localtime(&now);
-  int y = lt ? (lt->tm_year + 1900) : 1970;
-  int m = lt ? (lt->tm_mon + 1) : 1;
-  int d = lt ? lt->tm_mday : 1;
-  SCString filename;
-  filename.Format("D:\\MIA_IA_system\\chart_%d_%s_%04d%02d%02d.jsonl", 
-                  chartNumber, dataType, y, m, d);
-  return filename;
-}
-
-// Écriture dans le fichier spécialisé
-static void WriteToSpecializedFile(int chartNumber, const char* dataType, const SCString& line) {
-  EnsureOutDir();
-  const SCString filename = DailyFilenameForChartType(chartNumber, dataType);
-  FILE* f = fopen(filename.GetChars(), "a");
-  if (f) { 
-    fprintf(f, "%s\n", line.GetChars()); 
-    fclose(f); 
+// ========== ÉCRITURE DES FICHIERS QUOTIDIENS ==========
+
+// Chemin quotidien mis en cache par (disposition, base, chart, type):
+// recalculé seulement quand la date change. L'en-tête éventuel du flux est
+// redéclaré au writer pour chaque nouveau fichier quotidien.
+struct MiaDailySlot {
+  int date = 0;
+  std::string path;
+  std::string header;
+};
+
+static MiaDailySlot& MiaCachedDailySlot(MiaPathLayout layout, const char* baseDir,
+                                        int chartNumber, const char* dataType, const char* ext = "jsonl") {
+  static std::unordered_map<std::string, MiaDailySlot> s_paths;
+  static time_t s_last_now = 0;
+  static MiaDate s_today;
+
+  const time_t now = time(NULL);
+  if (now != s_last_now) { s_today = MiaToday(); s_last_now = now; }
+
+  std::string key(baseDir);
+  key += '|'; key += (char)('0' + layout);
+  key += '|'; key += std::to_string(chartNumber);
+  key += '|'; key += dataType;
+  key += '.'; key += ext;
+  MiaDailySlot& slot = s_paths[key];
+  if (slot.date != s_today.AsInt()) {
+    slot.path = MiaDailyPath(layout, baseDir, chartNumber, dataType, s_today, ext);
+    slot.date = s_today.AsInt();
+    if (!slot.header.empty()) MiaGetWriter()->SetHeader(slot.path.c_str(), slot.header.data(), slot.header.size());
   }
+  return slot;
+}
+
+static const std::string& MiaCachedDailyPath(MiaPathLayout layout, const char* baseDir,
+                                             int chartNumber, const char* dataType) {
+  return MiaCachedDailySlot(layout, baseDir, chartNumber, dataType).path;
+}
+
+// Compteurs de flux par chart (lus par le flux "metrics" de G3)
+static MiaStreamMetrics& MiaMetricsForChart(int chartNumber) {
+  static std::unordered_map<int, MiaStreamMetrics> s_by_chart;
+  return s_by_chart[chartNumber];
+}
+
+// Priorité d'écriture d'un flux (trades > basedata > quotes > depth > études).
+// Les flux de niveaux MenthorQ n'écrivent que les changements (un état perdu
+// ne se reconstruit pas): jamais délestés, au rang de basedata.
+static inline int MiaPriorityForStream(const char* dataType) {
+  if (strncmp(dataType, "trade", 5) == 0) return MIA_PRIO_TRADE;  // trade, trade_summary
+  if (strcmp(dataType, "basedata") == 0)   return MIA_PRIO_BASEDATA;
+  if (strcmp(dataType, "menthorq") == 0 || strcmp(dataType, "level_events") == 0) return MIA_PRIO_BASEDATA;
+  if (strcmp(dataType, "quote") == 0)      return MIA_PRIO_QUOTE;
+  if (strncmp(dataType, "depth", 5) == 0)  return MIA_PRIO_DEPTH;
+  return MIA_PRIO_STUDY;
+}
+
+static void MiaSubmitLine(int chartNumber, const char* dataType, const SCString& line, const char* conflateKey,
+                          MiaPathLayout layout, const char* baseDir) {
+  const std::string& path = MiaCachedDailyPath(layout, baseDir, chartNumber, dataType);
+  const size_t len = (size_t)line.GetLength();
+  const int result = MiaGetWriter()->Append(path.c_str(), line.GetChars(), len,
+                                            MiaPriorityForStream(dataType), conflateKey);
+  MiaMetricsForChart(chartNumber).Count(dataType, len + 1, result);
+}
+
+// Écriture dans le fichier spécialisé (asynchrone, ordre préservé par fichier)
+static void WriteToSpecializedFile(int chartNumber, const char* dataType, const SCString& line,
+                                   MiaPathLayout layout = MIA_LAYOUT_ORGANIZED,
+                                   const char* baseDir = MIA_DEFAULT_BASE_DIR) {
+  MiaSubmitLine(chartNumber, dataType, line, NULL, layout, baseDir);
+}
+
+// Écriture d'un état (niveau DOM, BBO...): sous contre-pression, seul le
+// dernier état par clé est écrit (remplacements comptés dans "metrics")
+static void WriteLatestState(int chartNumber, const char* dataType, const std::string& key, const SCString& line,
+                             MiaPathLayout layout = MIA_LAYOUT_ORGANIZED,
+                             const char* baseDir = MIA_DEFAULT_BASE_DIR) {
+  MiaSubmitLine(chartNumber, dataType, line, key.c_str(), layout, baseDir);
+}
+
+// Enregistrement binaire (fichier quotidien .bin): le writer termine chaque
+// enregistrement par '\n', que le format binaire traite comme terminateur.
+// Priorité depth sans clé: jamais conflaté ni délesté.
+static void WriteBinaryRecord(int chartNumber, const char* dataType, const std::string& record,
+                              MiaPathLayout layout = MIA_LAYOUT_ORGANIZED,
+                              const char* baseDir = MIA_DEFAULT_BASE_DIR) {
+  const std::string& path = MiaCachedDailySlot(layout, baseDir, chartNumber, dataType, "bin").path;
+  const int result = MiaGetWriter()->Append(path.c_str(), record.data(), record.size(), MIA_PRIO_DEPTH, NULL);
+  MiaMetricsForChart(chartNumber).Count(dataType, record.size() + 1, result);
+}
+
+// Déclare la ligne d'en-tête texte d'un flux binaire (.bin)
+static void SetBinaryFileHeader(int chartNumber, const char* dataType, const SCString& header,
+                                MiaPathLayout layout = MIA_LAYOUT_ORGANIZED,
+                                const char* baseDir = MIA_DEFAULT_BASE_DIR) {
+  MiaDailySlot& slot = MiaCachedDailySlot(layout, baseDir, chartNumber, dataType, "bin");
+  slot.header.assign(header.GetChars(), (size_t)header.GetLength());
+  MiaGetWriter()->SetHeader(slot.path.c_str(), slot.header.data(), slot.header.size());
+}
+
+// Crée/touche un fichier quotidien vide si besoin
+static void TouchDailyFile(int chartNumber, const char* dataType,
+                           MiaPathLayout layout = MIA_LAYOUT_ORGANIZED,
+                           const char* baseDir = MIA_DEFAULT_BASE_DIR) {
+  MiaGetWriter()->Touch(MiaCachedDailyPath(layout, baseDir, chartNumber, dataType).c_str());
+}
+
+// Déclare la ligne d'en-tête d'un flux (écrite en tête de chaque fichier
+// quotidien neuf: cadence, version de format...)
+static void SetDailyFileHeader(int chartNumber, const char* dataType, const SCString& header,
+                               MiaPathLayout layout = MIA_LAYOUT_ORGANIZED,
+                               const char* baseDir = MIA_DEFAULT_BASE_DIR) {
+  MiaDailySlot& slot = MiaCachedDailySlot(layout, baseDir, chartNumber, dataType);
+  slot.header.assign(header.GetChars(), (size_t)header.GetLength());
+  MiaGetWriter()->SetHeader(slot.path.c_str(), slot.header.data(), slot.header.size());
 }
 
-// Anti-duplication simple par (chart, type, key)
-static void WriteIfChanged(int chartNumber, const char* dataType, const std::string& key, const SCString& line) {
-  static std::unordered_map<std::string, std::string> s_last_by_key;
-  auto it = s_last_by_key.find(key);
-  const std::string current = std::string(line.GetChars());
-  if (it != s_last_by_key.end() && it->second == current) {
+// Anti-duplication simple par clé: n'écrit que si la ligne diffère de la
+// dernière écrite pour cette clé (cache fourni par l'appelant)
+static void WriteIfChanged(std::unordered_map<std::string, std::string>& lastByKey,
+                           int chartNumber, const char* dataType, const std::string& key, const SCString& line,
+                           MiaPathLayout layout = MIA_LAYOUT_ORGANIZED,
+                           const char* baseDir = MIA_DEFAULT_BASE_DIR) {
+  std::string& last = lastByKey[key];
+  if (last.size() == (size_t)line.GetLength() && last.compare(line.GetChars()) == 0) {
     return; // identique, on n'écrit pas
   }
-  WriteToSpecializedFile(chartNumber, dataType, line);
-  s_last_by_key[key] = current;
+  WriteToSpecializedFile(chartNumber, dataType, line, layout, baseDir);
+  last.assign(line.GetChars(), (size_t)line.GetLength());
 }
 
-// ========== NORMALISATION DES PRIX ==========
-inline double NormalizePx(const SCStudyInterfaceRef& sc, double raw)
-{
-  // 1) Dé-multiplier si besoin
-  const double mult = (sc.RealTimePriceMultiplier != 0.0 ? sc.RealTimePriceMultiplier : 1.0);
-  double px = raw / mult;
+// ========== DÉDUPLICATION ==========
+// Structure pour la déduplication par (sym, t, i)
+struct LastKey {
+  double t = 0.0; // timestamp
+  double i = -1;  // bar index
+};
 
-  // 2) Correction d'échelle avant arrondi (certains flux arrivent x100)
-  if (px > 10000.0) px /= 100.0;
+// ========== DÉTECTION DE CHANGEMENT ==========
+static inline bool has_changed(double a, double b, double eps=1e-9) {
+  return fabs(a-b) > eps;
+}
 
-  // 3) Arrondi au tick
-  px = sc.RoundToTickSize(px, sc.TickSize);
+// ========== JOUR DE SESSION ==========
+// Frontière de session unique pour les remises à zéro des moteurs
+// (trade_summary, large_trades, vpin, of_features, absorption, MenthorQ):
+// jour de trading Sierra (horaires de session du chart) d'un horodatage
+// exprimé dans le fuseau du chart.
+static inline int MiaSessionDay(SCStudyInterfaceRef& sc, const SCDateTime& chartTime) {
+  return sc.GetTradingDayDate(chartTime);
+}
 
-  // 4) Correction d'échelle résiduelle puis arrondi final (sécurité)
-  if (px > 10000.0) px /= 100.0;
-  px = sc.RoundToTickSize(px, sc.TickSize);
-  return px;
+// Horodatage T&S (UTC) -> fuseau du chart
+static inline SCDateTime MiaTsToChartTime(SCStudyInterfaceRef& sc, const SCDateTime& tsTime) {
+  return SCDateTime(tsTime.GetAsDouble() + sc.TimeScaleAdjustment.GetAsDouble());
 }
 
 // ========== HELPERS D'ACCÈS AUX STUDIES ==========
@@ -89,26 +193,27 @@ static int ResolveStudyID(SCStudyInterfaceRef& sc, int chartNumber, const char*
 // Helper pour lire un subgraph avec validation
 static bool ReadSubgraph(SCStudyInterfaceRef& sc, int studyID, int subgraphIndex, SCFloatArray& array, int chartNumber = -1) {
   if (chartNumber > 0) {
-    return sc.GetStudyArrayFromChartUsingID(chartNumber, studyID, subgraphIndex, array) != 0;
+    sc.GetStudyArrayFromChartUsingID(chartNumber, studyID, subgraphIndex, array);
   } else {
-    return sc.GetStudyArrayUsingID(studyID, subgraphIndex, array) != 0;
+    sc.GetStudyArrayUsingID(studyID, subgraphIndex, array);
   }
+  return array.GetArraySize() > 0;
 }
 
 // Helper pour valider qu'une étude a des données valides
 static bool ValidateStudyData(const SCFloatArray& array, int index) {
-  return array.GetArraySize() > index && array[index] != 0.0;
+  return array.GetArraySize() > index && !std::isnan(array[index]) && !std::isinf(array[index]);
 }
 
 // ========== DÉTECTION DE SUPPORT SEQUENCE ==========
-static void DetectSequenceSupport(const c_SCTimeAndSalesArray& TnS, bool& g_UseSeq)
+static void DetectSequenceSupport(const c_SCTimeAndSalesArray& TnS, bool& useSeq)
 {
     // Cherche un enregistrement avec Sequence > 0 (du plus récent au plus ancien)
     for (int i = (int)TnS.Size() - 1; i >= 0 && i >= (int)TnS.Size() - 50; --i)
     {
         if (TnS[i].Sequence > 0)
         {
-            g_UseSeq = true;
+            useSeq = true;
             break;
         }
     }
@@ -125,22 +230,43 @@ static void DetectSequenceSupport(const c_SCTimeAndSalesArray& TnS, bool& g_UseS
 #define VWAP_SG_UP3  6
 #define VWAP_SG_DN3  7
 
-// VVA Subgraphs (Volume Value Area)
-#define VVA_SG_POC 1
-#define VVA_SG_VAH 2
-#define VVA_SG_VAL 3
+// VVA Subgraphs (Volume Value Area) — indexation 0-based
+#define VVA_SG_POC 0
+#define VVA_SG_VAH 1
+#define VVA_SG_VAL 2
 
-// NBCV Subgraphs (Numbers Bars Calculated Values)
-#define NBCV_SG_ASK_VOLUME 6
-#define NBCV_SG_BID_VOLUME 7
-#define NBCV_SG_DELTA 1
-#define NBCV_SG_TRADES 12
-#define NBCV_SG_CUMULATIVE 10
+// NBCV Subgraphs (Numbers Bars Calculated Values) — mapping confirmé
+// (Ask=5, Bid=6, Delta=0, Trades=11, CumDelta=9, TotalVol=12, Delta%=10, Ask%=16, Bid%=17)
+#define NBCV_SG_DELTA         0
+#define NBCV_SG_ASK_VOLUME    5
+#define NBCV_SG_BID_VOLUME    6
+#define NBCV_SG_TRADES        11
+#define NBCV_SG_CUMULATIVE     9
+#define NBCV_SG_TOTAL_VOLUME  12
+#define NBCV_SG_DELTA_PCT     10
+#define NBCV_SG_ASK_PCT       16
+#define NBCV_SG_BID_PCT       17
 
 // VIX Subgraph
 #define VIX_SG_LAST 4
 
-// MenthorQ Subgraphs
+// MenthorQ Subgraphs (valeurs par défaut des inputs G10)
 #define MENTHORQ_GAMMA_SG_COUNT 19
-#define MENTHORQ_BLIND_SG_COUNT 9
-#define MENTHORQ_SWING_SG_COUNT 9
+#define MENTHORQ_BLIND_SG_COUNT 10
+#define MENTHORQ_SWING_SG_COUNT 60
+
+// Familles de niveaux MenthorQ (groupes de MiaLevelTable, G3 et G10)
+enum MenthorQGroup { MQ_GAMMA = 0, MQ_BLIND = 1, MQ_SWING = 2 };
+
+// Noms des subgraphs du study Gamma Levels (level_type)
+static const char* const kMenthorQGammaNames[MENTHORQ_GAMMA_SG_COUNT] = {
+    "call_resistance", "put_support", "hvl", "1d_min", "1d_max", "call_resistance_0dte",
+    "put_support_0dte", "hvl_0dte", "gamma_wall_0dte", "gex_1", "gex_2", "gex_3", "gex_4",
+    "gex_5", "gex_6", "gex_7", "gex_8", "gex_9", "gex_10"};
+
+static inline void MenthorQLevelName(int group, int sg, SCString& out) {
+  if (group == MQ_GAMMA && sg < MENTHORQ_GAMMA_SG_COUNT) out = kMenthorQGammaNames[sg];
+  else if (group == MQ_GAMMA) out.Format("gamma_sg_%d", sg);
+  else if (group == MQ_BLIND) out.Format("blind_spot_%d", sg);
+  else out.Format("swing_level_%d", sg);
+}
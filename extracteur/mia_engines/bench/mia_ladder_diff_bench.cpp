@@ -0,0 +1,119 @@
+// ========== MICROBENCHMARK: DIFF DU LADDER DOM ==========
+// Compare le diff scalaire (une branche par niveau) au diff vectorisé
+// MiaDiffLadder sur des ladders de 10/20/50/100 niveaux, puis mesure
+// MiaL2Book::Apply complet. Vérifie au passage que les masques sont égaux.
+//
+// Compilation (hors Sierra, depuis extracteur\):
+//   MSVC : cl /O2 /EHsc /std:c++17 /I. mia_engines\bench\mia_ladder_diff_bench.cpp
+//   GCC  : g++ -O2 -std=c++17 -I. mia_engines/bench/mia_ladder_diff_bench.cpp -o ladder_bench
+
+#include "mia_engines/mia_l2_book.hpp"
+
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+static void ScalarDiff(const int64_t* ticks, const int32_t* size, const int64_t* prevTicks,
+                       const int32_t* prevSize, int n, int prevN, MiaLevelMask& mask) {
+  mask.Clear();
+  for (int i = 0; i < n; ++i) {
+    if (i >= prevN || ticks[i] != prevTicks[i] || size[i] != prevSize[i]) mask.Set(i);
+  }
+}
+
+struct Frames {
+  int levels;
+  std::vector<int64_t> ticks;  // frames * levels
+  std::vector<int32_t> size;
+};
+
+// Suite de ladders réalistes: ~10% des niveaux changent par frame,
+// déplacement du prix de temps en temps
+static Frames MakeFrames(int levels, int frames, std::mt19937& rng) {
+  Frames f;
+  f.levels = levels;
+  f.ticks.resize((size_t)levels * frames);
+  f.size.resize((size_t)levels * frames);
+  int64_t best = 20000;
+  std::vector<int32_t> cur(levels, 10);
+  for (int k = 0; k < frames; ++k) {
+    if (rng() % 50 == 0) best += (rng() % 2) ? 1 : -1;
+    for (int i = 0; i < levels; ++i) {
+      if (rng() % 10 == 0) cur[i] = 1 + (int32_t)(rng() % 200);
+      f.ticks[(size_t)k * levels + i] = best - i;
+      f.size[(size_t)k * levels + i] = cur[i];
+    }
+  }
+  return f;
+}
+
+template <typename Fn>
+static double NsPerDiff(const Frames& f, int frames, int reps, Fn fn, uint64_t& checksum) {
+  MiaLevelMask mask;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    for (int k = 1; k < frames; ++k) {
+      const size_t cur = (size_t)k * f.levels, prev = (size_t)(k - 1) * f.levels;
+      fn(&f.ticks[cur], &f.size[cur], &f.ticks[prev], &f.size[prev], f.levels, f.levels, mask);
+      checksum += mask.w[0] ^ mask.w[1];
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)reps * (frames - 1));
+}
+
+int main() {
+  const int frames = 4096;
+  const int reps = 200;
+  const int sizes[] = {10, 20, 50, 100};
+  std::mt19937 rng(42);
+
+#ifdef MIA_HAVE_SSE2
+  printf("chemin vectorisé: SSE2\n");
+#else
+  printf("chemin vectorisé: indisponible (scalaire)\n");
+#endif
+  printf("%8s %14s %14s %10s %16s\n", "levels", "scalar ns", "simd ns", "speedup", "book.Apply ns");
+
+  for (int levels : sizes) {
+    const Frames f = MakeFrames(levels, frames, rng);
+
+    // Vérification: masques identiques
+    for (int k = 1; k < frames; ++k) {
+      MiaLevelMask a, b;
+      const size_t cur = (size_t)k * levels, prev = (size_t)(k - 1) * levels;
+      ScalarDiff(&f.ticks[cur], &f.size[cur], &f.ticks[prev], &f.size[prev], levels, levels, a);
+      MiaDiffLadder(&f.ticks[cur], &f.size[cur], &f.ticks[prev], &f.size[prev], levels, levels, b);
+      if (memcmp(a.w, b.w, sizeof a.w) != 0) {
+        printf("ERREUR: masques différents (levels=%d, frame=%d)\n", levels, k);
+        return 1;
+      }
+    }
+
+    uint64_t checksum = 0;
+    const double scalar = NsPerDiff(f, frames, reps, ScalarDiff, checksum);
+    const double simd = NsPerDiff(f, frames, reps, MiaDiffLadder, checksum);
+
+    // Apply complet (ladder -> carnet + masque), sans diffs par prix
+    MiaL2Book book;
+    MiaLadder ladder;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < frames; ++k) {
+      ladder.Clear();
+      for (int i = 0; i < levels; ++i) {
+        const size_t idx = (size_t)k * levels + i;
+        ladder.bids.emplace_back(f.ticks[idx], f.size[idx]);
+        ladder.asks.emplace_back(f.ticks[idx] + levels + 1, f.size[idx]);
+      }
+      book.Apply(ladder, NULL);
+      checksum += book.ChangedLevels(MIA_BOOK_BID).w[0];
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double apply = std::chrono::duration<double, std::nano>(t1 - t0).count() / frames;
+
+    printf("%8d %14.1f %14.1f %9.2fx %16.1f   (checksum %llu)\n", levels, scalar, simd, scalar / simd, apply,
+           (unsigned long long)checksum);
+  }
+  return 0;
+}
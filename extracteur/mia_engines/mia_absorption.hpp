@@ -0,0 +1,186 @@
+#pragma once
+// ========== DÉTECTION D'ABSORPTION ET D'ICEBERGS ==========
+// Moteur C++ pur qui corrèle les prints T&S avec les tailles affichées du
+// carnet L2, par prix:
+//  - OnTrade: le volume agressé est imputé au niveau passif (achat -> ask,
+//    vente -> bid); la taille affichée avant le premier print est lue dans
+//    le ladder observé AVANT la mise à jour du carnet qui contient ce print
+//    (le carnet courant l'a déjà déduit);
+//  - OnBook: pour chaque niveau touché depuis l'évaluation précédente,
+//    taille attendue = affichée avant - tradé, comparée au carnet courant.
+//    Si le niveau affiche plus que prévu, l'excédent (borné par le volume
+//    tradé) est compté comme recharge cachée.
+// Événements: "absorption" (volume tradé cumulé au niveau >= seuil alors
+// que le niveau tient, réémis à chaque multiple du seuil) et "iceberg"
+// (recharge cachée cumulée et nombre de recharges >= seuils, une fois par
+// épisode). L'épisode se termine quand le niveau disparaît du carnet.
+//
+// Coût borné: état en tableau par offset de tick (fenêtre fixe, O(1) par
+// print), liste des niveaux touchés plafonnée.
+
+#include "mia_l2_book.hpp"
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+enum MiaAbsorptionKind { MIA_EVT_ABSORPTION = 0, MIA_EVT_ICEBERG = 1 };
+
+struct MiaAbsorptionEvent {
+  int kind;              // MiaAbsorptionKind
+  int side;              // côté passif (MIA_BOOK_BID / MIA_BOOK_ASK)
+  int64_t ticks;
+  int64_t traded;        // volume agressé cumulé sur l'épisode
+  int64_t hidden;        // recharge cachée cumulée
+  uint32_t refills;
+  int64_t display;       // taille affichée au moment de l'événement
+  double first_t;        // début de l'épisode
+  double t;
+};
+
+struct MiaAbsorptionConfig {
+  int64_t min_absorb_volume = 200;  // 0 = absorption désactivée
+  int64_t min_hidden_volume = 100;
+  uint32_t min_refills = 3;
+  double idle_reset_days = 60.0 / 86400.0;  // épisode oublié après 60 s sans print (unités SCDateTime)
+};
+
+class MiaAbsorptionDetector {
+ public:
+  enum { kWindow = 512, kMaxDirty = 64 };
+
+  explicit MiaAbsorptionDetector(const MiaAbsorptionConfig& cfg = MiaAbsorptionConfig()) : cfg_(cfg) {
+    levels_.resize(2 * kWindow);
+    dirty_.reserve(kMaxDirty);
+  }
+
+  void Configure(const MiaAbsorptionConfig& cfg) { cfg_ = cfg; }
+
+  // Nouvelle session: tous les épisodes oubliés
+  void Reset() {
+    for (Level& l : levels_) l = Level();
+    dirty_.clear();
+    have_anchor_ = false;
+  }
+
+  // aggrSide: +1 acheteur agresseur (touche l'ask), -1 vendeur (touche le bid);
+  // 'before': ladder observé avant la mise à jour du carnet contenant ce print
+  void OnTrade(double t, int aggrSide, int64_t ticks, uint32_t vol, const MiaLadder& before) {
+    if (aggrSide == 0 || vol == 0) return;
+    const int side = aggrSide > 0 ? MIA_BOOK_ASK : MIA_BOOK_BID;
+    if (!EnsureAnchor(ticks)) return;
+    Level* lv = At(side, ticks);
+    if (!lv) return;
+
+    if (lv->active && t - lv->last_t > cfg_.idle_reset_days) *lv = Level();
+    if (!lv->active) {
+      lv->active = true;
+      lv->first_t = t;
+    }
+    if (lv->traded_since == 0) {
+      if ((int)dirty_.size() >= kMaxDirty) return;  // borne par mise à jour
+      lv->display_before = SizeIn(side == MIA_BOOK_BID ? before.bids : before.asks, ticks);
+      dirty_.push_back(Key{side, ticks});
+    }
+    lv->traded_since += vol;
+    lv->traded_total += vol;
+    lv->last_t = t;
+  }
+
+  // Évalue les niveaux touchés depuis l'appel précédent contre le carnet
+  void OnBook(double t, const MiaL2Book& book, std::vector<MiaAbsorptionEvent>& events) {
+    events.clear();
+    for (const Key& k : dirty_) {
+      Level* lv = At(k.side, k.ticks);
+      if (!lv || !lv->active) continue;
+      const int64_t now = book.SizeAt(k.side, k.ticks);
+
+      if (now <= 0) {
+        *lv = Level();  // niveau consommé ou sorti du carnet: fin d'épisode
+        continue;
+      }
+
+      const int64_t expected = lv->display_before - lv->traded_since;
+      int64_t refill = now - (expected > 0 ? expected : 0);
+      if (refill > lv->traded_since) refill = lv->traded_since;
+      if (refill > 0) {
+        lv->hidden += refill;
+        lv->refills++;
+      }
+
+      if (cfg_.min_absorb_volume > 0 && lv->traded_total >= lv->next_absorb_at * cfg_.min_absorb_volume) {
+        events.push_back(MakeEvent(MIA_EVT_ABSORPTION, k, *lv, now, t));
+        lv->next_absorb_at = lv->traded_total / cfg_.min_absorb_volume + 1;
+      }
+      if (!lv->iceberg_emitted && lv->hidden >= cfg_.min_hidden_volume && lv->refills >= cfg_.min_refills) {
+        events.push_back(MakeEvent(MIA_EVT_ICEBERG, k, *lv, now, t));
+        lv->iceberg_emitted = true;
+      }
+      lv->traded_since = 0;
+    }
+    dirty_.clear();
+  }
+
+ private:
+  struct Level {
+    bool active = false;
+    bool iceberg_emitted = false;
+    int64_t display_before = 0;
+    int64_t traded_since = 0;
+    int64_t traded_total = 0;
+    int64_t hidden = 0;
+    int64_t next_absorb_at = 1;  // prochain multiple du seuil d'absorption
+    uint32_t refills = 0;
+    double first_t = 0.0;
+    double last_t = 0.0;
+  };
+
+  struct Key {
+    int side;
+    int64_t ticks;
+  };
+
+  // Taille affichée à un prix du ladder (0 si absent); ladder court, scan linéaire
+  static int64_t SizeIn(const std::vector<std::pair<int64_t, int64_t>>& side, int64_t ticks) {
+    for (const std::pair<int64_t, int64_t>& l : side) {
+      if (l.first == ticks) return l.second;
+    }
+    return 0;
+  }
+
+  // Fenêtre recentrée si le prix en sort (état remis à zéro, rare)
+  bool EnsureAnchor(int64_t ticks) {
+    if (have_anchor_ && ticks - anchor_ >= 0 && ticks - anchor_ < kWindow) return true;
+    if (!dirty_.empty()) return false;  // pas de recentrage avec des niveaux en attente
+    for (Level& l : levels_) l = Level();
+    anchor_ = ticks - kWindow / 2;
+    have_anchor_ = true;
+    return true;
+  }
+
+  Level* At(int side, int64_t ticks) {
+    const int64_t off = ticks - anchor_;
+    if (!have_anchor_ || off < 0 || off >= kWindow) return nullptr;
+    return &levels_[(size_t)side * kWindow + (size_t)off];
+  }
+
+  static MiaAbsorptionEvent MakeEvent(int kind, const Key& k, const Level& lv, int64_t display, double t) {
+    MiaAbsorptionEvent e;
+    e.kind = kind;
+    e.side = k.side;
+    e.ticks = k.ticks;
+    e.traded = lv.traded_total;
+    e.hidden = lv.hidden;
+    e.refills = lv.refills;
+    e.display = display;
+    e.first_t = lv.first_t;
+    e.t = t;
+    return e;
+  }
+
+  MiaAbsorptionConfig cfg_;
+  std::vector<Level> levels_;  // [côté][offset]
+  std::vector<Key> dirty_;
+  int64_t anchor_ = 0;
+  bool have_anchor_ = false;
+};
@@ -0,0 +1,54 @@
+#pragma once
+// ========== DIFF DU CARNET D'ORDRES ==========
+// Types C++ purs (sans dépendance Sierra) partagés par MiaL2Book, qui
+// produit les opérations add/modify/delete par prix, et par
+// MiaBookRebuilder, qui les rejoue sur MiaBookState. Les prix sont des
+// entiers en ticks (clés exactes, sans arrondi flottant).
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+enum MiaBookSide { MIA_BOOK_BID = 0, MIA_BOOK_ASK = 1 };
+enum MiaBookOp   { MIA_BOOK_ADD = 'a', MIA_BOOK_MODIFY = 'm', MIA_BOOK_DELETE = 'd' };
+
+struct MiaBookDiff {
+  uint8_t side;   // MiaBookSide
+  uint8_t op;     // MiaBookOp
+  int64_t ticks;  // prix en ticks
+  int64_t size;   // 0 pour un delete
+};
+
+// Ladder observé pendant un appel (niveaux dans l'ordre de Sierra)
+struct MiaLadder {
+  std::vector<std::pair<int64_t, int64_t>> bids;  // (ticks, size)
+  std::vector<std::pair<int64_t, int64_t>> asks;
+
+  void Clear() { bids.clear(); asks.clear(); }
+};
+
+// État du carnet: prix (ticks) -> taille, par côté
+struct MiaBookState {
+  std::map<int64_t, int64_t> bids;
+  std::map<int64_t, int64_t> asks;
+  uint64_t bseq = 0;
+  double t = 0.0;
+
+  void Clear() { bids.clear(); asks.clear(); bseq = 0; t = 0.0; }
+
+  // Applique une opération; retourne false si elle est incohérente avec l'état
+  // (add d'un prix présent, modify/delete d'un prix absent). L'état reste
+  // aligné sur l'opération dans tous les cas.
+  bool Apply(const MiaBookDiff& d) {
+    std::map<int64_t, int64_t>& side = (d.side == MIA_BOOK_BID) ? bids : asks;
+    auto it = side.find(d.ticks);
+    if (d.op == MIA_BOOK_DELETE) {
+      if (it == side.end()) return false;
+      side.erase(it);
+      return true;
+    }
+    const bool consistent = (d.op == MIA_BOOK_ADD) ? (it == side.end()) : (it != side.end());
+    side[d.ticks] = d.size;
+    return consistent;
+  }
+};
@@ -0,0 +1,235 @@
+#pragma once
+// ========== RECONSTRUCTION DU CARNET (depth_book) ==========
+// Bibliothèque C++ pure: reconstruit le ladder à n'importe quel instant à
+// partir d'un fichier quotidien "depth_book" (snapshots complets périodiques
+// + diffs add/modify/delete numérotés par "bseq").
+//
+// Open() indexe une seule fois les snapshots (bseq, t, offset). Une
+// reconstruction se positionne sur le snapshot le plus proche avant la
+// cible puis rejoue uniquement les diffs qui suivent: coût proportionnel au
+// nombre de diffs depuis ce snapshot, pas à la taille du fichier.
+// Refresh() étend l'index d'un fichier encore en cours d'écriture.
+//
+// "t" est l'heure de la mise à jour sur l'horloge T&S de G3 (UTC, non
+// décroissante, header "clock":"ts"): RebuildAtTime résout sous la seconde.
+//
+// Formats de lignes lus (écrits par G3):
+//   {"t":T,...,"type":"depth_snapshot","bseq":N,"tick":0.25,"bids":[[px,size],...],"asks":[...],...}
+//   {"t":T,...,"type":"depth_diff","bseq":N,"ops":[["B","a",px,size],["A","d",px,0],...],...}
+
+#include "mia_book_diff.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#define MIA_FSEEK _fseeki64
+#define MIA_FTELL _ftelli64
+#else
+#define MIA_FSEEK fseeko
+#define MIA_FTELL ftello
+#endif
+
+struct MiaBookSnapshotRef {
+  uint64_t bseq = 0;
+  double t = 0.0;
+  int64_t offset = 0;  // début de la ligne du snapshot
+};
+
+struct MiaRebuildStats {
+  uint64_t diffs_applied = 0;
+  uint64_t gaps = 0;          // bseq non consécutif (lignes perdues)
+  uint64_t inconsistent = 0;  // opérations incohérentes avec l'état
+};
+
+class MiaBookRebuilder {
+ public:
+  ~MiaBookRebuilder() { Close(); }
+
+  bool Open(const std::string& path) {
+    Close();
+    f_ = fopen(path.c_str(), "rb");
+    if (!f_) return false;
+    return Refresh();
+  }
+
+  void Close() {
+    if (f_) { fclose(f_); f_ = NULL; }
+    snapshots_.clear();
+    indexed_end_ = 0;
+    last_bseq_ = 0;
+    last_t_ = 0.0;
+  }
+
+  // Indexe les lignes complètes ajoutées depuis le dernier appel
+  bool Refresh() {
+    if (!f_ || MIA_FSEEK(f_, indexed_end_, SEEK_SET) != 0) return false;
+    std::string line;
+    int64_t offset = indexed_end_;
+    while (ReadLine(line)) {
+      const int64_t next = MIA_FTELL(f_);
+      if (line.empty() || line[line.size() - 1] != '\n') break;  // ligne partielle: reprise au prochain Refresh
+      const bool snap = IsType(line, "depth_snapshot");
+      if (snap || IsType(line, "depth_diff")) {
+        MiaBookSnapshotRef ref;
+        ref.bseq = (uint64_t)NumberAfter(line, "\"bseq\":", 0.0);
+        ref.t = NumberAfter(line, "\"t\":", 0.0);
+        ref.offset = offset;
+        if (snap) snapshots_.push_back(ref);
+        last_bseq_ = ref.bseq;
+        last_t_ = ref.t;
+      }
+      offset = next;
+      indexed_end_ = next;
+    }
+    return true;
+  }
+
+  const std::vector<MiaBookSnapshotRef>& Snapshots() const { return snapshots_; }
+  uint64_t LastSeq() const { return last_bseq_; }
+  double LastTime() const { return last_t_; }
+
+  // État après application de la ligne de numéro 'bseq'
+  bool RebuildAtSeq(uint64_t bseq, MiaBookState& out, MiaRebuildStats* stats = NULL) {
+    auto it = std::upper_bound(snapshots_.begin(), snapshots_.end(), bseq,
+                               [](uint64_t v, const MiaBookSnapshotRef& s) { return v < s.bseq; });
+    if (it == snapshots_.begin()) return false;
+    --it;
+    return Replay(*it, false, (double)bseq, bseq, out, stats);
+  }
+
+  // État au temps 't' (dernière ligne de temps <= t, même échelle que "t")
+  bool RebuildAtTime(double t, MiaBookState& out, MiaRebuildStats* stats = NULL) {
+    auto it = std::upper_bound(snapshots_.begin(), snapshots_.end(), t,
+                               [](double v, const MiaBookSnapshotRef& s) { return v < s.t; });
+    if (it == snapshots_.begin()) return false;
+    --it;
+    return Replay(*it, true, t, 0, out, stats);
+  }
+
+  // Taille du tick du dernier snapshot rejoué (conversion ticks -> prix)
+  double Tick() const { return tick_; }
+
+ private:
+  bool Replay(const MiaBookSnapshotRef& snap, bool byTime, double tLimit, uint64_t seqLimit,
+              MiaBookState& out, MiaRebuildStats* stats) {
+    MiaRebuildStats local;
+    MiaRebuildStats& st = stats ? *stats : local;
+    st = MiaRebuildStats();
+    out.Clear();
+
+    if (!f_ || MIA_FSEEK(f_, snap.offset, SEEK_SET) != 0) return false;
+    std::string line;
+    if (!ReadLine(line) || !IsType(line, "depth_snapshot")) return false;
+    if (!ParseSnapshot(line, out)) return false;
+
+    while (MIA_FTELL(f_) < indexed_end_ && ReadLine(line)) {
+      if (!IsType(line, "depth_diff")) {
+        if (IsType(line, "depth_snapshot")) break;  // snapshot suivant: la cible est dépassée
+        continue;
+      }
+      const uint64_t seq = (uint64_t)NumberAfter(line, "\"bseq\":", 0.0);
+      const double t = NumberAfter(line, "\"t\":", 0.0);
+      if (byTime ? (t > tLimit) : (seq > seqLimit)) break;
+      if (seq != out.bseq + 1) st.gaps++;
+      ApplyDiffLine(line, out, st);
+      out.bseq = seq;
+      out.t = t;
+    }
+    return true;
+  }
+
+  bool ReadLine(std::string& line) {
+    line.clear();
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), f_)) {
+      line += buf;
+      if (!line.empty() && line[line.size() - 1] == '\n') return true;
+    }
+    return !line.empty();
+  }
+
+  static bool IsType(const std::string& line, const char* type) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"type\":\"%s\"", type);
+    return line.find(key) != std::string::npos;
+  }
+
+  static double NumberAfter(const std::string& line, const char* key, double fallback) {
+    const size_t pos = line.find(key);
+    if (pos == std::string::npos) return fallback;
+    return strtod(line.c_str() + pos + strlen(key), NULL);
+  }
+
+  static const char* SkipSpaces(const char* p) {
+    while (*p == ' ' || *p == ',') ++p;
+    return p;
+  }
+
+  int64_t ToTicks(double px) const { return (int64_t)llround(px / tick_); }
+
+  // Tableau [[px,size],...] -> map ticks -> size
+  bool ParseLevels(const std::string& line, const char* key, std::map<int64_t, int64_t>& side) const {
+    const size_t pos = line.find(key);
+    if (pos == std::string::npos) return false;
+    const char* p = line.c_str() + pos + strlen(key);
+    while (true) {
+      p = SkipSpaces(p);
+      if (*p != '[') return *p == ']';
+      char* end = NULL;
+      const double px = strtod(p + 1, &end);
+      p = SkipSpaces(end);
+      const int64_t size = strtoll(p, &end, 10);
+      p = end;
+      if (*p != ']') return false;
+      ++p;
+      if (size > 0) side[ToTicks(px)] = size;
+    }
+  }
+
+  bool ParseSnapshot(const std::string& line, MiaBookState& out) {
+    tick_ = NumberAfter(line, "\"tick\":", 0.0);
+    if (!(tick_ > 0.0)) return false;
+    if (!ParseLevels(line, "\"bids\":[", out.bids)) return false;
+    if (!ParseLevels(line, "\"asks\":[", out.asks)) return false;
+    out.bseq = (uint64_t)NumberAfter(line, "\"bseq\":", 0.0);
+    out.t = NumberAfter(line, "\"t\":", 0.0);
+    return true;
+  }
+
+  // ["B","a",px,size] ...
+  void ApplyDiffLine(const std::string& line, MiaBookState& out, MiaRebuildStats& st) const {
+    const size_t pos = line.find("\"ops\":[");
+    if (pos == std::string::npos) return;
+    const char* p = line.c_str() + pos + 7;
+    while (true) {
+      p = SkipSpaces(p);
+      if (*p != '[') return;
+      // p: ["B","a",
+      if (p[1] != '"' || p[3] != '"' || p[5] != '"' || p[7] != '"') return;
+      MiaBookDiff d;
+      d.side = (p[2] == 'B') ? MIA_BOOK_BID : MIA_BOOK_ASK;
+      d.op = (uint8_t)p[6];
+      char* end = NULL;
+      const double px = strtod(SkipSpaces(p + 8), &end);
+      d.size = strtoll(SkipSpaces(end), &end, 10);
+      d.ticks = ToTicks(px);
+      if (*end != ']') return;
+      p = end + 1;
+      if (!out.Apply(d)) st.inconsistent++;
+      st.diffs_applied++;
+    }
+  }
+
+  FILE* f_ = NULL;
+  std::vector<MiaBookSnapshotRef> snapshots_;
+  int64_t indexed_end_ = 0;
+  uint64_t last_bseq_ = 0;
+  double last_t_ = 0.0;
+  double tick_ = 0.0;
+};
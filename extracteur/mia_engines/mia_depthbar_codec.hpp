@@ -0,0 +1,149 @@
+#pragma once
+// ========== CODEC DES BARS DE PROFONDEUR HISTORIQUE ==========
+// Moteur C++ pur: un enregistrement binaire par bar, quantités max bid/ask
+// par tick entre le plus bas et le plus haut tick du bar, compressées en
+// RLE de deltas (paires varint [longueur, delta zigzag]): les plages vides
+// et les valeurs répétées d'une heatmap de liquidité tiennent en 2 octets.
+//
+// Fichier: une ligne d'en-tête JSON terminée par '\n', puis des
+// enregistrements, chacun suivi d'un octet '\n' (terminateur de contrôle):
+//   u32 magic 'MDB1' | u32 longueur du corps | corps | '\n'
+// Corps (little endian):
+//   i32 bar | f64 t (SCDateTime) | u8 flags | i32 low_tick | u32 n_ticks |
+//   RLE bid[n_ticks] | RLE ask[n_ticks]
+// Un même bar peut apparaître plusieurs fois (exports incrémentaux du bar
+// ouvert): le dernier enregistrement du bar fait foi.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define MIA_DEPTHBAR_MAGIC 0x3142444D  // "MDB1"
+
+enum MiaDepthBarFlags {
+  MIA_DEPTHBAR_CLOSED   = 1,  // bar clos (valeurs définitives)
+  MIA_DEPTHBAR_BACKFILL = 2   // exporté par rattrapage d'historique
+};
+
+struct MiaDepthBarRecord {
+  int32_t bar = 0;
+  double t = 0.0;
+  uint8_t flags = 0;
+  int32_t low_tick = 0;             // index de tick (prix = index * tick)
+  std::vector<int32_t> bid_max;     // quantité max bid par tick depuis low_tick
+  std::vector<int32_t> ask_max;
+
+  void Clear() { bar = 0; t = 0.0; flags = 0; low_tick = 0; bid_max.clear(); ask_max.clear(); }
+};
+
+// ---- Varint / zigzag ----
+static inline void MiaPutVarint(std::string& out, uint64_t v) {
+  while (v >= 0x80) { out.push_back((char)((v & 0x7F) | 0x80)); v >>= 7; }
+  out.push_back((char)v);
+}
+
+static inline bool MiaGetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+  v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    const uint8_t b = *p++;
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+static inline uint64_t MiaZigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t MiaUnzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// ---- RLE de deltas ----
+static inline void MiaEncodeRleDelta(const int32_t* v, size_t n, std::string& out) {
+  int64_t prev = 0;
+  size_t i = 0;
+  while (i < n) {
+    size_t run = 1;
+    while (i + run < n && v[i + run] == v[i]) ++run;
+    MiaPutVarint(out, run);
+    MiaPutVarint(out, MiaZigzag((int64_t)v[i] - prev));
+    prev = v[i];
+    i += run;
+  }
+}
+
+static inline bool MiaDecodeRleDelta(const uint8_t*& p, const uint8_t* end, size_t n, std::vector<int32_t>& out) {
+  out.clear();
+  out.reserve(n);
+  int64_t prev = 0;
+  while (out.size() < n) {
+    uint64_t run, zz;
+    if (!MiaGetVarint(p, end, run) || !MiaGetVarint(p, end, zz)) return false;
+    if (run == 0 || run > n - out.size()) return false;
+    prev += MiaUnzigzag(zz);
+    out.insert(out.end(), (size_t)run, (int32_t)prev);
+  }
+  return true;
+}
+
+// ---- Enregistrement ----
+static inline void MiaPutRaw(std::string& out, const void* p, size_t n) { out.append((const char*)p, n); }
+
+// Enregistrement complet (sans le '\n' final, ajouté par le writer)
+static inline void MiaEncodeDepthBar(const MiaDepthBarRecord& r, std::string& out) {
+  out.clear();
+  const uint32_t magic = MIA_DEPTHBAR_MAGIC;
+  const uint32_t placeholder = 0;
+  MiaPutRaw(out, &magic, 4);
+  MiaPutRaw(out, &placeholder, 4);
+  const size_t bodyStart = out.size();
+  const uint32_t n = (uint32_t)r.bid_max.size();
+  MiaPutRaw(out, &r.bar, 4);
+  MiaPutRaw(out, &r.t, 8);
+  MiaPutRaw(out, &r.flags, 1);
+  MiaPutRaw(out, &r.low_tick, 4);
+  MiaPutRaw(out, &n, 4);
+  MiaEncodeRleDelta(r.bid_max.data(), n, out);
+  MiaEncodeRleDelta(r.ask_max.data(), n, out);
+  const uint32_t bodyLen = (uint32_t)(out.size() - bodyStart);
+  memcpy(&out[4], &bodyLen, 4);
+}
+
+// Lecteur séquentiel d'un fichier .bin (usage hors ligne: heatmaps, ML)
+class MiaDepthBarReader {
+ public:
+  ~MiaDepthBarReader() { if (f_) fclose(f_); }
+
+  // Ouvre le fichier et lit la ligne d'en-tête JSON
+  bool Open(const std::string& path, std::string* header = NULL) {
+    f_ = fopen(path.c_str(), "rb");
+    if (!f_) return false;
+    std::string h;
+    int c;
+    while ((c = fgetc(f_)) != EOF && c != '\n') h.push_back((char)c);
+    if (header) header->swap(h);
+    return c == '\n';
+  }
+
+  // Enregistrement suivant; false en fin de fichier ou sur enregistrement tronqué
+  bool Next(MiaDepthBarRecord& r) {
+    uint32_t hdr[2];
+    if (!f_ || fread(hdr, 4, 2, f_) != 2 || hdr[0] != MIA_DEPTHBAR_MAGIC) return false;
+    body_.resize(hdr[1] + 1);
+    if (fread(&body_[0], 1, body_.size(), f_) != body_.size() || body_.back() != '\n') return false;
+
+    const uint8_t* p = (const uint8_t*)body_.data();
+    const uint8_t* end = p + hdr[1];
+    if (end - p < 25) return false;
+    uint32_t n;
+    memcpy(&r.bar, p, 4);       p += 4;
+    memcpy(&r.t, p, 8);         p += 8;
+    r.flags = *p;               p += 1;
+    memcpy(&r.low_tick, p, 4);  p += 4;
+    memcpy(&n, p, 4);           p += 4;
+    return MiaDecodeRleDelta(p, end, n, r.bid_max) && MiaDecodeRleDelta(p, end, n, r.ask_max);
+  }
+
+ private:
+  FILE* f_ = NULL;
+  std::string body_;
+};
@@ -0,0 +1,77 @@
+#pragma once
+// ========== FOOTPRINT (VOLUME PAR PRIX ET PAR BAR) ==========
+// Moteur C++ pur: suit les lignes (prix en ticks, volume bid/ask, trades)
+// du bar en cours. Chaque parcours du VAP du bar est comparé au précédent
+// pour ne retenir que les lignes modifiées; au changement de bar l'état est
+// vidé. Les vecteurs gardent leur capacité: pas d'allocation en régime établi.
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+struct MiaFootprintRow {
+  int32_t ticks;
+  uint32_t bid_vol;
+  uint32_t ask_vol;
+  uint32_t trades;
+
+  bool SameVolumes(const MiaFootprintRow& o) const {
+    return bid_vol == o.bid_vol && ask_vol == o.ask_vol && trades == o.trades;
+  }
+};
+
+class MiaFootprintTracker {
+ public:
+  int Bar() const { return bar_; }
+
+  // Début d'un parcours du bar 'bar' (un autre bar que le précédent = état vidé)
+  void BeginScan(int bar) {
+    if (bar != bar_) { prev_.clear(); bar_ = bar; }
+    cur_.clear();
+    sorted_ = true;
+  }
+
+  void AddRow(int32_t ticks, uint32_t bidVol, uint32_t askVol, uint32_t trades) {
+    if (!cur_.empty() && ticks < cur_.back().ticks) sorted_ = false;
+    cur_.push_back(MiaFootprintRow{ticks, bidVol, askVol, trades});
+  }
+
+  // Fin du parcours: calcule les lignes modifiées depuis le parcours précédent
+  // du même bar (fusion de deux listes triées par prix)
+  void EndScan() {
+    if (!sorted_) {
+      std::sort(cur_.begin(), cur_.end(),
+                [](const MiaFootprintRow& a, const MiaFootprintRow& b) { return a.ticks < b.ticks; });
+    }
+    changed_.clear();
+    size_t a = 0;
+    for (const MiaFootprintRow& r : cur_) {
+      while (a < prev_.size() && prev_[a].ticks < r.ticks) ++a;
+      if (a >= prev_.size() || prev_[a].ticks != r.ticks || !prev_[a].SameVolumes(r)) changed_.push_back(r);
+    }
+    prev_.swap(cur_);
+  }
+
+  // Lignes du dernier parcours (triées) et lignes modifiées
+  const std::vector<MiaFootprintRow>& Rows() const { return prev_; }
+  const std::vector<MiaFootprintRow>& Changed() const { return changed_; }
+
+  // Totaux du dernier parcours
+  void Totals(uint64_t& vol, int64_t& delta, int32_t& pocTicks) const {
+    vol = 0; delta = 0; pocTicks = 0;
+    uint64_t best = 0;
+    for (const MiaFootprintRow& r : prev_) {
+      const uint64_t v = (uint64_t)r.bid_vol + r.ask_vol;
+      vol += v;
+      delta += (int64_t)r.ask_vol - (int64_t)r.bid_vol;
+      if (v > best) { best = v; pocTicks = r.ticks; }
+    }
+  }
+
+ private:
+  int bar_ = -1;
+  bool sorted_ = true;
+  std::vector<MiaFootprintRow> prev_;
+  std::vector<MiaFootprintRow> cur_;
+  std::vector<MiaFootprintRow> changed_;
+};
@@ -0,0 +1,124 @@
+#pragma once
+// ========== COURBE DE POIDS DE RANG GEX PAR TICK ==========
+// Moteur C++ pur: des points d'ancrage (prix en ticks, poids signé) sont
+// triés, fusionnés par prix (poids sommés) puis interpolés linéairement
+// sur un tableau d'un élément par tick couvrant [premier - marge, dernier +
+// marge]; hors des ancrages la courbe est plate. Lookup At(ticks) en O(1).
+//
+// MenthorQ ne publie que des prix: les poids construits par
+// MiaGexAnchorsFromLevels() sont des rangs, pas une exposition gamma. La
+// courbe ordonne les prix entre niveaux GEX; elle ne donne ni montant ni
+// zero gamma résolu (son changement de signe est la HVL par construction).
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+struct MiaGexAnchor {
+  int64_t ticks = 0;
+  double weight = 0.0;  // poids de rang signé (sans unité)
+};
+
+class MiaGexCurve {
+ public:
+  enum { kMaxTicks = 1 << 16 };  // étendue maximale de la table
+
+  void Clear() {
+    curve_.clear();
+    anchors_.clear();
+    lo_ = 0;
+  }
+
+  // Reconstruit la table; false si aucun ancrage ou étendue hors limite
+  bool Build(const std::vector<MiaGexAnchor>& anchors, int padTicks) {
+    Clear();
+    if (anchors.empty()) return false;
+    anchors_ = anchors;
+    std::sort(anchors_.begin(), anchors_.end(),
+              [](const MiaGexAnchor& a, const MiaGexAnchor& b) { return a.ticks < b.ticks; });
+    size_t w = 0;
+    for (size_t k = 0; k < anchors_.size(); ++k) {
+      if (w > 0 && anchors_[w - 1].ticks == anchors_[k].ticks) anchors_[w - 1].weight += anchors_[k].weight;
+      else anchors_[w++] = anchors_[k];
+    }
+    anchors_.resize(w);
+
+    if (padTicks < 0) padTicks = 0;
+    lo_ = anchors_.front().ticks - padTicks;
+    const int64_t span = anchors_.back().ticks + padTicks - lo_ + 1;
+    if (span > kMaxTicks) {
+      anchors_.clear();
+      return false;
+    }
+    curve_.resize((size_t)span);
+
+    size_t seg = 0;
+    for (int64_t k = 0; k < span; ++k) {
+      const int64_t t = lo_ + k;
+      while (seg + 1 < anchors_.size() && anchors_[seg + 1].ticks <= t) ++seg;
+      const MiaGexAnchor& a = anchors_[seg];
+      if (t <= a.ticks || seg + 1 == anchors_.size()) {
+        curve_[(size_t)k] = (float)a.weight;  // plat avant le premier / après le dernier
+      } else {
+        const MiaGexAnchor& b = anchors_[seg + 1];
+        const double f = (double)(t - a.ticks) / (double)(b.ticks - a.ticks);
+        curve_[(size_t)k] = (float)(a.weight + f * (b.weight - a.weight));
+      }
+    }
+    return true;
+  }
+
+  bool Ready() const { return !curve_.empty(); }
+
+  // Poids de rang interpolé au prix (ticks); plat hors de la table
+  double At(int64_t ticks) const {
+    if (curve_.empty()) return 0.0;
+    int64_t k = ticks - lo_;
+    if (k < 0) k = 0;
+    if (k >= (int64_t)curve_.size()) k = (int64_t)curve_.size() - 1;
+    return curve_[(size_t)k];
+  }
+
+  int64_t Lo() const { return lo_; }
+  int64_t Hi() const { return lo_ + (int64_t)curve_.size() - 1; }
+  const std::vector<MiaGexAnchor>& Anchors() const { return anchors_; }
+
+ private:
+  std::vector<float> curve_;  // poids par tick depuis lo_
+  std::vector<MiaGexAnchor> anchors_;
+  int64_t lo_ = 0;
+};
+
+// Ancrages depuis les niveaux MenthorQ (prix seulement, pas de montants):
+//  - gex_k (rang k = 1..10): |poids| = (11 - k) / 10, signe + au-dessus de
+//    la HVL, - en dessous;
+//  - call_resistance +1, put_support -1 (extrêmes du profil);
+//  - HVL: poids 0.
+// Sans HVL aucun signe n'est attribuable: pas d'ancrage (false).
+// ticks[k] = 0 si le niveau est absent; gex[0..9] = gex_1..gex_10.
+static inline bool MiaGexAnchorsFromLevels(int64_t hvl, int64_t callResistance, int64_t putSupport,
+                                           const int64_t* gex, int nGex, std::vector<MiaGexAnchor>& out) {
+  out.clear();
+  if (hvl == 0) return false;
+  MiaGexAnchor a;
+  a.ticks = hvl;
+  a.weight = 0.0;
+  out.push_back(a);
+  if (callResistance != 0) {
+    a.ticks = callResistance;
+    a.weight = 1.0;
+    out.push_back(a);
+  }
+  if (putSupport != 0) {
+    a.ticks = putSupport;
+    a.weight = -1.0;
+    out.push_back(a);
+  }
+  for (int k = 0; k < nGex; ++k) {
+    if (gex[k] == 0 || gex[k] == hvl) continue;
+    a.ticks = gex[k];
+    a.weight = (gex[k] > hvl ? 1.0 : -1.0) * (double)(10 - k) / 10.0;
+    out.push_back(a);
+  }
+  return true;
+}
@@ -0,0 +1,285 @@
+#pragma once
+// ========== NOYAUX D'INDICATEURS INCRÉMENTAUX ==========
+// Moteur C++ pur, indépendant des études Sierra:
+//  - MiaWilderAtr: ATR de Wilder (graine = moyenne des 'period' premiers TR);
+//  - MiaRollingCorr: corrélation de Pearson glissante entre deux séries;
+//  - MiaRollingZScore: z-score glissant (x - moyenne) / écart-type;
+//  - MiaEwmaVar: moyenne et variance exponentielles.
+// Forme incrémentale: Push() engage un bar clos en O(1), Peek() évalue le
+// bar en cours sans modifier l'état. Forme batch (rattrapage d'historique):
+// une passe séquentielle courte (TR, sommes préfixes) puis une boucle sans
+// dépendance entre itérations, vectorisable par le compilateur.
+// Les sommes glissantes sont centrées sur une référence (première valeur)
+// et recalculées exactement tous les 'period' Push pour borner la dérive.
+
+#include <math.h>
+#include <stddef.h>
+#include <vector>
+
+static inline double MiaTrueRange(double h, double l, double prevClose, bool havePrev) {
+  if (!havePrev) return h - l;
+  const double a = h - l, b = fabs(h - prevClose), c = fabs(l - prevClose);
+  return a > b ? (a > c ? a : c) : (b > c ? b : c);
+}
+
+// ---- ATR de Wilder ----
+class MiaWilderAtr {
+ public:
+  void Init(int period) {
+    period_ = period > 0 ? period : 1;
+    Reset();
+  }
+  void Reset() { atr_ = 0.0; prev_close_ = 0.0; count_ = 0; }
+
+  // Reprend l'état à la fin d'un batch (ATR du dernier bar, sa clôture)
+  void Seed(double atr, double lastClose, int count) { atr_ = atr; prev_close_ = lastClose; count_ = count; }
+
+  double Push(double h, double l, double c) {
+    atr_ = Next(h, l);
+    prev_close_ = c;
+    ++count_;
+    return atr_;
+  }
+  double Peek(double h, double l) const { return Next(h, l); }
+
+  double Value() const { return atr_; }
+  bool Ready() const { return count_ >= period_; }
+  int Count() const { return count_; }
+
+ private:
+  // Amorçage: moyenne simple des TR; ensuite lissage de Wilder
+  double Next(double h, double l) const {
+    const double tr = MiaTrueRange(h, l, prev_close_, count_ > 0);
+    if (count_ < period_) return (atr_ * count_ + tr) / (count_ + 1);
+    return (atr_ * (period_ - 1) + tr) / period_;
+  }
+
+  int period_ = 14;
+  double atr_ = 0.0;
+  double prev_close_ = 0.0;
+  int count_ = 0;
+};
+
+// out[i] = ATR après le bar i (mêmes valeurs que Push successifs)
+static inline void MiaWilderAtrBatch(const float* h, const float* l, const float* c, int n, int period,
+                                     double* out) {
+  if (n <= 0) return;
+  if (period <= 0) period = 1;
+  // Passe 1: TR indépendants (vectorisable)
+  out[0] = (double)h[0] - l[0];
+  for (int i = 1; i < n; ++i) {
+    const double a = (double)h[i] - l[i];
+    const double b = fabs((double)h[i] - c[i - 1]);
+    const double d = fabs((double)l[i] - c[i - 1]);
+    out[i] = a > b ? (a > d ? a : d) : (b > d ? b : d);
+  }
+  // Passe 2: récurrence en place
+  double atr = 0.0;
+  for (int i = 0; i < n; ++i) {
+    atr = i < period ? (atr * i + out[i]) / (i + 1) : (atr * (period - 1) + out[i]) / period;
+    out[i] = atr;
+  }
+}
+
+// ---- Corrélation de Pearson glissante ----
+class MiaRollingCorr {
+ public:
+  void Init(int period) {
+    period_ = period > 1 ? period : 2;
+    xs_.assign(period_, 0.0);
+    ys_.assign(period_, 0.0);
+    Reset();
+  }
+  void Reset() {
+    n_ = 0; head_ = 0; since_exact_ = 0;
+    sx_ = sy_ = sxx_ = syy_ = sxy_ = 0.0;
+    have_ref_ = false;
+  }
+
+  double Push(double x, double y) {
+    if (!have_ref_) { rx_ = x; ry_ = y; have_ref_ = true; }
+    x -= rx_; y -= ry_;
+    if (n_ == period_) Remove(xs_[head_], ys_[head_]);
+    else ++n_;
+    xs_[head_] = x; ys_[head_] = y;
+    Insert(x, y);
+    head_ = (head_ + 1) % period_;
+    if (++since_exact_ >= period_) Recompute();
+    return Value();
+  }
+
+  // Corrélation si (x, y) remplaçait la plus ancienne valeur (bar en cours)
+  double Peek(double x, double y) const {
+    if (!have_ref_) return 0.0;
+    x -= rx_; y -= ry_;
+    double sx = sx_ + x, sy = sy_ + y, sxx = sxx_ + x * x, syy = syy_ + y * y, sxy = sxy_ + x * y;
+    int n = n_ + 1;
+    if (n_ == period_) {
+      const double ox = xs_[head_], oy = ys_[head_];
+      sx -= ox; sy -= oy; sxx -= ox * ox; syy -= oy * oy; sxy -= ox * oy;
+      n = n_;
+    }
+    return Pearson(n, sx, sy, sxx, syy, sxy);
+  }
+
+  double Value() const { return Pearson(n_, sx_, sy_, sxx_, syy_, sxy_); }
+  bool Ready() const { return n_ == period_; }
+
+ private:
+  static double Pearson(int n, double sx, double sy, double sxx, double syy, double sxy) {
+    if (n < 2) return 0.0;
+    const double vx = n * sxx - sx * sx, vy = n * syy - sy * sy;
+    if (vx <= 0.0 || vy <= 0.0) return 0.0;
+    const double r = (n * sxy - sx * sy) / sqrt(vx * vy);
+    return r > 1.0 ? 1.0 : (r < -1.0 ? -1.0 : r);
+  }
+  void Insert(double x, double y) { sx_ += x; sy_ += y; sxx_ += x * x; syy_ += y * y; sxy_ += x * y; }
+  void Remove(double x, double y) { sx_ -= x; sy_ -= y; sxx_ -= x * x; syy_ -= y * y; sxy_ -= x * y; }
+  void Recompute() {
+    sx_ = sy_ = sxx_ = syy_ = sxy_ = 0.0;
+    for (int i = 0; i < n_; ++i) Insert(xs_[i], ys_[i]);
+    since_exact_ = 0;
+  }
+
+  int period_ = 20;
+  std::vector<double> xs_, ys_;
+  int n_ = 0, head_ = 0, since_exact_ = 0;
+  double sx_ = 0, sy_ = 0, sxx_ = 0, syy_ = 0, sxy_ = 0;
+  double rx_ = 0, ry_ = 0;
+  bool have_ref_ = false;
+};
+
+// out[i] = corrélation sur les min(period, i + 1) dernières paires
+static inline void MiaRollingCorrBatch(const float* x, const float* y, int n, int period, double* out) {
+  if (n <= 0) return;
+  if (period < 2) period = 2;
+  // Passe 1: sommes préfixes centrées (séquentielle)
+  std::vector<double> px(n + 1), py(n + 1), pxx(n + 1), pyy(n + 1), pxy(n + 1);
+  const double rx = x[0], ry = y[0];
+  px[0] = py[0] = pxx[0] = pyy[0] = pxy[0] = 0.0;
+  for (int i = 0; i < n; ++i) {
+    const double a = x[i] - rx, b = y[i] - ry;
+    px[i + 1] = px[i] + a; py[i + 1] = py[i] + b;
+    pxx[i + 1] = pxx[i] + a * a; pyy[i + 1] = pyy[i] + b * b; pxy[i + 1] = pxy[i] + a * b;
+  }
+  // Passe 2: fenêtres indépendantes (vectorisable)
+  for (int i = 0; i < n; ++i) {
+    const int j = i + 1 > period ? i + 1 - period : 0;
+    const double m = (double)(i + 1 - j);
+    const double sx = px[i + 1] - px[j], sy = py[i + 1] - py[j];
+    const double vx = m * (pxx[i + 1] - pxx[j]) - sx * sx;
+    const double vy = m * (pyy[i + 1] - pyy[j]) - sy * sy;
+    const double cov = m * (pxy[i + 1] - pxy[j]) - sx * sy;
+    const double den = vx * vy;
+    double r = (m >= 2.0 && vx > 0.0 && vy > 0.0) ? cov / sqrt(den > 0.0 ? den : 1.0) : 0.0;
+    out[i] = r > 1.0 ? 1.0 : (r < -1.0 ? -1.0 : r);
+  }
+}
+
+// ---- Z-score glissant ----
+class MiaRollingZScore {
+ public:
+  void Init(int period) {
+    period_ = period > 1 ? period : 2;
+    xs_.assign(period_, 0.0);
+    Reset();
+  }
+  void Reset() { n_ = 0; head_ = 0; since_exact_ = 0; s_ = ss_ = 0.0; have_ref_ = false; }
+
+  double Push(double x) {
+    if (!have_ref_) { ref_ = x; have_ref_ = true; }
+    x -= ref_;
+    if (n_ == period_) { const double o = xs_[head_]; s_ -= o; ss_ -= o * o; }
+    else ++n_;
+    xs_[head_] = x;
+    s_ += x; ss_ += x * x;
+    head_ = (head_ + 1) % period_;
+    if (++since_exact_ >= period_) {
+      s_ = ss_ = 0.0;
+      for (int i = 0; i < n_; ++i) { s_ += xs_[i]; ss_ += xs_[i] * xs_[i]; }
+      since_exact_ = 0;
+    }
+    return Z(n_, s_, ss_, x);
+  }
+
+  double Peek(double x) const {
+    if (!have_ref_) return 0.0;
+    x -= ref_;
+    double s = s_ + x, ss = ss_ + x * x;
+    int n = n_ + 1;
+    if (n_ == period_) { const double o = xs_[head_]; s -= o; ss -= o * o; n = n_; }
+    return Z(n, s, ss, x);
+  }
+
+ private:
+  static double Z(int n, double s, double ss, double x) {
+    if (n < 2) return 0.0;
+    const double mean = s / n, var = ss / n - mean * mean;
+    return var > 0.0 ? (x - mean) / sqrt(var) : 0.0;
+  }
+
+  int period_ = 20;
+  std::vector<double> xs_;
+  int n_ = 0, head_ = 0, since_exact_ = 0;
+  double s_ = 0, ss_ = 0, ref_ = 0;
+  bool have_ref_ = false;
+};
+
+static inline void MiaRollingZScoreBatch(const float* x, int n, int period, double* out) {
+  if (n <= 0) return;
+  if (period < 2) period = 2;
+  std::vector<double> ps(n + 1), pss(n + 1);
+  const double ref = x[0];
+  ps[0] = pss[0] = 0.0;
+  for (int i = 0; i < n; ++i) {
+    const double a = x[i] - ref;
+    ps[i + 1] = ps[i] + a;
+    pss[i + 1] = pss[i] + a * a;
+  }
+  for (int i = 0; i < n; ++i) {
+    const int j = i + 1 > period ? i + 1 - period : 0;
+    const double m = (double)(i + 1 - j);
+    const double mean = (ps[i + 1] - ps[j]) / m;
+    const double var = (pss[i + 1] - pss[j]) / m - mean * mean;
+    out[i] = (m >= 2.0 && var > 0.0) ? ((x[i] - ref) - mean) / sqrt(var > 0.0 ? var : 1.0) : 0.0;
+  }
+}
+
+// ---- Moyenne / variance exponentielles ----
+class MiaEwmaVar {
+ public:
+  void Init(double alpha) {
+    alpha_ = (alpha > 0.0 && alpha <= 1.0) ? alpha : 0.06;
+    Reset();
+  }
+  void Reset() { mean_ = 0.0; var_ = 0.0; have_ = false; }
+
+  // var_n = (1 - a) * (var_{n-1} + a * (x - mean_{n-1})^2)
+  double Push(double x) {
+    if (!have_) { mean_ = x; var_ = 0.0; have_ = true; return var_; }
+    const double d = x - mean_;
+    mean_ += alpha_ * d;
+    var_ = (1.0 - alpha_) * (var_ + alpha_ * d * d);
+    return var_;
+  }
+  double Peek(double x) const {
+    if (!have_) return 0.0;
+    const double d = x - mean_;
+    return (1.0 - alpha_) * (var_ + alpha_ * d * d);
+  }
+
+  double Mean() const { return mean_; }
+  double Var() const { return var_; }
+
+ private:
+  double alpha_ = 0.06;
+  double mean_ = 0.0, var_ = 0.0;
+  bool have_ = false;
+};
+
+// Récurrence séquentielle; out[i] = variance après x[i]
+static inline void MiaEwmaVarBatch(const float* x, int n, double alpha, double* out) {
+  MiaEwmaVar k;
+  k.Init(alpha);
+  for (int i = 0; i < n; ++i) out[i] = k.Push(x[i]);
+}
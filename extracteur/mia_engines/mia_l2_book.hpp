@@ -0,0 +1,220 @@
+#pragma once
+// ========== CARNET L2 PAR OFFSET DE TICK ==========
+// Moteur C++ pur: carnet en tableaux contigus indexés par (prix en ticks -
+// ancre). L'ancre se déplace quand le marché sort de la fenêtre (recentrage
+// rare, O(fenêtre)). Lecture d'un prix en O(1), meilleur bid/ask suivis,
+// vue par niveau (1 = meilleur) et sommes cumulées par niveau et par
+// distance en ticks.
+//
+// Alimenté par le ladder interrogé à chaque appel (Apply): le carnet est
+// alors la fenêtre observée, et Apply produit au passage les diffs
+// add/modify/delete par prix et le masque des niveaux modifiés (diff
+// vectorisé des tableaux empaquetés). C'est la source unique des sorties depth.
+
+#include "mia_book_diff.hpp"
+#include "mia_ladder_diff.hpp"
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+class MiaL2Book {
+ public:
+  enum { kMaxLevels = MIA_LADDER_MAX_LEVELS };
+
+  explicit MiaL2Book(int windowTicks = 4096)
+      : window_(windowTicks > 64 ? windowTicks : 64) {
+    for (int s = 0; s < 2; ++s) {
+      cells_[s].assign((size_t)window_, 0);
+      prefix_[s].assign((size_t)window_ + 1, 0);
+    }
+  }
+
+  // Applique le ladder observé (meilleur niveau d'abord). 'diffs' (optionnel)
+  // reçoit les opérations par prix depuis l'Apply précédent.
+  void Apply(const MiaLadder& ladder, std::vector<MiaBookDiff>* diffs) {
+    if (diffs) diffs->clear();
+    EnsureInWindow(ladder);
+    ApplySide(MIA_BOOK_BID, ladder.bids, diffs);
+    ApplySide(MIA_BOOK_ASK, ladder.asks, diffs);
+    prefix_dirty_ = true;
+  }
+
+  void Clear() {
+    for (int s = 0; s < 2; ++s) {
+      for (int i = 0; i < count_[s]; ++i) {
+        if (InWindow(lvl_ticks_[s][i])) Cell(s, lvl_ticks_[s][i]) = 0;
+      }
+      count_[s] = prev_count_[s] = 0;
+      changed_[s].Clear();
+    }
+    prefix_dirty_ = true;
+  }
+
+  // ---- Lecture O(1) ----
+  int64_t SizeAt(int side, int64_t ticks) const {
+    const int64_t off = ticks - anchor_;
+    if (!have_anchor_ || off < 0 || off >= window_) return 0;
+    return cells_[side][(size_t)off];
+  }
+
+  bool HasBest(int side) const { return count_[side] > 0; }
+  int64_t BestBid() const { return best_[MIA_BOOK_BID]; }
+  int64_t BestAsk() const { return best_[MIA_BOOK_ASK]; }
+  int64_t SpreadTicks() const { return (HasBest(MIA_BOOK_BID) && HasBest(MIA_BOOK_ASK)) ? best_[1] - best_[0] : 0; }
+
+  // Vue par niveau, lvl 1-based dans l'ordre du ladder
+  int LevelCount(int side) const { return count_[side]; }
+  int64_t LevelTicks(int side, int lvl) const { return lvl_ticks_[side][lvl - 1]; }
+  int32_t LevelSize(int side, int lvl) const { return lvl_size_[side][lvl - 1]; }
+
+  // Niveaux modifiés (prix ou taille) depuis l'Apply précédent: bit lvl-1
+  const MiaLevelMask& ChangedLevels(int side) const { return changed_[side]; }
+  bool LevelChanged(int side, int lvl) const { return changed_[side].Test(lvl - 1); }
+
+  // Taille cumulée des 'levels' meilleurs niveaux
+  int64_t CumSizeLevels(int side, int levels) const {
+    if (levels <= 0) return 0;
+    if (levels > count_[side]) levels = count_[side];
+    return lvl_cum_[side][levels - 1];
+  }
+
+  // Taille cumulée à moins de 'ticks' ticks du meilleur prix (inclus)
+  int64_t CumSizeWithin(int side, int ticks) {
+    if (!HasBest(side) || ticks < 0) return 0;
+    if (prefix_dirty_) RebuildPrefix();
+    const int64_t best = best_[side] - anchor_;
+    // prefix_[s][k] = somme des cellules [0, k)
+    if (side == MIA_BOOK_BID) {
+      int64_t lo = best - ticks;
+      if (lo < 0) lo = 0;
+      return prefix_[side][(size_t)best + 1] - prefix_[side][(size_t)lo];
+    }
+    int64_t hi = best + ticks + 1;
+    if (hi > window_) hi = window_;
+    return prefix_[side][(size_t)hi] - prefix_[side][(size_t)best];
+  }
+
+  int64_t Anchor() const { return anchor_; }
+  int Window() const { return window_; }
+  uint64_t Recenters() const { return recenters_; }
+
+ private:
+  int32_t& Cell(int side, int64_t ticks) { return cells_[side][(size_t)(ticks - anchor_)]; }
+
+  bool InWindow(int64_t ticks) const {
+    const int64_t off = ticks - anchor_;
+    return off >= 0 && off < window_;
+  }
+
+  // Déplace l'ancre si un prix du ladder sort de la fenêtre: le contenu
+  // courant (niveaux connus) est réinséré autour de la nouvelle ancre.
+  void EnsureInWindow(const MiaLadder& ladder) {
+    int64_t lo = INT64_MAX, hi = INT64_MIN;
+    auto scan = [&](const std::vector<std::pair<int64_t, int64_t>>& v) {
+      for (const auto& lv : v) {
+        if (lv.first < lo) lo = lv.first;
+        if (lv.first > hi) hi = lv.first;
+      }
+    };
+    scan(ladder.bids);
+    scan(ladder.asks);
+    if (lo > hi) return;
+    if (have_anchor_ && InWindow(lo) && InWindow(hi)) return;
+
+    const int64_t newAnchor = (lo + hi) / 2 - window_ / 2;
+    for (int s = 0; s < 2; ++s) memset(cells_[s].data(), 0, cells_[s].size() * sizeof(int32_t));
+    anchor_ = newAnchor;
+    have_anchor_ = true;
+    for (int s = 0; s < 2; ++s) {
+      for (int i = 0; i < count_[s]; ++i) {
+        if (InWindow(lvl_ticks_[s][i])) Cell(s, lvl_ticks_[s][i]) = lvl_size_[s][i];
+      }
+    }
+    recenters_++;
+  }
+
+  void ApplySide(int side, const std::vector<std::pair<int64_t, int64_t>>& next, std::vector<MiaBookDiff>* diffs) {
+    // Niveaux précédents conservés pour LevelChanged et les deletes
+    prev_count_[side] = count_[side];
+    memcpy(prev_ticks_[side], lvl_ticks_[side], sizeof(int64_t) * (size_t)count_[side]);
+    memcpy(prev_size_[side], lvl_size_[side], sizeof(int32_t) * (size_t)count_[side]);
+
+    // 1) add/modify contre l'état courant (cellules encore à l'état précédent)
+    int n = 0;
+    for (const auto& lv : next) {
+      // ladder plus large que la fenêtre: niveaux hors fenêtre ignorés
+      if (lv.second <= 0 || n >= kMaxLevels || !InWindow(lv.first)) continue;
+      const int32_t size = (int32_t)lv.second;
+      if (diffs) {
+        const int32_t old = Cell(side, lv.first);
+        if (old == 0) diffs->push_back(MiaBookDiff{(uint8_t)side, MIA_BOOK_ADD, lv.first, size});
+        else if (old != size) diffs->push_back(MiaBookDiff{(uint8_t)side, MIA_BOOK_MODIFY, lv.first, size});
+      }
+      lvl_ticks_[side][n] = lv.first;
+      lvl_size_[side][n] = size;
+      n++;
+    }
+    count_[side] = n;
+
+    // 2) remplace les cellules: anciennes à zéro, nouvelles écrites
+    for (int i = 0; i < prev_count_[side]; ++i) {
+      if (InWindow(prev_ticks_[side][i])) Cell(side, prev_ticks_[side][i]) = 0;
+    }
+    int64_t cum = 0;
+    int64_t best = 0;
+    for (int i = 0; i < n; ++i) {
+      Cell(side, lvl_ticks_[side][i]) = lvl_size_[side][i];
+      cum += lvl_size_[side][i];
+      lvl_cum_[side][i] = cum;
+      if (i == 0 || (side == MIA_BOOK_BID ? lvl_ticks_[side][i] > best : lvl_ticks_[side][i] < best)) {
+        best = lvl_ticks_[side][i];
+      }
+    }
+    best_[side] = best;
+
+    MiaDiffLadder(lvl_ticks_[side], lvl_size_[side], prev_ticks_[side], prev_size_[side],
+                  n, prev_count_[side], changed_[side]);
+
+    // 3) prix précédents absents du nouveau ladder -> delete
+    if (diffs) {
+      for (int i = 0; i < prev_count_[side]; ++i) {
+        const int64_t t = prev_ticks_[side][i];
+        if (!InWindow(t) || Cell(side, t) == 0) {
+          diffs->push_back(MiaBookDiff{(uint8_t)side, MIA_BOOK_DELETE, t, 0});
+        }
+      }
+    }
+  }
+
+  void RebuildPrefix() {
+    for (int s = 0; s < 2; ++s) {
+      int64_t* p = prefix_[s].data();
+      const int32_t* c = cells_[s].data();
+      p[0] = 0;
+      for (int k = 0; k < window_; ++k) p[k + 1] = p[k] + c[k];
+    }
+    prefix_dirty_ = false;
+  }
+
+  int window_;
+  int64_t anchor_ = 0;
+  bool have_anchor_ = false;
+  uint64_t recenters_ = 0;
+
+  std::vector<int32_t> cells_[2];   // taille par offset de tick
+  std::vector<int64_t> prefix_[2];  // sommes cumulées des cellules (paresseuses)
+  bool prefix_dirty_ = true;
+
+  int64_t best_[2] = {0, 0};
+  int count_[2] = {0, 0};
+  // Ladder empaqueté (structure de tableaux) courant et précédent
+  alignas(16) int64_t lvl_ticks_[2][kMaxLevels];
+  alignas(16) int32_t lvl_size_[2][kMaxLevels];
+  int64_t lvl_cum_[2][kMaxLevels];
+
+  int prev_count_[2] = {0, 0};
+  alignas(16) int64_t prev_ticks_[2][kMaxLevels];
+  alignas(16) int32_t prev_size_[2][kMaxLevels];
+  MiaLevelMask changed_[2];
+};
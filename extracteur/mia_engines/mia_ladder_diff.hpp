@@ -0,0 +1,87 @@
+#pragma once
+// ========== DIFF VECTORISÉ DU LADDER ==========
+// Compare deux ladders empaquetés (tableaux contigus ticks[] / size[] par
+// niveau) et produit un masque de bits des niveaux modifiés: bit i = niveau
+// i+1 a changé de prix ou de taille. Chemin SSE2 (toujours présent en x64)
+// par blocs de 4 niveaux, fin en scalaire; repli scalaire hors x86.
+// Seuls les niveaux du masque sont ensuite sérialisés.
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIA_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+enum { MIA_LADDER_MAX_LEVELS = 256 };
+
+struct MiaLevelMask {
+  uint64_t w[MIA_LADDER_MAX_LEVELS / 64];
+
+  void Clear() { memset(w, 0, sizeof w); }
+  bool Test(int i) const { return (w[i >> 6] >> (i & 63)) & 1u; }
+  void Set(int i) { w[i >> 6] |= (uint64_t)1 << (i & 63); }
+
+  // Prochain bit à 1 à partir de 'i' (-1 si aucun)
+  int Next(int i) const {
+    if (i >= MIA_LADDER_MAX_LEVELS) return -1;
+    int word = i >> 6;
+    uint64_t bits = w[word] & (~(uint64_t)0 << (i & 63));
+    while (true) {
+      if (bits) return (word << 6) + Ctz(bits);
+      if (++word >= MIA_LADDER_MAX_LEVELS / 64) return -1;
+      bits = w[word];
+    }
+  }
+
+  static int Ctz(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return (int)idx;
+#else
+    return __builtin_ctzll(v);
+#endif
+  }
+};
+
+// Niveaux [0, n) comparés à [0, prevN); les niveaux au-delà de prevN sont
+// tous marqués modifiés.
+static inline void MiaDiffLadder(const int64_t* ticks, const int32_t* size,
+                                 const int64_t* prevTicks, const int32_t* prevSize,
+                                 int n, int prevN, MiaLevelMask& mask) {
+  mask.Clear();
+  const int common = n < prevN ? n : prevN;
+  int i = 0;
+#ifdef MIA_HAVE_SSE2
+  for (; i + 4 <= common; i += 4) {
+    // Tailles: 4 x int32
+    const __m128i s0 = _mm_loadu_si128((const __m128i*)(size + i));
+    const __m128i s1 = _mm_loadu_si128((const __m128i*)(prevSize + i));
+    const int sizeEq = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(s0, s1)));
+
+    // Prix: 2 x int64 par registre; égalité 64 bits = deux moitiés 32 bits égales
+    const __m128i a0 = _mm_loadu_si128((const __m128i*)(ticks + i));
+    const __m128i b0 = _mm_loadu_si128((const __m128i*)(prevTicks + i));
+    const __m128i a1 = _mm_loadu_si128((const __m128i*)(ticks + i + 2));
+    const __m128i b1 = _mm_loadu_si128((const __m128i*)(prevTicks + i + 2));
+    __m128i e0 = _mm_cmpeq_epi32(a0, b0);
+    __m128i e1 = _mm_cmpeq_epi32(a1, b1);
+    e0 = _mm_and_si128(e0, _mm_shuffle_epi32(e0, _MM_SHUFFLE(2, 3, 0, 1)));
+    e1 = _mm_and_si128(e1, _mm_shuffle_epi32(e1, _MM_SHUFFLE(2, 3, 0, 1)));
+    const int tickEq = _mm_movemask_pd(_mm_castsi128_pd(e0)) | (_mm_movemask_pd(_mm_castsi128_pd(e1)) << 2);
+
+    const uint64_t changed = (uint64_t)(~(sizeEq & tickEq) & 0xF);
+    mask.w[i >> 6] |= changed << (i & 63);
+  }
+#endif
+  for (; i < common; ++i) {
+    if (ticks[i] != prevTicks[i] || size[i] != prevSize[i]) mask.Set(i);
+  }
+  for (; i < n; ++i) mask.Set(i);
+}
@@ -0,0 +1,199 @@
+#pragma once
+// ========== PROXIMITÉ PRIX / NIVEAUX (TOUCH / CROSS) ==========
+// Moteur C++ pur: les niveaux (gamma...) sont gardés dans un tableau trié de
+// prix en ticks, les blind spots en zones [prix - w, prix + w] fusionnées en
+// intervalles disjoints triés. À chaque trade:
+//  - niveaux: deux recherches dichotomiques donnent les niveaux franchis
+//    depuis le trade précédent (cross) et les voisins immédiats au-dessus /
+//    en dessous; un voisin à <= touch ticks alors que le trade précédent en
+//    était plus loin produit un touch;
+//  - zones: la zone contenant le prix est trouvée par dichotomie; entrer
+//    dans une zone est un touch, la quitter par le côté opposé à l'entrée
+//    (ou la sauter en un trade) est un cross.
+// O(log n) par trade hors événements, aucune allocation hors SetLevels().
+
+#include "mia_level_table.hpp"
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+enum MiaProximityKind { MIA_PROX_TOUCH = 0, MIA_PROX_CROSS = 1 };
+
+struct MiaProximityZone {
+  int64_t lo = 0, hi = 0;  // ticks, bornes incluses
+  int first = 0;           // premier blind spot fusionné (index dans Zoned())
+  int count = 0;
+};
+
+struct MiaProximityEvent {
+  int kind = MIA_PROX_TOUCH;
+  bool zone = false;  // zone blind spot (index dans Zones()) sinon niveau (Levels())
+  int index = 0;
+  int dir = 0;        // +1 prix montant, -1 descendant
+  int64_t px = 0;     // trade (ticks)
+  int64_t dist = 0;   // |px - niveau| en ticks (zone: 0 à l'intérieur)
+};
+
+class MiaLevelProximity {
+ public:
+  void Configure(int touchTicks, int zoneHalfWidthTicks) {
+    touch_ = touchTicks > 0 ? touchTicks : 0;
+    half_ = zoneHalfWidthTicks > 0 ? zoneHalfWidthTicks : 0;
+  }
+
+  // Niveaux triés (MiaLevelTable::Sorted); ceux de 'zoneGroup' deviennent
+  // des zones, les familles hors 'levelGroupMask' sont ignorées
+  void SetLevels(const std::vector<MiaLevel>& sorted, unsigned levelGroupMask, int zoneGroup) {
+    ticks_.clear();
+    levels_.clear();
+    zoned_.clear();
+    zones_.clear();
+    for (const MiaLevel& l : sorted) {
+      if (l.group == zoneGroup) zoned_.push_back(l);
+      else if ((levelGroupMask >> l.group) & 1u) {
+        levels_.push_back(l);
+        ticks_.push_back(l.ticks);
+      }
+    }
+    for (int k = 0; k < (int)zoned_.size(); ++k) {
+      const int64_t lo = zoned_[k].ticks - half_, hi = zoned_[k].ticks + half_;
+      if (!zones_.empty() && lo <= zones_.back().hi + 1) {
+        if (hi > zones_.back().hi) zones_.back().hi = hi;
+        zones_.back().count++;
+      } else {
+        MiaProximityZone z;
+        z.lo = lo;
+        z.hi = hi;
+        z.first = k;
+        z.count = 1;
+        zones_.push_back(z);
+      }
+    }
+    zone_in_ = has_prev_ ? ZoneOf(prev_) : -1;
+    zone_from_ = 0;  // côté d'entrée inconnu après reconstruction
+  }
+
+  void Reset() {
+    has_prev_ = false;
+    zone_in_ = -1;
+    zone_from_ = 0;
+  }
+
+  // Trade au prix 'px' (ticks); événements ajoutés à 'events' (non vidé)
+  void OnTrade(int64_t px, std::vector<MiaProximityEvent>& events) {
+    if (!has_prev_) {
+      prev_ = px;
+      has_prev_ = true;
+      zone_in_ = ZoneOf(px);
+      zone_from_ = 0;
+      return;
+    }
+    const int64_t p = prev_;
+    prev_ = px;
+    if (px == p) return;
+    const int dir = px > p ? 1 : -1;
+
+    // Niveaux franchis: p < L <= px (montée) ou px <= L < p (descente)
+    if (dir > 0) {
+      const int a = (int)(std::upper_bound(ticks_.begin(), ticks_.end(), p) - ticks_.begin());
+      const int b = (int)(std::upper_bound(ticks_.begin(), ticks_.end(), px) - ticks_.begin());
+      for (int k = a; k < b; ++k) Push(events, MIA_PROX_CROSS, false, k, dir, px, px - ticks_[k]);
+    } else {
+      const int a = (int)(std::lower_bound(ticks_.begin(), ticks_.end(), px) - ticks_.begin());
+      const int b = (int)(std::lower_bound(ticks_.begin(), ticks_.end(), p) - ticks_.begin());
+      for (int k = b - 1; k >= a; --k) Push(events, MIA_PROX_CROSS, false, k, dir, px, ticks_[k] - px);
+    }
+
+    // Voisins immédiats: touch à l'approche (non franchis par ce trade)
+    const int above = (int)(std::lower_bound(ticks_.begin(), ticks_.end(), px) - ticks_.begin());
+    for (int k = above - 1; k <= above; ++k) {
+      if (k < 0 || k >= (int)ticks_.size()) continue;
+      const int64_t L = ticks_[k];
+      const int64_t d = px > L ? px - L : L - px;
+      const int64_t dp = p > L ? p - L : L - p;
+      const bool crossed = dir > 0 ? (p < L && L <= px) : (px <= L && L < p);
+      if (d <= touch_ && dp > touch_ && !crossed) Push(events, MIA_PROX_TOUCH, false, k, dir, px, d);
+    }
+
+    if (!zones_.empty()) OnZones(p, px, dir, events);
+  }
+
+  // Voisins du prix: index dans Levels() (-1 si aucun)
+  void Nearest(int64_t px, int& below, int& above) const {
+    const int k = (int)(std::lower_bound(ticks_.begin(), ticks_.end(), px) - ticks_.begin());
+    above = k < (int)ticks_.size() ? k : -1;
+    below = (k < (int)ticks_.size() && ticks_[k] == px) ? k : k - 1;
+  }
+
+  const std::vector<MiaLevel>& Levels() const { return levels_; }
+  const std::vector<MiaProximityZone>& Zones() const { return zones_; }
+  const std::vector<MiaLevel>& Zoned() const { return zoned_; }
+
+ private:
+  // Zone contenant px (-1 sinon)
+  int ZoneOf(int64_t px) const {
+    int k = (int)(std::upper_bound(zones_.begin(), zones_.end(), px,
+                                   [](int64_t v, const MiaProximityZone& z) { return v < z.lo; }) -
+                  zones_.begin()) - 1;
+    return (k >= 0 && px <= zones_[k].hi) ? k : -1;
+  }
+
+  void OnZones(int64_t p, int64_t px, int dir, std::vector<MiaProximityEvent>& events) {
+    const int zc = ZoneOf(px);
+    const int zp = zone_in_;
+
+    // Sortie de la zone précédente: cross si par le côté opposé à l'entrée
+    if (zp >= 0 && zc != zp) {
+      const int side = px > zones_[zp].hi ? 1 : -1;  // côté de sortie
+      if (zone_from_ == -side) Push(events, MIA_PROX_CROSS, true, zp, dir, px, 0);
+    }
+
+    // Zones sautées en un seul trade
+    if (dir > 0) {
+      for (int k = (zp >= 0 ? zp : ZoneBelow(p)) + 1; k < (int)zones_.size() && zones_[k].hi < px; ++k) {
+        if (zones_[k].lo > p) Push(events, MIA_PROX_CROSS, true, k, dir, px, 0);
+      }
+    } else {
+      for (int k = (zp >= 0 ? zp : ZoneBelow(p) + 1) - 1; k >= 0 && zones_[k].lo > px; --k) {
+        if (zones_[k].hi < p) Push(events, MIA_PROX_CROSS, true, k, dir, px, 0);
+      }
+    }
+
+    // Entrée dans une zone
+    if (zc >= 0 && zc != zp) {
+      zone_from_ = p < zones_[zc].lo ? -1 : (p > zones_[zc].hi ? 1 : 0);
+      Push(events, MIA_PROX_TOUCH, true, zc, dir, px, 0);
+    }
+    zone_in_ = zc;
+  }
+
+  // Dernière zone entièrement sous px (-1 sinon)
+  int ZoneBelow(int64_t px) const {
+    return (int)(std::lower_bound(zones_.begin(), zones_.end(), px,
+                                  [](const MiaProximityZone& z, int64_t v) { return z.hi < v; }) -
+                 zones_.begin()) - 1;
+  }
+
+  static void Push(std::vector<MiaProximityEvent>& events, int kind, bool zone, int index, int dir, int64_t px,
+                   int64_t dist) {
+    MiaProximityEvent e;
+    e.kind = kind;
+    e.zone = zone;
+    e.index = index;
+    e.dir = dir;
+    e.px = px;
+    e.dist = dist;
+    events.push_back(e);
+  }
+
+  std::vector<int64_t> ticks_;  // niveaux triés (recherche dichotomique)
+  std::vector<MiaLevel> levels_;
+  std::vector<MiaLevel> zoned_;
+  std::vector<MiaProximityZone> zones_;
+  int touch_ = 2, half_ = 2;
+  int64_t prev_ = 0;
+  bool has_prev_ = false;
+  int zone_in_ = -1;    // zone contenant le dernier trade
+  int zone_from_ = 0;   // côté d'entrée dans zone_in_ (-1 dessous, +1 dessus, 0 inconnu)
+};
@@ -0,0 +1,191 @@
+#pragma once
+// ========== TABLE DES NIVEAUX (MENTHORQ) ==========
+// Moteur C++ pur: une famille de niveaux (gamma, blind spots, swing...) est
+// un tableau empaqueté de prix en ticks indexé par subgraph (0 = absent).
+// Un relevé complet passe en deux temps vectorisés:
+//  - MiaNormalizeLevels: valeurs brutes des subgraphs -> ticks (mêmes
+//    règles que NormalizePx: multiplicateur, correction x100, arrondi au
+//    tick), valeurs nulles / NaN / infinies -> 0;
+//  - UpdateGroup: masque des subgraphs modifiés contre le relevé précédent
+//    (SSE2 par blocs de 2 x int64), seuls ceux-ci produisent un changement
+//    (apparu, déplacé, disparu).
+// Sorted() donne les niveaux présents triés par prix (reconstruit seulement
+// après un changement), pour la recherche dichotomique autour du prix.
+
+#include "mia_ladder_diff.hpp"
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+enum MiaLevelChangeKind { MIA_LEVEL_ADDED = 0, MIA_LEVEL_MOVED = 1, MIA_LEVEL_REMOVED = 2 };
+
+struct MiaLevel {
+  int group = 0;  // famille de niveaux
+  int sg = 0;     // subgraph dans la famille
+  int64_t ticks = 0;
+};
+
+struct MiaLevelChange {
+  int kind = MIA_LEVEL_ADDED;
+  MiaLevel level;          // ticks = nouveau prix (dernier prix si REMOVED)
+  int64_t prev_ticks = 0;  // MOVED uniquement
+};
+
+// Prix brut -> ticks comme NormalizePx; 0 si invalide. Deux valeurs par
+// registre SSE2 (les ticks valides sont positifs: extension par zéros)
+static inline void MiaNormalizeLevels(const float* raw, int n, double mult, double tick, int64_t* out) {
+  if (mult == 0.0) mult = 1.0;
+  if (tick <= 0.0) {
+    for (int k = 0; k < n; ++k) out[k] = 0;
+    return;
+  }
+  const double invMult = 1.0 / mult, invTick = 1.0 / tick;
+  int k = 0;
+#ifdef MIA_HAVE_SSE2
+  const __m128d vInvMult = _mm_set1_pd(invMult), vInvTick = _mm_set1_pd(invTick), vTick = _mm_set1_pd(tick);
+  const __m128d vZero = _mm_setzero_pd(), vScale = _mm_set1_pd(10000.0), vCent = _mm_set1_pd(0.01);
+  const __m128d vMaxTicks = _mm_set1_pd(2.0e9);
+  for (; k + 2 <= n; k += 2) {
+    const __m128d v = _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double*)(raw + k))));
+    __m128d valid = _mm_cmpgt_pd(v, vZero);  // faux pour NaN
+
+    // Dé-multiplication puis correction d'échelle x100
+    __m128d px = _mm_mul_pd(v, vInvMult);
+    __m128d big = _mm_cmpgt_pd(px, vScale);
+    px = _mm_or_pd(_mm_and_pd(big, _mm_mul_pd(px, vCent)), _mm_andnot_pd(big, px));
+
+    // Arrondi au tick, puis correction résiduelle et nouvel arrondi
+    __m128d t = _mm_cvtepi32_pd(_mm_cvtpd_epi32(_mm_mul_pd(px, vInvTick)));
+    big = _mm_cmpgt_pd(_mm_mul_pd(t, vTick), vScale);
+    const __m128d t2 = _mm_cvtepi32_pd(_mm_cvtpd_epi32(_mm_mul_pd(_mm_mul_pd(_mm_mul_pd(t, vTick), vCent), vInvTick)));
+    t = _mm_or_pd(_mm_and_pd(big, t2), _mm_andnot_pd(big, t));
+
+    valid = _mm_and_pd(valid, _mm_cmplt_pd(_mm_mul_pd(px, vInvTick), vMaxTicks));  // faux pour +inf
+    t = _mm_and_pd(valid, t);
+    const __m128i ti = _mm_cvtpd_epi32(t);
+    _mm_storeu_si128((__m128i*)(out + k), _mm_unpacklo_epi32(ti, _mm_setzero_si128()));
+  }
+#endif
+  for (; k < n; ++k) {
+    const double v = raw[k];
+    double px = v * invMult;
+    if (!(v > 0.0) || !(px * invTick < 2.0e9)) {
+      out[k] = 0;
+      continue;
+    }
+    if (px > 10000.0) px *= 0.01;
+    double t = nearbyint(px * invTick);
+    if (t * tick > 10000.0) t = nearbyint(t * tick * 0.01 * invTick);
+    out[k] = (int64_t)t;
+  }
+}
+
+class MiaLevelTable {
+ public:
+  enum { kMaxGroups = 4, kMaxPerGroup = MIA_LADDER_MAX_LEVELS };
+
+  // Nombre de subgraphs d'une famille (les emplacements au-delà sont oubliés)
+  void SetGroupSize(int group, int count) {
+    if (group < 0 || group >= kMaxGroups) return;
+    if (count < 0) count = 0;
+    if (count > kMaxPerGroup) count = kMaxPerGroup;
+    if ((int)ticks_[group].size() == count) return;
+    ticks_[group].resize(count, 0);
+    dirty_ = true;
+  }
+
+  void Reset() {
+    for (int g = 0; g < kMaxGroups; ++g) std::fill(ticks_[g].begin(), ticks_[g].end(), 0);
+    sorted_.clear();
+    dirty_ = false;
+  }
+
+  // Nouveau relevé d'un subgraph (present = false: niveau nul ou invalide);
+  // le changement éventuel est ajouté à 'changes' (non vidé)
+  void Update(int group, int sg, bool present, int64_t ticks, std::vector<MiaLevelChange>& changes) {
+    if (group < 0 || group >= kMaxGroups || sg < 0 || sg >= (int)ticks_[group].size()) return;
+    if (!present) ticks = 0;
+    int64_t& slot = ticks_[group][sg];
+    if (slot == ticks) return;
+    MiaLevelChange c;
+    c.level.group = group;
+    c.level.sg = sg;
+    if (slot == 0) {
+      c.kind = MIA_LEVEL_ADDED;
+      c.level.ticks = ticks;
+    } else if (ticks != 0) {
+      c.kind = MIA_LEVEL_MOVED;
+      c.level.ticks = ticks;
+      c.prev_ticks = slot;
+    } else {
+      c.kind = MIA_LEVEL_REMOVED;
+      c.level.ticks = slot;
+    }
+    slot = ticks;
+    changes.push_back(c);
+    dirty_ = true;
+  }
+
+  // Relevé complet d'une famille (ticks empaquetés, 0 = absent): seuls les
+  // subgraphs du masque de différences sont examinés
+  void UpdateGroup(int group, const int64_t* ticks, int n, std::vector<MiaLevelChange>& changes) {
+    if (group < 0 || group >= kMaxGroups) return;
+    SetGroupSize(group, n);
+    n = (int)ticks_[group].size();
+    const int64_t* prev = ticks_[group].data();
+    MiaLevelMask mask;
+    mask.Clear();
+    int k = 0;
+#ifdef MIA_HAVE_SSE2
+    for (; k + 2 <= n; k += 2) {
+      __m128i e = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(ticks + k)),
+                                  _mm_loadu_si128((const __m128i*)(prev + k)));
+      e = _mm_and_si128(e, _mm_shuffle_epi32(e, _MM_SHUFFLE(2, 3, 0, 1)));
+      const uint64_t changed = (uint64_t)(~_mm_movemask_pd(_mm_castsi128_pd(e)) & 0x3);
+      mask.w[k >> 6] |= changed << (k & 63);
+    }
+#endif
+    for (; k < n; ++k) {
+      if (ticks[k] != prev[k]) mask.Set(k);
+    }
+    for (int sg = mask.Next(0); sg >= 0 && sg < n; sg = mask.Next(sg + 1)) {
+      Update(group, sg, ticks[sg] != 0, ticks[sg], changes);
+    }
+  }
+
+  bool Get(int group, int sg, int64_t& ticks) const {
+    if (group < 0 || group >= kMaxGroups || sg < 0 || sg >= (int)ticks_[group].size()) return false;
+    if (ticks_[group][sg] == 0) return false;
+    ticks = ticks_[group][sg];
+    return true;
+  }
+
+  // Niveaux présents triés par prix croissant
+  const std::vector<MiaLevel>& Sorted() {
+    if (!dirty_) return sorted_;
+    sorted_.clear();
+    for (int g = 0; g < kMaxGroups; ++g) {
+      for (int k = 0; k < (int)ticks_[g].size(); ++k) {
+        if (ticks_[g][k] == 0) continue;
+        MiaLevel l;
+        l.group = g;
+        l.sg = k;
+        l.ticks = ticks_[g][k];
+        sorted_.push_back(l);
+      }
+    }
+    std::sort(sorted_.begin(), sorted_.end(), [](const MiaLevel& a, const MiaLevel& b) {
+      if (a.ticks != b.ticks) return a.ticks < b.ticks;
+      return a.group != b.group ? a.group < b.group : a.sg < b.sg;
+    });
+    dirty_ = false;
+    return sorted_;
+  }
+
+ private:
+  std::vector<int64_t> ticks_[kMaxGroups];  // par subgraph, 0 = absent
+  std::vector<MiaLevel> sorted_;
+  bool dirty_ = false;
+};
@@ -0,0 +1,68 @@
+#pragma once
+// ========== AGRÉGATION DES MÉTA-TRADES (SWEEPS) ==========
+// Moteur C++ pur: un ordre agressif qui balaie plusieurs niveaux arrive en
+// plusieurs prints de même côté et même horodatage. Les prints consécutifs
+// (même côté, même DateTime) sont fusionnés en un méta-trade: VWAP, volume
+// total, niveaux balayés, premier/dernier numéro de séquence.
+// Coût O(1) par print, aucune allocation.
+
+#include <stdint.h>
+
+struct MiaMetaTrade {
+  double t = 0.0;             // DateTime commun des prints
+  int side = 0;               // +1 achat agresseur, -1 vente, 0 inconnu
+  uint64_t vol = 0;
+  double pv = 0.0;            // somme prix * volume (ticks)
+  int64_t first_ticks = 0;
+  int64_t last_ticks = 0;
+  uint32_t levels = 0;        // niveaux balayés (changements de prix + 1)
+  uint32_t prints = 0;
+  uint32_t first_seq = 0;
+  uint32_t last_seq = 0;
+
+  double VwapTicks() const { return vol ? pv / (double)vol : (double)last_ticks; }
+};
+
+class MiaMetaTradeAggregator {
+ public:
+  // Ajoute un print. Retourne true si le méta-trade précédent est terminé
+  // (copié dans 'done'); le print courant démarre alors le suivant.
+  bool Add(double t, int side, int64_t ticks, uint32_t vol, uint32_t seq, MiaMetaTrade& done) {
+    bool completed = false;
+    if (open_ && (t != cur_.t || side != cur_.side)) {
+      done = cur_;
+      completed = true;
+      open_ = false;
+    }
+    if (!open_) {
+      cur_ = MiaMetaTrade();
+      cur_.t = t;
+      cur_.side = side;
+      cur_.first_ticks = ticks;
+      cur_.last_ticks = ticks;
+      cur_.levels = 1;
+      cur_.first_seq = seq;
+      open_ = true;
+    } else if (ticks != cur_.last_ticks) {
+      cur_.levels++;
+      cur_.last_ticks = ticks;
+    }
+    cur_.vol += vol;
+    cur_.pv += (double)ticks * vol;
+    cur_.prints++;
+    cur_.last_seq = seq;
+    return completed;
+  }
+
+  // Termine le méta-trade en cours (fin du lot T&S disponible)
+  bool Flush(MiaMetaTrade& done) {
+    if (!open_) return false;
+    done = cur_;
+    open_ = false;
+    return true;
+  }
+
+ private:
+  MiaMetaTrade cur_;
+  bool open_ = false;
+};
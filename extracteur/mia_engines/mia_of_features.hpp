@@ -0,0 +1,78 @@
+#pragma once
+// ========== FEATURES ORDER FLOW (OFI, MICROPRICE, DÉSÉQUILIBRE) ==========
+// Moteur C++ pur, mis à jour de façon incrémentale à chaque application du
+// carnet L2:
+//  - OFI de Cont (Cont, Kukanov & Stoikov): contribution de chaque mise à
+//    jour du meilleur bid/ask, sommée sur la fenêtre d'émission et cumulée
+//    sur la session;
+//  - microprice: moyenne des meilleurs prix pondérée par la taille opposée;
+//  - déséquilibre L1 et top-N: (bid - ask) / (bid + ask), dans [-1, 1];
+//  - spread en ticks.
+// Les prix restent en ticks; la conversion en prix se fait à l'émission.
+
+#include "mia_l2_book.hpp"
+
+#include <stdint.h>
+
+struct MiaOfFeatures {
+  int64_t ofi = 0;          // somme des e_n sur la fenêtre
+  int64_t ofi_cum = 0;      // cumul de session
+  uint32_t updates = 0;     // mises à jour du haut de carnet dans la fenêtre
+  double microprice_ticks = 0.0;
+  double mid_ticks = 0.0;
+  int64_t spread_ticks = 0;
+  double imbalance_l1 = 0.0;
+  double imbalance_topn = 0.0;
+};
+
+class MiaOrderFlowFeatures {
+ public:
+  // Lit le haut de carnet et les tailles cumulées après un Apply
+  void OnBook(const MiaL2Book& book, int topN) {
+    if (!book.HasBest(MIA_BOOK_BID) || !book.HasBest(MIA_BOOK_ASK)) return;
+    const int64_t pb = book.BestBid(), pa = book.BestAsk();
+    const int64_t qb = book.SizeAt(MIA_BOOK_BID, pb), qa = book.SizeAt(MIA_BOOK_ASK, pa);
+
+    if (have_prev_) {
+      if (pb != pb_ || qb != qb_ || pa != pa_ || qa != qa_) {
+        // e_n = 1{Pb>=Pb'}qb - 1{Pb<=Pb'}qb' - 1{Pa<=Pa'}qa + 1{Pa>=Pa'}qa'
+        int64_t e = 0;
+        if (pb >= pb_) e += qb;
+        if (pb <= pb_) e -= qb_;
+        if (pa <= pa_) e -= qa;
+        if (pa >= pa_) e += qa_;
+        cur_.ofi += e;
+        cur_.ofi_cum += e;
+        cur_.updates++;
+      }
+    } else {
+      cur_.updates++;
+    }
+    pb_ = pb; qb_ = qb; pa_ = pa; qa_ = qa;
+    have_prev_ = true;
+
+    const double sum1 = (double)(qb + qa);
+    cur_.mid_ticks = 0.5 * (double)(pb + pa);
+    cur_.microprice_ticks = sum1 > 0 ? ((double)pa * qb + (double)pb * qa) / sum1 : cur_.mid_ticks;
+    cur_.spread_ticks = pa - pb;
+    cur_.imbalance_l1 = sum1 > 0 ? (double)(qb - qa) / sum1 : 0.0;
+    const int64_t nb = book.CumSizeLevels(MIA_BOOK_BID, topN), na = book.CumSizeLevels(MIA_BOOK_ASK, topN);
+    cur_.imbalance_topn = (nb + na) > 0 ? (double)(nb - na) / (double)(nb + na) : 0.0;
+  }
+
+  // Valeurs courantes; TakeWindow() remet à zéro la partie fenêtre (OFI, compteur)
+  const MiaOfFeatures& Current() const { return cur_; }
+  bool HasUpdates() const { return cur_.updates > 0; }
+  void TakeWindow() { cur_.ofi = 0; cur_.updates = 0; }
+
+  // Nouvelle session: cumul et référence du haut de carnet remis à zéro
+  void ResetSession() {
+    cur_ = MiaOfFeatures();
+    have_prev_ = false;
+  }
+
+ private:
+  MiaOfFeatures cur_;
+  bool have_prev_ = false;
+  int64_t pb_ = 0, qb_ = 0, pa_ = 0, qa_ = 0;
+};
@@ -0,0 +1,130 @@
+#pragma once
+// ========== QUANTILES EN FLUX (P² ÉTENDU) ==========
+// Moteur C++ pur: estimation en ligne de la distribution des tailles de
+// trades par l'algorithme P² (Jain & Chlamtac) généralisé à plusieurs
+// marqueurs de probabilités arbitraires. Chaque marqueur suit la hauteur
+// d'un quantile; un print les ajuste par interpolation parabolique.
+// Mémoire constante (kMaxMarkers), O(kMaxMarkers) par observation.
+//  - Quantile(p): hauteur interpolée entre les marqueurs encadrant p;
+//  - Percentile(x): fraction estimée des observations <= x (0..1).
+// Pendant l'amorçage (moins d'observations que de marqueurs), les valeurs
+// exactes sont conservées triées.
+
+#include <stdint.h>
+#include <algorithm>
+
+class MiaP2Quantiles {
+ public:
+  enum { kMaxMarkers = 16 };
+
+  MiaP2Quantiles() {
+    static const double kDefault[] = {0.0, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 1.0};
+    SetProbs(kDefault, sizeof(kDefault) / sizeof(kDefault[0]));
+  }
+
+  // Probabilités des marqueurs (0 et 1 ajoutés, triées, dédoublonnées); vide l'état
+  void SetProbs(const double* probs, int n) {
+    m_ = 0;
+    q_[m_++] = 0.0;
+    double tmp[kMaxMarkers];
+    int k = 0;
+    for (int i = 0; i < n && k < kMaxMarkers - 2; ++i) {
+      if (probs[i] > 0.0 && probs[i] < 1.0) tmp[k++] = probs[i];
+    }
+    std::sort(tmp, tmp + k);
+    for (int i = 0; i < k; ++i) {
+      if (tmp[i] - q_[m_ - 1] > 1e-9) q_[m_++] = tmp[i];
+    }
+    q_[m_++] = 1.0;
+    Reset();
+  }
+
+  void Reset() { count_ = 0; }
+
+  uint64_t Count() const { return count_; }
+
+  void Add(double x) {
+    if (count_ < (uint64_t)m_) {
+      // Amorçage: insertion triée
+      int i = (int)count_;
+      while (i > 0 && h_[i - 1] > x) { h_[i] = h_[i - 1]; --i; }
+      h_[i] = x;
+      if (++count_ == (uint64_t)m_) {
+        for (int j = 0; j < m_; ++j) {
+          n_[j] = j + 1;
+          d_[j] = 1.0 + (m_ - 1) * q_[j];
+        }
+      }
+      return;
+    }
+
+    int k;
+    if (x < h_[0]) { h_[0] = x; k = 0; }
+    else if (x >= h_[m_ - 1]) { h_[m_ - 1] = x; k = m_ - 2; }
+    else { k = 0; while (x >= h_[k + 1]) ++k; }
+
+    for (int i = k + 1; i < m_; ++i) n_[i]++;
+    for (int i = 0; i < m_; ++i) d_[i] += q_[i];
+    ++count_;
+
+    for (int i = 1; i < m_ - 1; ++i) {
+      const double dd = d_[i] - (double)n_[i];
+      if ((dd >= 1.0 && n_[i + 1] - n_[i] > 1) || (dd <= -1.0 && n_[i - 1] - n_[i] < -1)) {
+        const int s = dd > 0 ? 1 : -1;
+        const double hp = Parabolic(i, s);
+        h_[i] = (h_[i - 1] < hp && hp < h_[i + 1]) ? hp : Linear(i, s);
+        n_[i] += s;
+      }
+    }
+  }
+
+  // Hauteur estimée du quantile p (0..1); 0 sans observation
+  double Quantile(double p) const {
+    if (count_ == 0) return 0.0;
+    if (count_ < (uint64_t)m_) {
+      const double pos = p * (double)(count_ - 1);
+      const int i = (int)pos;
+      return i + 1 < (int)count_ ? h_[i] + (pos - i) * (h_[i + 1] - h_[i]) : h_[count_ - 1];
+    }
+    int i = 0;
+    while (i < m_ - 2 && q_[i + 1] < p) ++i;
+    const double w = (p - q_[i]) / (q_[i + 1] - q_[i]);
+    return h_[i] + w * (h_[i + 1] - h_[i]);
+  }
+
+  // Fraction estimée des observations <= x (0..1); -1 sans observation
+  double Percentile(double x) const {
+    if (count_ == 0) return -1.0;
+    if (count_ < (uint64_t)m_) {
+      int le = 0;
+      while (le < (int)count_ && h_[le] <= x) ++le;
+      return (double)le / (double)count_;
+    }
+    if (x < h_[0]) return 0.0;
+    if (x >= h_[m_ - 1]) return 1.0;
+    // Plus haut marqueur <= x (les tailles discrètes donnent des paliers)
+    int i = m_ - 2;
+    while (i > 0 && h_[i] > x) --i;
+    const double span = h_[i + 1] - h_[i];
+    return span > 0 ? q_[i] + (x - h_[i]) / span * (q_[i + 1] - q_[i]) : q_[i + 1];
+  }
+
+ private:
+  double Parabolic(int i, int s) const {
+    const double ni = (double)n_[i], np = (double)n_[i + 1], nm = (double)n_[i - 1];
+    return h_[i] + s / (np - nm) *
+                       ((ni - nm + s) * (h_[i + 1] - h_[i]) / (np - ni) +
+                        (np - ni - s) * (h_[i] - h_[i - 1]) / (ni - nm));
+  }
+
+  double Linear(int i, int s) const {
+    return h_[i] + s * (h_[i + s] - h_[i]) / (double)(n_[i + s] - n_[i]);
+  }
+
+  double q_[kMaxMarkers];   // probabilités des marqueurs
+  double h_[kMaxMarkers];   // hauteurs
+  int64_t n_[kMaxMarkers];  // positions réelles (1-based)
+  double d_[kMaxMarkers];   // positions désirées
+  int m_ = 0;
+  uint64_t count_ = 0;
+};
@@ -0,0 +1,90 @@
+#pragma once
+// ========== AGRÉGATION MULTI-UNITÉS DE TEMPS (5 / 15 / 30 / 60 min) ==========
+// Moteur C++ pur: les bars de base clos (1 min) sont cumulés dans un bar
+// courant par unité de temps (OHLC, volume, volume bid/ask, delta, VWAP
+// pondéré par (H+L+C)/3). Les bars sont alignés sur minuit (index de minute
+// du jour multiple de N). Un bar supérieur est clos dès que son dernier bar
+// de base est reçu, ou dès qu'un bar de base tombe dans un autre intervalle
+// (trou de données). O(nombre d'unités) par bar de base, sans allocation.
+
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+struct MiaRollupBar {
+  int minutes = 0;        // unité de temps
+  int64_t start_min = 0;  // index de minute (SCDateTime * 1440) de l'ouverture
+  double open = 0, high = 0, low = 0, close = 0;
+  double vol = 0, bid_vol = 0, ask_vol = 0;
+  double pv = 0;          // somme prix typique * volume
+  int bars = 0;           // bars de base agrégés
+
+  double Delta() const { return ask_vol - bid_vol; }
+  double Vwap() const { return vol > 0 ? pv / vol : close; }
+  double StartDateTime() const { return (double)start_min / 1440.0; }
+};
+
+class MiaBarRollup {
+ public:
+  enum { kMaxFrames = 8 };
+
+  // Unités de temps en minutes, multiples de la base
+  void Init(const int* minutes, int n, int baseMinutes) {
+    n_ = 0;
+    base_ = baseMinutes > 0 ? baseMinutes : 1;
+    for (int k = 0; k < n && n_ < kMaxFrames; ++k) {
+      if (minutes[k] > 0) cur_[n_++].minutes = minutes[k];
+    }
+    Reset();
+  }
+
+  void Reset() {
+    for (int k = 0; k < n_; ++k) {
+      const int m = cur_[k].minutes;
+      cur_[k] = MiaRollupBar();
+      cur_[k].minutes = m;
+    }
+  }
+
+  // Bar de base clos ouvert à 't' (SCDateTime); les bars supérieurs clos sont
+  // ajoutés à 'closed' (non vidé)
+  void OnBar(double t, double o, double h, double l, double c, double v, double bidVol, double askVol,
+             std::vector<MiaRollupBar>& closed) {
+    const int64_t minute = (int64_t)llround(t * 1440.0);
+    const double typical = (h + l + c) / 3.0;
+    for (int k = 0; k < n_; ++k) {
+      MiaRollupBar& b = cur_[k];
+      const int64_t start = FloorDiv(minute, b.minutes) * b.minutes;
+      if (b.bars > 0 && b.start_min != start) Close(b, closed);  // trou: intervalle précédent incomplet
+      if (b.bars == 0) {
+        b.start_min = start;
+        b.open = o; b.high = h; b.low = l;
+      } else {
+        if (h > b.high) b.high = h;
+        if (l < b.low) b.low = l;
+      }
+      b.close = c;
+      b.vol += v; b.bid_vol += bidVol; b.ask_vol += askVol;
+      b.pv += typical * v;
+      b.bars++;
+      if (minute + base_ >= start + b.minutes) Close(b, closed);
+    }
+  }
+
+  int Frames() const { return n_; }
+  const MiaRollupBar& Current(int k) const { return cur_[k]; }
+
+ private:
+  static int64_t FloorDiv(int64_t a, int64_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+  static void Close(MiaRollupBar& b, std::vector<MiaRollupBar>& closed) {
+    closed.push_back(b);
+    const int m = b.minutes;
+    b = MiaRollupBar();
+    b.minutes = m;
+  }
+
+  MiaRollupBar cur_[kMaxFrames];
+  int n_ = 0;
+  int base_ = 1;
+};
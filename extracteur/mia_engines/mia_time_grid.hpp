@@ -0,0 +1,153 @@
+#pragma once
+// ========== GRILLE TEMPORELLE À PAS FIXE (RÉÉCHANTILLONNAGE FEATURES) ==========
+// Moteur C++ pur: les événements irréguliers (trades, BBO, valeurs d'études,
+// niveaux MenthorQ) mettent à jour un vecteur de colonnes; à chaque point de
+// grille franchi (pas de N ms, aligné sur minuit), une ligne est produite
+// avec la dernière valeur connue de chaque colonne (forward-fill). Une ligne
+// au temps g contient les événements de temps <= g.
+//
+// Une passe, mémoire constante: un vecteur de colonnes + les compteurs de la
+// cellule en cours (volume et nombre de trades, non reportés). Les trous plus
+// longs que max_fill_ms ne sont pas remplis: la grille reprend au point
+// suivant l'événement (pas de millions de lignes sur une coupure de nuit).
+//
+// Advance() n'est appelé qu'avec des temps d'événements marché (trade,
+// quote); Set() applique une valeur "connue maintenant" sans avancer la
+// grille, ce qui évite de mélanger horloge système et horodatage bourse.
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+enum MiaGridColumn {
+  MIA_GRID_LAST_PX = 0,
+  MIA_GRID_LAST_VOL,
+  MIA_GRID_BID,
+  MIA_GRID_ASK,
+  MIA_GRID_BID_QTY,
+  MIA_GRID_ASK_QTY,
+  MIA_GRID_VWAP,
+  MIA_GRID_VAH,
+  MIA_GRID_VAL,
+  MIA_GRID_VPOC,
+  MIA_GRID_NBCV_DELTA,
+  MIA_GRID_NBCV_CUM,
+  MIA_GRID_VIX,
+  MIA_GRID_CALL_RESISTANCE,
+  MIA_GRID_PUT_SUPPORT,
+  MIA_GRID_HVL,
+  MIA_GRID_1D_MIN,
+  MIA_GRID_1D_MAX,
+  MIA_GRID_CALL_RESISTANCE_0DTE,
+  MIA_GRID_PUT_SUPPORT_0DTE,
+  MIA_GRID_HVL_0DTE,
+  MIA_GRID_GAMMA_WALL_0DTE,
+  MIA_GRID_COLUMNS
+};
+
+static const char* const kMiaGridColumnNames[MIA_GRID_COLUMNS] = {
+    "last_px", "last_vol", "bid", "ask", "bid_qty", "ask_qty", "vwap", "vah", "val", "vpoc",
+    "nbcv_delta", "nbcv_cum", "vix", "call_resistance", "put_support", "hvl", "1d_min", "1d_max",
+    "call_resistance_0dte", "put_support_0dte", "hvl_0dte", "gamma_wall_0dte"};
+
+// Colonne d'un level_type MenthorQ ("hvl", "put_support_0dte"...), -1 sinon
+static inline int MiaGridColumnForLevel(const char* levelType) {
+  for (int c = MIA_GRID_CALL_RESISTANCE; c < MIA_GRID_COLUMNS; ++c) {
+    if (strcmp(kMiaGridColumnNames[c], levelType) == 0) return c;
+  }
+  return -1;
+}
+
+struct MiaGridRow {
+  int64_t ms = 0;              // point de grille (ms depuis l'époque SCDateTime)
+  double v[MIA_GRID_COLUMNS];  // dernières valeurs (valides si bit de 'have')
+  uint32_t have = 0;           // bit c = colonne c déjà renseignée
+  double cell_vol = 0;         // volume échangé dans ]g - pas, g]
+  uint32_t cell_trades = 0;
+
+  double DateTime() const { return (double)ms / 86400000.0; }
+  bool Has(int c) const { return (have >> c) & 1u; }
+};
+
+class MiaTimeGrid {
+ public:
+  void Configure(int stepMs, int maxFillMs) {
+    step_ = stepMs > 0 ? stepMs : 1000;
+    max_fill_ = maxFillMs > step_ ? maxFillMs : step_;
+    Reset();
+  }
+
+  void Reset() {
+    row_ = MiaGridRow();
+    for (int c = 0; c < MIA_GRID_COLUMNS; ++c) row_.v[c] = 0.0;
+    next_ = -1;
+  }
+
+  int StepMs() const { return step_; }
+
+  // Produit les points de grille strictement antérieurs à 't' (SCDateTime);
+  // les lignes sont ajoutées à 'rows' (non vidé)
+  void Advance(double t, std::vector<MiaGridRow>& rows) {
+    const int64_t ms = ToMs(t);
+    if (next_ < 0) {
+      next_ = Ceil(ms);
+      return;
+    }
+    if (ms <= next_) return;
+    if (ms - next_ > max_fill_) {
+      // Trou trop long: une ligne pour le point en attente, puis reprise
+      Emit(next_, rows);
+      next_ = Ceil(ms);
+      return;
+    }
+    while (next_ < ms) {
+      Emit(next_, rows);
+      next_ += step_;
+    }
+  }
+
+  // Valeur connue à partir de maintenant (sans avancer la grille)
+  void Set(int col, double value) {
+    if (col < 0 || col >= MIA_GRID_COLUMNS || !isfinite(value)) return;
+    row_.v[col] = value;
+    row_.have |= 1u << col;
+  }
+
+  // Source disparue (niveau retiré): colonne vide jusqu'à la prochaine valeur
+  void Clear(int col) {
+    if (col >= 0 && col < MIA_GRID_COLUMNS) row_.have &= ~(1u << col);
+  }
+
+  void AddTrade(double t, double px, double vol, std::vector<MiaGridRow>& rows) {
+    Advance(t, rows);
+    Set(MIA_GRID_LAST_PX, px);
+    Set(MIA_GRID_LAST_VOL, vol);
+    row_.cell_vol += vol;
+    row_.cell_trades++;
+  }
+
+  void SetQuote(double t, double bid, double ask, double bidQty, double askQty, std::vector<MiaGridRow>& rows) {
+    Advance(t, rows);
+    Set(MIA_GRID_BID, bid);
+    Set(MIA_GRID_ASK, ask);
+    Set(MIA_GRID_BID_QTY, bidQty);
+    Set(MIA_GRID_ASK_QTY, askQty);
+  }
+
+ private:
+  static int64_t ToMs(double t) { return (int64_t)llround(t * 86400000.0); }
+  int64_t Ceil(int64_t ms) const { return ((ms + step_ - 1) / step_) * step_; }
+
+  void Emit(int64_t g, std::vector<MiaGridRow>& rows) {
+    row_.ms = g;
+    rows.push_back(row_);
+    row_.cell_vol = 0;
+    row_.cell_trades = 0;
+  }
+
+  MiaGridRow row_;
+  int64_t next_ = -1;  // prochain point de grille à produire (ms)
+  int step_ = 1000;
+  int max_fill_ = 300000;
+};
@@ -0,0 +1,88 @@
+#pragma once
+// ========== BARS TICK / VOLUME / RANGE DEPUIS LE T&S ==========
+// Moteur C++ pur: un constructeur par type de bar, alimenté par les trades
+// classés (prix en ticks):
+//  - MIA_BARS_TICK:   bar clos après N trades;
+//  - MIA_BARS_VOLUME: bar clos dès que le volume cumulé atteint N (le trade
+//                     qui franchit le seuil reste entier dans le bar);
+//  - MIA_BARS_RANGE:  un trade qui porterait high - low au-delà de N ticks
+//                     clôt le bar courant et ouvre le suivant (pas de bars
+//                     fantômes sur les gaps).
+// Bar courant en place, bar clos copié dans 'done': aucune allocation.
+
+#include <stdint.h>
+
+enum MiaTradeBarKind { MIA_BARS_TICK = 0, MIA_BARS_VOLUME = 1, MIA_BARS_RANGE = 2 };
+
+struct MiaTradeBar {
+  uint64_t index = 0;          // numéro du bar (1-based)
+  double t_open = 0.0, t_close = 0.0;
+  int64_t open = 0, high = 0, low = 0, close = 0;  // ticks
+  uint64_t vol = 0, bid_vol = 0, ask_vol = 0;
+  uint32_t trades = 0;
+
+  int64_t Delta() const { return (int64_t)ask_vol - (int64_t)bid_vol; }
+};
+
+class MiaTradeBarBuilder {
+ public:
+  void Init(int kind, int64_t threshold) {
+    kind_ = kind;
+    threshold_ = threshold > 0 ? threshold : 1;
+    open_ = false;
+    count_ = 0;
+  }
+
+  int Kind() const { return kind_; }
+  int64_t Threshold() const { return threshold_; }
+
+  // side: +1 achat agresseur (ask), -1 vente (bid), 0 non classé.
+  // Retourne true si un bar est clos (copié dans 'done')
+  bool Add(double t, int side, int64_t ticks, uint32_t vol, MiaTradeBar& done) {
+    bool closed = false;
+    if (open_ && kind_ == MIA_BARS_RANGE) {
+      const int64_t hi = ticks > cur_.high ? ticks : cur_.high;
+      const int64_t lo = ticks < cur_.low ? ticks : cur_.low;
+      if (hi - lo > threshold_) {
+        done = cur_;
+        open_ = false;
+        closed = true;
+      }
+    }
+
+    if (!open_) {
+      cur_ = MiaTradeBar();
+      cur_.index = ++count_;
+      cur_.t_open = t;
+      cur_.open = cur_.high = cur_.low = ticks;
+      open_ = true;
+    }
+    if (ticks > cur_.high) cur_.high = ticks;
+    if (ticks < cur_.low) cur_.low = ticks;
+    cur_.close = ticks;
+    cur_.t_close = t;
+    cur_.vol += vol;
+    if (side > 0) cur_.ask_vol += vol;
+    else if (side < 0) cur_.bid_vol += vol;
+    cur_.trades++;
+
+    const bool full = (kind_ == MIA_BARS_TICK && (int64_t)cur_.trades >= threshold_) ||
+                      (kind_ == MIA_BARS_VOLUME && (int64_t)cur_.vol >= threshold_);
+    if (full) {
+      done = cur_;
+      open_ = false;
+      closed = true;
+    }
+    return closed;
+  }
+
+  bool HasOpenBar() const { return open_; }
+  const MiaTradeBar& Current() const { return cur_; }
+
+ private:
+  MiaTradeBar cur_;
+  int kind_ = MIA_BARS_TICK;
+  int64_t threshold_ = 1;
+  uint64_t count_ = 0;
+  bool open_ = false;
+};
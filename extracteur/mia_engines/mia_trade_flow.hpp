@@ -0,0 +1,124 @@
+#pragma once
+// ========== AGRÉGATS DE FLUX GLISSANTS (1 s / 10 s / 60 s / 5 min) ==========
+// Moteur C++ pur: nombre et volume BUY/SELL et delta sur fenêtres
+// glissantes, chacune découpée en un anneau de buckets de largeur fixe.
+// La somme de la fenêtre est tenue à jour: un print ajoute au bucket
+// courant, l'avance du temps retire les buckets expirés. O(1) par print,
+// au plus kBuckets buckets recyclés par avance, mémoire fixe.
+// Les temps sont des millisecondes de marché (SCDateTime * 86 400 000).
+
+#include <stdint.h>
+
+struct MiaFlowAgg {
+  uint64_t buy_trades = 0;
+  uint64_t sell_trades = 0;
+  uint64_t buy_vol = 0;
+  uint64_t sell_vol = 0;
+
+  int64_t Delta() const { return (int64_t)buy_vol - (int64_t)sell_vol; }
+
+  void Add(int side, uint64_t vol) {
+    if (side > 0) { buy_trades++; buy_vol += vol; }
+    else if (side < 0) { sell_trades++; sell_vol += vol; }
+  }
+
+  void Sub(const MiaFlowAgg& o) {
+    buy_trades -= o.buy_trades;
+    sell_trades -= o.sell_trades;
+    buy_vol -= o.buy_vol;
+    sell_vol -= o.sell_vol;
+  }
+};
+
+class MiaRollingFlow {
+ public:
+  enum { kBuckets = 20 };
+
+  void Init(int64_t windowMs) {
+    width_ms_ = windowMs / kBuckets > 0 ? windowMs / kBuckets : 1;
+    Reset();
+  }
+
+  void Reset() {
+    for (MiaFlowAgg& b : ring_) b = MiaFlowAgg();
+    sum_ = MiaFlowAgg();
+    head_ = -1;
+  }
+
+  // Avance jusqu'à 'ms' (les temps antérieurs au bucket courant sont ignorés)
+  void Advance(int64_t ms) {
+    const int64_t idx = ms / width_ms_;
+    if (head_ < 0) { head_ = idx; return; }
+    if (idx <= head_) return;
+    if (idx - head_ >= kBuckets) {
+      Reset();
+      head_ = idx;
+      return;
+    }
+    while (head_ < idx) {
+      ++head_;
+      MiaFlowAgg& b = ring_[head_ % kBuckets];
+      sum_.Sub(b);
+      b = MiaFlowAgg();
+    }
+  }
+
+  void Add(int64_t ms, int side, uint64_t vol) {
+    Advance(ms);
+    ring_[head_ % kBuckets].Add(side, vol);
+    sum_.Add(side, vol);
+  }
+
+  const MiaFlowAgg& Sum() const { return sum_; }
+
+ private:
+  MiaFlowAgg ring_[kBuckets];
+  MiaFlowAgg sum_;
+  int64_t width_ms_ = 1;
+  int64_t head_ = -1;  // index absolu du bucket courant
+};
+
+class MiaTradeFlowWindows {
+ public:
+  enum { kW1s = 0, kW10s, kW60s, kW5m, kCount };
+
+  static int64_t WindowMs(int w) {
+    static const int64_t ms[kCount] = {1000, 10000, 60000, 300000};
+    return ms[w];
+  }
+  static const char* WindowName(int w) {
+    static const char* names[kCount] = {"1s", "10s", "60s", "5m"};
+    return names[w];
+  }
+
+  MiaTradeFlowWindows() {
+    for (int w = 0; w < kCount; ++w) win_[w].Init(WindowMs(w));
+  }
+
+  void Add(int64_t ms, int side, uint64_t vol) {
+    if (ms > last_ms_) last_ms_ = ms;
+    for (int w = 0; w < kCount; ++w) win_[w].Add(last_ms_, side, vol);
+    session_.Add(side, vol);
+  }
+
+  // Fait glisser les fenêtres sans nouveau print (temps monotone)
+  void Advance(int64_t ms) {
+    if (ms > last_ms_) last_ms_ = ms;
+    for (int w = 0; w < kCount; ++w) win_[w].Advance(last_ms_);
+  }
+
+  // Nouvelle session: fenêtres et cumul remis à zéro
+  void ResetSession() {
+    for (int w = 0; w < kCount; ++w) win_[w].Reset();
+    session_ = MiaFlowAgg();
+    last_ms_ = 0;
+  }
+
+  const MiaFlowAgg& Window(int w) const { return win_[w].Sum(); }
+  const MiaFlowAgg& Session() const { return session_; }
+
+ private:
+  MiaRollingFlow win_[kCount];
+  MiaFlowAgg session_;
+  int64_t last_ms_ = 0;
+};
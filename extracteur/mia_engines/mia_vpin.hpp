@@ -0,0 +1,91 @@
+#pragma once
+// ========== VPIN (TOXICITÉ DU FLUX SUR BUCKETS DE VOLUME) ==========
+// Moteur C++ pur (Easley, López de Prado & O'Hara): les trades classés
+// remplissent des buckets de volume égal V; un print plus gros que le reste
+// du bucket déborde sur les suivants. À chaque bucket complet, |achats -
+// ventes| entre dans un anneau des n derniers buckets dont la somme est
+// tenue à jour:
+//   VPIN = somme(|B - S|) / (n * V)
+// Prints non classés: répartis moitié/moitié. O(1) par print (hors
+// débordement), mémoire bornée par n.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct MiaVpinBucket {
+  uint64_t index = 0;     // numéro du bucket dans la session (1-based)
+  double imbalance = 0;   // |B - S| du bucket
+  double vpin = 0;        // sur les min(n, index) derniers buckets
+  uint32_t window = 0;    // buckets effectivement dans la fenêtre
+  double first_t = 0;     // premier print du bucket
+  double t = 0;           // print qui l'a complété
+};
+
+class MiaVpin {
+ public:
+  void Configure(double bucketVolume, int windowBuckets) {
+    bucket_vol_ = bucketVolume > 0 ? bucketVolume : 1.0;
+    ring_.assign(windowBuckets > 0 ? windowBuckets : 1, 0.0);
+    Reset();
+  }
+
+  void Reset() {
+    for (double& v : ring_) v = 0.0;
+    sum_ = 0.0;
+    buy_ = sell_ = 0.0;
+    filled_ = 0;
+    count_ = 0;
+    first_t_ = 0.0;
+  }
+
+  // side: +1 achat agresseur, -1 vente, 0 non classé. Les buckets complétés
+  // par ce print sont ajoutés à 'done' (vidé au préalable)
+  void Add(double t, int side, double vol, std::vector<MiaVpinBucket>& done) {
+    done.clear();
+    if (ring_.empty() || vol <= 0) return;
+    while (vol > 0) {
+      if (buy_ + sell_ == 0.0) first_t_ = t;
+      const double room = bucket_vol_ - (buy_ + sell_);
+      const double part = vol < room ? vol : room;
+      if (side > 0) buy_ += part;
+      else if (side < 0) sell_ += part;
+      else { buy_ += part * 0.5; sell_ += part * 0.5; }
+      vol -= part;
+      if (buy_ + sell_ >= bucket_vol_ - 1e-9) done.push_back(CloseBucket(t));
+    }
+  }
+
+  double Current() const { return count_ ? sum_ / ((double)filled_ * bucket_vol_) : 0.0; }
+  uint64_t Buckets() const { return count_; }
+  double BucketVolume() const { return bucket_vol_; }
+  int WindowBuckets() const { return (int)ring_.size(); }
+
+ private:
+  MiaVpinBucket CloseBucket(double t) {
+    const double imb = buy_ > sell_ ? buy_ - sell_ : sell_ - buy_;
+    double& slot = ring_[count_ % ring_.size()];
+    sum_ += imb - slot;
+    slot = imb;
+    ++count_;
+    if (filled_ < ring_.size()) ++filled_;
+
+    MiaVpinBucket b;
+    b.index = count_;
+    b.imbalance = imb;
+    b.vpin = Current();
+    b.window = (uint32_t)filled_;
+    b.first_t = first_t_;
+    b.t = t;
+    buy_ = sell_ = 0.0;
+    return b;
+  }
+
+  std::vector<double> ring_;  // |B - S| des n derniers buckets
+  double bucket_vol_ = 1.0;
+  double sum_ = 0.0;
+  double buy_ = 0.0, sell_ = 0.0;  // bucket en cours
+  size_t filled_ = 0;
+  uint64_t count_ = 0;
+  double first_t_ = 0.0;
+};
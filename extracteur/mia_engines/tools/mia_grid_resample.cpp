@@ -0,0 +1,212 @@
+// ========== RÉÉCHANTILLONNAGE HORS LIGNE DES FICHIERS QUOTIDIENS ==========
+// Fusionne en une passe les fichiers JSONL d'une journée (trade, quote,
+// vwap, vva, nbcv, vix, menthorq...) par horodatage et écrit la grille
+// forward-fill de MiaTimeGrid en CSV (une colonne par feature, vide tant
+// que la source n'a rien publié). Mémoire bornée: une ligne en attente par
+// fichier, lignes de grille écrites au fil de l'eau.
+//
+// Les flux horodatés au début du bar (vwap, vva, nbcv, vix, menthorq_level)
+// sont décalés de --bar-sec (60 par défaut): leur valeur n'est considérée
+// connue qu'à la clôture du bar, ce qui évite toute fuite d'information
+// dans la grille d'entraînement.
+//
+// Horloges: trade / quote portent l'heure T&S (UTC), les flux par bar
+// l'heure du chart (BaseDateTimeIn, fuseau du chart). --chart-tz-offset-sec
+// (TimeScaleAdjustment du chart en secondes, ex. -14400 pour New York en
+// heure d'été) ramène ces derniers en UTC avant la fusion.
+//
+// VIX: "vix" (fichier G3) ou "last" / "close" (fichier G8, modes close /
+// OHLC).
+//
+// Compilation (hors Sierra, depuis extracteur\):
+//   MSVC : cl /O2 /EHsc /std:c++17 /I. mia_engines\tools\mia_grid_resample.cpp
+//   GCC  : g++ -O2 -std=c++17 -I. mia_engines/tools/mia_grid_resample.cpp -o mia_grid_resample
+//
+// Usage:
+//   mia_grid_resample --step-ms 250 --chart-tz-offset-sec -14400 --out grid_20250918.csv
+//       chart_3_trade_20250918.jsonl chart_3_quote_20250918.jsonl
+//       chart_3_vwap_20250918.jsonl chart_3_vva_20250918.jsonl ...
+//       chart_10_menthorq_20250918.jsonl
+
+#include "mia_engines/mia_time_grid.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Lecture d'une ligne complète (longueur quelconque); false en fin de fichier
+static bool ReadLine(FILE* f, std::string& line) {
+  line.clear();
+  char buf[4096];
+  while (fgets(buf, sizeof(buf), f)) {
+    line += buf;
+    if (!line.empty() && line.back() == '\n') return true;
+  }
+  return !line.empty();
+}
+
+static bool FindKey(const std::string& line, const char* key, size_t& pos) {
+  std::string k = "\"";
+  k += key;
+  k += "\":";
+  pos = line.find(k);
+  if (pos == std::string::npos) return false;
+  pos += k.size();
+  return true;
+}
+
+static bool Number(const std::string& line, const char* key, double& out) {
+  size_t pos;
+  if (!FindKey(line, key, pos)) return false;
+  char* end = NULL;
+  out = strtod(line.c_str() + pos, &end);
+  return end != line.c_str() + pos;
+}
+
+static bool String(const std::string& line, const char* key, std::string& out) {
+  size_t pos;
+  if (!FindKey(line, key, pos) || pos >= line.size() || line[pos] != '"') return false;
+  const size_t e = line.find('"', pos + 1);
+  if (e == std::string::npos) return false;
+  out.assign(line, pos + 1, e - pos - 1);
+  return true;
+}
+
+// Flux dont "t" est l'ouverture du bar (valeur connue à sa clôture)
+static bool IsBarStamped(const std::string& type) {
+  return type == "vwap" || type == "vva" || type == "nbcv" || type == "vix" || type == "menthorq_level" ||
+         type == "menthorq_level_removed";
+}
+
+struct Source {
+  FILE* f = NULL;
+  std::string line, type;
+  double t = 0.0;  // horodatage effectif (décalé pour les flux par bar)
+  bool ok = false;
+};
+
+// Avance jusqu'à la prochaine ligne horodatée (les headers sont ignorés);
+// 'barShiftDays' = clôture du bar moins fuseau du chart
+static void NextEvent(Source& s, double barShiftDays) {
+  s.ok = false;
+  while (ReadLine(s.f, s.line)) {
+    if (!Number(s.line, "t", s.t) || !String(s.line, "type", s.type)) continue;
+    if (IsBarStamped(s.type)) s.t += barShiftDays;
+    s.ok = true;
+    return;
+  }
+}
+
+static void Apply(MiaTimeGrid& grid, const Source& s, std::vector<MiaGridRow>& rows) {
+  const std::string& line = s.line;
+  double a, b, c, d;
+  grid.Advance(s.t, rows);
+  if (s.type == "trade") {
+    if (Number(line, "px", a) && Number(line, "vol", b)) grid.AddTrade(s.t, a, b, rows);
+  } else if (s.type == "quote") {
+    if (Number(line, "bid", a) && Number(line, "ask", b) && Number(line, "bq", c) && Number(line, "aq", d))
+      grid.SetQuote(s.t, a, b, c, d, rows);
+  } else if (s.type == "vwap") {
+    if (Number(line, "v", a)) grid.Set(MIA_GRID_VWAP, a);
+  } else if (s.type == "vva") {
+    if (Number(line, "vah", a)) grid.Set(MIA_GRID_VAH, a);
+    if (Number(line, "val", a)) grid.Set(MIA_GRID_VAL, a);
+    if (Number(line, "vpoc", a)) grid.Set(MIA_GRID_VPOC, a);
+  } else if (s.type == "nbcv") {
+    if (Number(line, "delta", a)) grid.Set(MIA_GRID_NBCV_DELTA, a);
+    if (Number(line, "cumulative_delta", a)) grid.Set(MIA_GRID_NBCV_CUM, a);
+  } else if (s.type == "vix") {
+    if (Number(line, "vix", a) || Number(line, "last", a) || Number(line, "close", a)) grid.Set(MIA_GRID_VIX, a);
+  } else if (s.type == "menthorq_level") {
+    std::string level;
+    if (String(line, "level_type", level) && Number(line, "price", a)) grid.Set(MiaGridColumnForLevel(level.c_str()), a);
+  } else if (s.type == "menthorq_level_removed") {
+    std::string level;
+    if (String(line, "level_type", level)) grid.Clear(MiaGridColumnForLevel(level.c_str()));
+  }
+}
+
+static void WriteRows(FILE* out, std::vector<MiaGridRow>& rows) {
+  for (const MiaGridRow& r : rows) {
+    fprintf(out, "%.10f", r.DateTime());
+    for (int c = 0; c < MIA_GRID_COLUMNS; ++c) {
+      if (r.Has(c)) fprintf(out, ",%.8g", r.v[c]);
+      else fputs(",", out);
+    }
+    fprintf(out, ",%.0f,%u\n", r.cell_vol, r.cell_trades);
+  }
+  rows.clear();
+}
+
+static void Usage() {
+  fprintf(stderr,
+          "usage: mia_grid_resample [--step-ms N] [--max-fill-ms N] [--bar-sec N] [--chart-tz-offset-sec N]\n"
+          "                         --out grid.csv file.jsonl...\n");
+}
+
+int main(int argc, char** argv) {
+  int stepMs = 1000, maxFillMs = 300000, barSec = 60, tzOffsetSec = 0;
+  const char* outPath = NULL;
+  std::vector<Source> sources;
+
+  for (int a = 1; a < argc; ++a) {
+    const bool hasValue = a + 1 < argc;
+    if (!strcmp(argv[a], "--step-ms") && hasValue) stepMs = atoi(argv[++a]);
+    else if (!strcmp(argv[a], "--max-fill-ms") && hasValue) maxFillMs = atoi(argv[++a]);
+    else if (!strcmp(argv[a], "--bar-sec") && hasValue) barSec = atoi(argv[++a]);
+    else if (!strcmp(argv[a], "--chart-tz-offset-sec") && hasValue) tzOffsetSec = atoi(argv[++a]);
+    else if (!strcmp(argv[a], "--out") && hasValue) outPath = argv[++a];
+    else {
+      Source s;
+      s.f = fopen(argv[a], "rb");
+      if (!s.f) {
+        fprintf(stderr, "cannot open %s\n", argv[a]);
+        return 1;
+      }
+      sources.push_back(s);
+    }
+  }
+  if (!outPath || sources.empty() || stepMs <= 0) {
+    Usage();
+    return 2;
+  }
+  FILE* out = fopen(outPath, "wb");
+  if (!out) {
+    fprintf(stderr, "cannot create %s\n", outPath);
+    return 1;
+  }
+
+  const double barShiftDays = (barSec - tzOffsetSec) / 86400.0;
+  for (Source& s : sources) NextEvent(s, barShiftDays);
+
+  fputs("t", out);
+  for (int c = 0; c < MIA_GRID_COLUMNS; ++c) fprintf(out, ",%s", kMiaGridColumnNames[c]);
+  fputs(",cell_vol,cell_trades\n", out);
+
+  MiaTimeGrid grid;
+  grid.Configure(stepMs, maxFillMs);
+  std::vector<MiaGridRow> rows;
+  rows.reserve(1024);
+  unsigned long long events = 0;
+
+  // Fusion k voies: k petit (un fichier par flux), recherche linéaire du minimum
+  for (;;) {
+    Source* next = NULL;
+    for (Source& s : sources) {
+      if (s.ok && (!next || s.t < next->t)) next = &s;
+    }
+    if (!next) break;
+    Apply(grid, *next, rows);
+    if (rows.size() >= 1024) WriteRows(out, rows);
+    NextEvent(*next, barShiftDays);
+    ++events;
+  }
+  WriteRows(out, rows);
+
+  for (Source& s : sources) fclose(s.f);
+  fclose(out);
+  fprintf(stderr, "%llu events -> %s (step %d ms)\n", events, outPath, stepMs);
+  return 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+// ========== HORLOGE MONOTONE ==========
+// Millisecondes monotones pour les cadences d'émission (fenêtres de
+// conflation, snapshots): insensibles aux changements d'heure système.
+
+#include <stdint.h>
+#include <chrono>
+
+static inline int64_t MiaSteadyMs() {
+  return (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
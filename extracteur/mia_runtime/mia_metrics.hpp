@@ -0,0 +1,62 @@
+#pragma once
+// ========== MÉTRIQUES DES FLUX ==========
+// Compteurs lignes/octets par type de flux (quote, trade, depth, ...) pour
+// un chart, complétés par les statistiques du writer partagé. Publiés en
+// ligne JSON dans le flux "metrics" à cadence fixe.
+
+#include "mia_writer.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+
+struct MiaStreamCounters {
+  uint64_t lines = 0;
+  uint64_t bytes = 0;
+  uint64_t conflated = 0;  // états remplacés sous contre-pression
+  uint64_t shed = 0;       // lignes délestées
+};
+
+struct MiaStreamMetrics {
+  std::map<std::string, MiaStreamCounters> by_type;  // ordonné: sortie stable
+  time_t last_emit = 0;
+
+  // 'result' = MiaAppendResult retourné par le writer
+  void Count(const char* dataType, size_t bytes, int result) {
+    MiaStreamCounters& c = by_type[dataType];
+    if (result == MIA_APPEND_SHED) { c.shed++; return; }
+    if (result == MIA_APPEND_CONFLATED) c.conflated++;
+    c.lines++;
+    c.bytes += bytes;
+  }
+};
+
+// Ligne JSON de métriques: {"type":"metrics","chart":N,"streams":{...},"writer":{...}}
+static inline std::string MiaFormatMetricsLine(int chartNumber, double t, const MiaStreamMetrics& m,
+                                               const MiaWriterStats& ws) {
+  std::string out;
+  char buf[512];
+  snprintf(buf, sizeof(buf), "{\"t\":%.6f,\"type\":\"metrics\",\"chart\":%d,\"streams\":{", t, chartNumber);
+  out += buf;
+  bool first = true;
+  for (const auto& kv : m.by_type) {
+    snprintf(buf, sizeof(buf), "%s\"%s\":{\"lines\":%llu,\"bytes\":%llu,\"conflated\":%llu,\"shed\":%llu}",
+             first ? "" : ",", kv.first.c_str(), (unsigned long long)kv.second.lines,
+             (unsigned long long)kv.second.bytes, (unsigned long long)kv.second.conflated,
+             (unsigned long long)kv.second.shed);
+    out += buf;
+    first = false;
+  }
+  snprintf(buf, sizeof(buf),
+           "},\"writer\":{\"lines\":%llu,\"bytes_queued\":%llu,\"bytes_written\":%llu,\"batches\":%llu,"
+           "\"errors\":%llu,\"pending\":%llu,\"max_pending\":%llu,\"conflated\":%llu,\"shed\":%llu,"
+           "\"open_files\":%u}}",
+           (unsigned long long)ws.lines_queued, (unsigned long long)ws.bytes_queued,
+           (unsigned long long)ws.bytes_written, (unsigned long long)ws.batches,
+           (unsigned long long)ws.write_errors, (unsigned long long)ws.pending_bytes,
+           (unsigned long long)ws.max_pending_bytes, (unsigned long long)ws.lines_conflated,
+           (unsigned long long)ws.lines_shed, ws.open_files);
+  out += buf;
+  return out;
+}
@@ -0,0 +1,78 @@
+#pragma once
+// ========== RÉSOLUTION DES CHEMINS DE SORTIE ==========
+// Nommage des fichiers quotidiens partagé par tous les dumpers.
+// Deux dispositions coexistent (les consommateurs Python dépendent des deux):
+//  - ORGANIZED : <base>\DATA_SIERRA_CHART\DATA_<y>\<MOIS>\<yyyymmdd>\CHART_<n>\chart_<n>_<type>_<yyyymmdd>.jsonl (G3, G10)
+//    (extension .bin pour les flux binaires, ex. depthbars)
+//  - FLAT      : <base>\chart_<n>_<type>_<yyyymmdd>.jsonl (G4, G8)
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <sys/stat.h>
+#endif
+#include <time.h>
+#include <stdio.h>
+#include <string>
+
+#define MIA_DEFAULT_BASE_DIR "D:\\MIA_IA_system"
+
+enum MiaPathLayout {
+  MIA_LAYOUT_FLAT = 0,
+  MIA_LAYOUT_ORGANIZED = 1
+};
+
+struct MiaDate {
+  int y = 1970, m = 1, d = 1;
+  int AsInt() const { return y * 10000 + m * 100 + d; }
+};
+
+// Date locale courante (les fichiers sont découpés par jour calendaire local)
+static inline MiaDate MiaToday() {
+  MiaDate out;
+  time_t now = time(NULL);
+  struct tm* lt = localtime(&now);
+  if (lt) { out.y = lt->tm_year + 1900; out.m = lt->tm_mon + 1; out.d = lt->tm_mday; }
+  return out;
+}
+
+static inline const char* MiaMonthName(int m) {
+  static const char* monthNames[] = {"JANVIER", "FEVRIER", "MARS", "AVRIL", "MAI", "JUIN",
+                                     "JUILLET", "AOUT", "SEPTEMBRE", "OCTOBRE", "NOVEMBRE", "DECEMBRE"};
+  return (m >= 1 && m <= 12) ? monthNames[m - 1] : monthNames[0];
+}
+
+// Chemin du fichier quotidien pour (chart, type) selon la disposition
+// ('ext' = "jsonl" pour les flux texte, "bin" pour les flux binaires)
+static inline std::string MiaDailyPath(MiaPathLayout layout, const char* baseDir, int chartNumber,
+                                       const char* dataType, const MiaDate& dt, const char* ext = "jsonl") {
+  char buf[512];
+  if (layout == MIA_LAYOUT_ORGANIZED) {
+    snprintf(buf, sizeof(buf), "%s\\DATA_SIERRA_CHART\\DATA_%d\\%s\\%04d%02d%02d\\CHART_%d\\chart_%d_%s_%04d%02d%02d.%s",
+             baseDir, dt.y, MiaMonthName(dt.m), dt.y, dt.m, dt.d, chartNumber, chartNumber, dataType, dt.y, dt.m, dt.d, ext);
+  } else {
+    snprintf(buf, sizeof(buf), "%s\\chart_%d_%s_%04d%02d%02d.%s",
+             baseDir, chartNumber, dataType, dt.y, dt.m, dt.d, ext);
+  }
+  return std::string(buf);
+}
+
+// Fichier d'état (checkpoints) : <base>\DATA_SIERRA_CHART\STATE\<name>
+static inline std::string MiaStatePath(const char* baseDir, const char* name) {
+  char buf[512];
+  snprintf(buf, sizeof(buf), "%s\\DATA_SIERRA_CHART\\STATE\\%s", baseDir, name);
+  return std::string(buf);
+}
+
+// Crée tous les répertoires parents d'un fichier (équivalent mkdir -p)
+static inline void MiaEnsureDirsForFile(const std::string& path) {
+  for (size_t pos = path.find_first_of("\\/", 3); pos != std::string::npos;
+       pos = path.find_first_of("\\/", pos + 1)) {
+    const std::string dir = path.substr(0, pos);
+#ifdef _WIN32
+    CreateDirectoryA(dir.c_str(), NULL);
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+  }
+}
@@ -0,0 +1,42 @@
+#pragma once
+// ========== NORMALISATION DES PRIX ==========
+// Même règle pour tous les dumpers: un prix brut Sierra (éventuellement
+// multiplié, certains flux arrivent x100) est ramené à l'échelle du
+// contrat puis arrondi au tick.
+
+#include "sierrachart.h"
+#include <cmath>
+
+inline double NormalizePx(const SCStudyInterfaceRef& sc, double raw)
+{
+  // 1) Dé-multiplier si besoin
+  const double mult = (sc.RealTimePriceMultiplier != 0.0 ? sc.RealTimePriceMultiplier : 1.0);
+  double px = raw / mult;
+
+  // 2) Correction d'échelle avant arrondi (certains flux arrivent x100)
+  if (px > 10000.0) px /= 100.0;
+
+  // 3) Arrondi au tick
+  px = sc.RoundToTickSize(px, sc.TickSize);
+
+  // 4) Correction d'échelle résiduelle puis arrondi final (sécurité)
+  if (px > 10000.0) px /= 100.0;
+  px = sc.RoundToTickSize(px, sc.TickSize);
+  return px;
+}
+
+// Conversion prix <-> ticks entiers (clés de niveaux sans erreur d'arrondi)
+static inline long long MiaPriceToTicks(double px, double tickSize) {
+  return tickSize > 0.0 ? (long long)std::llround(px / tickSize) : 0;
+}
+
+static inline double MiaTicksToPrice(long long ticks, double tickSize) {
+  return (double)ticks * tickSize;
+}
+
+// Taille du tick en double "propre": sc.TickSize est un float (0.01f ->
+// 0.0099999998), arrondi à 10 décimales pour que ticks * tick retombe sur
+// le prix affiché
+static inline double MiaTickSize(const SCStudyInterfaceRef& sc) {
+  return std::round((double)sc.TickSize * 1e10) / 1e10;
+}
@@ -0,0 +1,89 @@
+#pragma once
+// ========== SÉRIALISATION BINAIRE ==========
+// Encodage binaire compact (checkpoints d'état, fichiers d'index).
+// Les structs POD sont sérialisées avec leur taille: une taille différente
+// (nouvelle version de la struct) invalide la lecture au lieu de la corrompre.
+
+#include "mia_paths.hpp"
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+
+struct MiaBinWriter {
+  std::string buf;
+  void Raw(const void* p, size_t n) { buf.append((const char*)p, n); }
+  void U32(uint32_t v) { Raw(&v, sizeof v); }
+  void I32(int32_t v)  { Raw(&v, sizeof v); }
+  void I64(int64_t v)  { Raw(&v, sizeof v); }
+  void F64(double v)   { Raw(&v, sizeof v); }
+  void Str(const std::string& s) { U32((uint32_t)s.size()); Raw(s.data(), s.size()); }
+};
+
+struct MiaBinReader {
+  const char* p;
+  const char* end;
+  bool ok = true;
+  bool Raw(void* out, size_t n) {
+    if (!ok || (size_t)(end - p) < n) { ok = false; return false; }
+    memcpy(out, p, n); p += n; return true;
+  }
+  uint32_t U32() { uint32_t v = 0; Raw(&v, sizeof v); return v; }
+  int32_t  I32() { int32_t v = 0;  Raw(&v, sizeof v); return v; }
+  int64_t  I64() { int64_t v = 0;  Raw(&v, sizeof v); return v; }
+  double   F64() { double v = 0.0; Raw(&v, sizeof v); return v; }
+  std::string Str() {
+    uint32_t n = U32();
+    if (!ok || (size_t)(end - p) < n) { ok = false; return std::string(); }
+    std::string s(p, n); p += n; return s;
+  }
+};
+
+template <typename T>
+static void MiaPutMap(MiaBinWriter& w, const std::unordered_map<std::string, T>& m) {
+  w.U32((uint32_t)sizeof(T));
+  w.U32((uint32_t)m.size());
+  for (const auto& kv : m) { w.Str(kv.first); w.Raw(&kv.second, sizeof(T)); }
+}
+
+template <typename T>
+static bool MiaGetMap(MiaBinReader& r, std::unordered_map<std::string, T>& m) {
+  if (r.U32() != (uint32_t)sizeof(T)) { r.ok = false; return false; }
+  const uint32_t n = r.U32();
+  m.clear();
+  for (uint32_t k = 0; k < n && r.ok; ++k) {
+    std::string key = r.Str();
+    T v;
+    if (r.Raw(&v, sizeof(T))) m[key] = v;
+  }
+  return r.ok;
+}
+
+// Écriture atomique: fichier temporaire puis remplacement
+static inline bool MiaWriteFileAtomic(const std::string& path, const std::string& data) {
+  MiaEnsureDirsForFile(path);
+  const std::string tmp = path + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "wb");
+  if (!f) return false;
+  const bool written = fwrite(data.data(), 1, data.size(), f) == data.size();
+  fclose(f);
+  if (!written) { remove(tmp.c_str()); return false; }
+#ifdef _WIN32
+  return MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+}
+
+static inline bool MiaReadFile(const std::string& path, std::string& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  out.clear();
+  char chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof chunk, f)) > 0) out.append(chunk, n);
+  fclose(f);
+  return true;
+}
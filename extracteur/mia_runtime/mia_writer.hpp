@@ -0,0 +1,372 @@
+#pragma once
+// ========== WRITER ASYNCHRONE PARTAGÉ ==========
+// Un seul thread d'écriture et un seul pool de handles de fichiers par
+// processus Sierra Chart: G3, G4, G8 et G10 (DLL distinctes) publient leurs
+// lignes dans la même file au lieu d'ouvrir/fermer chacun leurs fichiers à
+// chaque ligne.
+//
+// Partage inter-DLL: la première DLL qui démarre crée le writer, s'épingle
+// en mémoire (GET_MODULE_HANDLE_EX_FLAG_PIN, le code du writer ne peut donc
+// pas être déchargé sous les autres DLL) et publie un pointeur d'interface
+// dans un mapping nommé propre au processus. Les autres DLL le retrouvent
+// et l'utilisent uniquement via l'interface virtuelle IMiaWriter.
+// Une version d'ABI différente (DLL plus récente/ancienne) retombe sur un
+// writer local au module, lui aussi épinglé.
+// Conséquence: la DLL propriétaire reste chargée jusqu'à la fermeture de
+// Sierra Chart; une nouvelle build de cette DLL nécessite un redémarrage.
+//
+// Contre-pression: chaque fichier porte la priorité de son flux
+// (trades > basedata > quotes > depth > études). Le thread vide les files
+// par priorité avec un budget d'octets par cycle; trades et basedata ne sont
+// jamais retardés par le budget. Au-delà de MIA_WRITER_HIGH_WATER, les lignes
+// conflatables (depth/quotes, avec clé) sont réduites au dernier état par
+// clé; au-delà de MIA_WRITER_SHED_BYTES les études sont délestées. Les deux
+// cas sont comptés (jamais de perte silencieuse).
+
+#include "mia_paths.hpp"
+
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define MIA_WRITER_ABI_VERSION   3
+#define MIA_WRITER_PERIOD_MS     50        // cadence de vidage du thread
+#define MIA_WRITER_BATCH_BYTES   (256 * 1024) // réveil anticipé au-delà
+#define MIA_WRITER_CYCLE_BYTES   (4 * 1024 * 1024) // budget disque par cycle (hors trades/basedata)
+#define MIA_WRITER_HIGH_WATER    (8 * 1024 * 1024)  // au-delà: conflation depth/quotes
+#define MIA_WRITER_SHED_BYTES    (64 * 1024 * 1024) // au-delà: délestage des études
+#define MIA_WRITER_MAX_HANDLES   64        // taille du pool de handles
+#define MIA_WRITER_IDLE_CLOSE_S  120       // fermeture des handles inactifs (bascule de jour)
+#define MIA_WRITER_FLUSH_WAIT_MS 2000      // attente max d'un Flush() synchrone
+
+// Priorité d'un flux dans la file (0 = vidé en premier)
+enum MiaStreamPriority {
+  MIA_PRIO_TRADE    = 0,  // jamais conflaté ni délesté
+  MIA_PRIO_BASEDATA = 1,  // jamais conflaté ni délesté
+  MIA_PRIO_QUOTE    = 2,  // conflaté au dernier état par clé sous pression
+  MIA_PRIO_DEPTH    = 3,  // conflaté au dernier état par clé sous pression
+  MIA_PRIO_STUDY    = 4   // délesté (et compté) au-delà de MIA_WRITER_SHED_BYTES
+};
+
+// Résultat d'un Append
+enum MiaAppendResult {
+  MIA_APPEND_QUEUED    = 0,
+  MIA_APPEND_CONFLATED = 1,  // a remplacé un état plus ancien de la même clé
+  MIA_APPEND_SHED      = 2   // ligne abandonnée (comptée)
+};
+
+// Statistiques du writer (POD: traverse la frontière des DLL)
+struct MiaWriterStats {
+  uint64_t lines_queued = 0;
+  uint64_t bytes_queued = 0;
+  uint64_t bytes_written = 0;
+  uint64_t batches = 0;
+  uint64_t write_errors = 0;
+  uint64_t pending_bytes = 0;
+  uint64_t max_pending_bytes = 0;
+  uint64_t lines_conflated = 0;  // états remplacés avant écriture
+  uint64_t lines_shed = 0;       // lignes abandonnées
+  uint32_t open_files = 0;
+};
+
+// Interface stable entre DLL: uniquement des types POD / const char*
+class IMiaWriter {
+ public:
+  virtual uint32_t AbiVersion() const = 0;
+  // Ajoute une ligne (sans '\n') au fichier 'path'; retourne un MiaAppendResult.
+  // 'conflateKey' (ou NULL) autorise le remplacement par un état plus récent
+  // de la même clé tant que la ligne n'est pas écrite.
+  virtual int Append(const char* path, const char* line, size_t len, int priority,
+                     const char* conflateKey) = 0;
+  // Garantit l'existence du fichier (créé vide si besoin)
+  virtual void Touch(const char* path) = 0;
+  // Ligne d'en-tête écrite en tête du fichier quand il est créé (vide)
+  virtual void SetHeader(const char* path, const char* line, size_t len) = 0;
+  // Synchrone: retourne quand tout ce qui a été publié est sur disque
+  virtual void Flush() = 0;
+  virtual void GetStats(MiaWriterStats& out) = 0;
+
+ protected:
+  ~IMiaWriter() {}
+};
+
+class MiaAsyncWriter : public IMiaWriter {
+ public:
+  uint32_t AbiVersion() const override { return MIA_WRITER_ABI_VERSION; }
+
+  int Append(const char* path, const char* line, size_t len, int priority,
+             const char* conflateKey) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    StartLocked();
+    PathQueue& q = queues_[path];
+    if (priority < q.priority) q.priority = priority;
+
+    // Conflation: sous pression, ou si un état plus ancien de la clé attend encore
+    // (sinon il serait écrit après la ligne plus récente)
+    if (conflateKey && (pending_bytes_ >= MIA_WRITER_HIGH_WATER || q.conflated.count(conflateKey))) {
+      std::string& slot = q.conflated[conflateKey];
+      const bool replaced = !slot.empty();
+      pending_bytes_ -= slot.size();
+      slot.assign(line, len);
+      slot.push_back('\n');
+      pending_bytes_ += slot.size();
+      TrackPendingLocked();
+      if (replaced) { stats_.lines_conflated++; return MIA_APPEND_CONFLATED; }
+      stats_.lines_queued++;
+      stats_.bytes_queued += len + 1;
+      return MIA_APPEND_QUEUED;
+    }
+
+    // Délestage: uniquement les flux de plus basse priorité, jamais silencieux
+    if (priority >= MIA_PRIO_STUDY && pending_bytes_ >= MIA_WRITER_SHED_BYTES) {
+      stats_.lines_shed++;
+      return MIA_APPEND_SHED;
+    }
+
+    q.lines.append(line, len);
+    q.lines.push_back('\n');
+    pending_bytes_ += len + 1;
+    stats_.lines_queued++;
+    stats_.bytes_queued += len + 1;
+    TrackPendingLocked();
+    return MIA_APPEND_QUEUED;
+  }
+
+  void Touch(const char* path) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    StartLocked();
+    queues_[path].touch = true;  // le thread ouvrira (et créera) le fichier
+  }
+
+  void SetHeader(const char* path, const char* line, size_t len) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    std::string& header = headers_[path];
+    header.assign(line, len);
+    header.push_back('\n');
+  }
+
+  void Flush() override {
+    std::unique_lock<std::mutex> lk(mtx_);
+    if (!started_) return;
+    const uint64_t target = ++flush_requested_;
+    cv_.notify_one();
+    done_cv_.wait_for(lk, std::chrono::milliseconds(MIA_WRITER_FLUSH_WAIT_MS),
+                      [&] { return flush_done_ >= target; });
+  }
+
+  void GetStats(MiaWriterStats& out) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    out = stats_;
+    out.pending_bytes = pending_bytes_;
+  }
+
+ private:
+  struct PathQueue {
+    int priority = MIA_PRIO_STUDY;
+    bool touch = false;
+    std::string lines;                            // lignes en attente (ordre d'arrivée)
+    std::map<std::string, std::string> conflated; // clé -> dernier état (écrit après 'lines')
+  };
+
+  struct BatchItem {
+    std::string path;
+    std::string data;
+    std::string header;  // vide si aucun en-tête déclaré
+  };
+
+  struct OpenFile {
+    FILE* f = nullptr;
+    time_t last_use = 0;
+  };
+
+  void StartLocked() {
+    if (started_) return;
+    started_ = true;
+    thread_ = std::thread([this] { Run(); });
+    thread_.detach();  // durée de vie = processus (instance jamais détruite)
+  }
+
+  void TrackPendingLocked() {
+    if (pending_bytes_ > stats_.max_pending_bytes) stats_.max_pending_bytes = pending_bytes_;
+    if (pending_bytes_ >= MIA_WRITER_BATCH_BYTES) cv_.notify_one();
+  }
+
+  // Prélève les files à écrire ce cycle, par priorité croissante.
+  // Trades/basedata sont toujours vidés; les autres flux dans la limite du
+  // budget du cycle (tout est vidé sur Flush()).
+  void TakeBatchLocked(bool drainAll, std::vector<BatchItem>& batch) {
+    std::vector<std::pair<int, std::string>> order;
+    order.reserve(queues_.size());
+    for (const auto& kv : queues_) order.emplace_back(kv.second.priority, kv.first);
+    std::sort(order.begin(), order.end());
+
+    size_t budget = 0;
+    for (const auto& entry : order) {
+      auto it = queues_.find(entry.second);
+      PathQueue& q = it->second;
+      if (!drainAll && entry.first > MIA_PRIO_BASEDATA && budget >= MIA_WRITER_CYCLE_BYTES) break;
+
+      std::string out;
+      out.swap(q.lines);
+      for (const auto& c : q.conflated) out += c.second;
+      pending_bytes_ -= out.size();
+      budget += out.size();
+      if (!out.empty() || q.touch) {
+        BatchItem item;
+        item.path = entry.second;
+        item.data.swap(out);
+        auto h = headers_.find(entry.second);
+        if (h != headers_.end()) item.header = h->second;
+        batch.push_back(std::move(item));
+      }
+      queues_.erase(it);
+    }
+  }
+
+  void Run() {
+    std::vector<BatchItem> batch;
+    std::unique_lock<std::mutex> lk(mtx_);
+    for (;;) {
+      cv_.wait_for(lk, std::chrono::milliseconds(MIA_WRITER_PERIOD_MS), [&] {
+        return pending_bytes_ >= MIA_WRITER_BATCH_BYTES || flush_requested_ != flush_done_;
+      });
+      const uint64_t served = flush_requested_;
+
+      // Prélèvement sous verrou, écriture disque hors verrou
+      batch.clear();
+      TakeBatchLocked(served != flush_done_, batch);
+      lk.unlock();
+
+      uint64_t written = 0, errors = 0;
+      const time_t now = time(NULL);
+      for (auto& item : batch) {
+        FILE* f = Acquire(item.path, item.header, now);
+        if (!f) { errors++; continue; }
+        if (!item.data.empty()) {
+          if (fwrite(item.data.data(), 1, item.data.size(), f) != item.data.size()) errors++;
+          else written += item.data.size();
+        }
+        fflush(f);
+      }
+      CloseIdle(now);
+
+      lk.lock();
+      if (!batch.empty()) stats_.batches++;
+      stats_.bytes_written += written;
+      stats_.write_errors += errors;
+      stats_.open_files = (uint32_t)handles_.size();
+      flush_done_ = served;
+      done_cv_.notify_all();
+    }
+  }
+
+  // Pool de handles (accédé uniquement par le thread d'écriture)
+  FILE* Acquire(const std::string& path, const std::string& header, time_t now) {
+    auto it = handles_.find(path);
+    if (it == handles_.end()) {
+      if (handles_.size() >= MIA_WRITER_MAX_HANDLES) EvictOldest();
+      FILE* f = fopen(path.c_str(), "ab");
+      if (!f) {
+        MiaEnsureDirsForFile(path);
+        f = fopen(path.c_str(), "ab");
+      }
+      if (!f) return nullptr;
+      // Fichier neuf: en-tête d'abord (un fichier existant l'a déjà)
+      if (!header.empty() && fseek(f, 0, SEEK_END) == 0 && ftell(f) == 0) {
+        fwrite(header.data(), 1, header.size(), f);
+      }
+      it = handles_.emplace(path, OpenFile()).first;
+      it->second.f = f;
+    }
+    it->second.last_use = now;
+    return it->second.f;
+  }
+
+  void EvictOldest() {
+    auto oldest = handles_.begin();
+    for (auto it = handles_.begin(); it != handles_.end(); ++it) {
+      if (it->second.last_use < oldest->second.last_use) oldest = it;
+    }
+    if (oldest != handles_.end()) { fclose(oldest->second.f); handles_.erase(oldest); }
+  }
+
+  void CloseIdle(time_t now) {
+    for (auto it = handles_.begin(); it != handles_.end(); ) {
+      if (now - it->second.last_use > MIA_WRITER_IDLE_CLOSE_S) { fclose(it->second.f); it = handles_.erase(it); }
+      else ++it;
+    }
+  }
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  std::unordered_map<std::string, PathQueue> queues_;  // path -> file d'attente
+  size_t pending_bytes_ = 0;
+  uint64_t flush_requested_ = 0;
+  uint64_t flush_done_ = 0;
+  bool started_ = false;
+  std::thread thread_;
+  MiaWriterStats stats_;
+  std::unordered_map<std::string, std::string> headers_;  // path -> en-tête
+  std::unordered_map<std::string, OpenFile> handles_;
+};
+
+// ========== SINGLETON PROCESSUS ==========
+#ifdef _WIN32
+struct MiaWriterRegistry {
+  uint32_t magic;
+  uint32_t abi;
+  IMiaWriter* writer;
+};
+#define MIA_WRITER_REGISTRY_MAGIC 0x5752494D  // "MIRW"
+#endif
+
+// Retourne le writer du processus (créé au premier appel)
+static inline IMiaWriter* MiaGetWriter() {
+  static IMiaWriter* s_writer = nullptr;
+  if (s_writer) return s_writer;
+
+#ifdef _WIN32
+  char name[96];
+  const unsigned long pid = (unsigned long)GetCurrentProcessId();
+  snprintf(name, sizeof(name), "Local\\MIA_IA_WriterLock_%lu", pid);
+  HANDLE lock = CreateMutexA(NULL, FALSE, name);
+  if (lock) WaitForSingleObject(lock, INFINITE);
+
+  snprintf(name, sizeof(name), "Local\\MIA_IA_WriterRegistry_%lu", pid);
+  // Handle volontairement jamais fermé: le registre vit autant que le processus
+  HANDLE map = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                  sizeof(MiaWriterRegistry), name);
+  MiaWriterRegistry* reg = map ? (MiaWriterRegistry*)MapViewOfFile(map, FILE_MAP_ALL_ACCESS, 0, 0,
+                                                                    sizeof(MiaWriterRegistry))
+                               : nullptr;
+  if (reg && reg->magic == MIA_WRITER_REGISTRY_MAGIC && reg->abi == MIA_WRITER_ABI_VERSION && reg->writer) {
+    s_writer = reg->writer;
+  } else {
+    s_writer = new MiaAsyncWriter();
+    // Épingler ce module: le thread d'écriture exécute son code et doit
+    // survivre au déchargement de la DLL (Release All DLLs, retrait de l'étude)
+    HMODULE self = NULL;
+    const bool pinned = GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+                                           (LPCSTR)&MiaGetWriter, &self) != 0;
+    if (pinned && reg && reg->magic == 0) {
+      reg->writer = s_writer;
+      reg->abi = MIA_WRITER_ABI_VERSION;
+      reg->magic = MIA_WRITER_REGISTRY_MAGIC;
+    }
+  }
+  if (lock) { ReleaseMutex(lock); CloseHandle(lock); }
+#else
+  s_writer = new MiaAsyncWriter();
+#endif
+  return s_writer;
+}